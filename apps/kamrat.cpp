@@ -10,6 +10,8 @@
 #include "kamratFilter.hpp"
 #include "kamratMask.hpp"
 #include "kamratQuery.hpp"
+#include "kamratServe.hpp"
+#include "kamratPipeline.hpp"
 
 const void Welcome()
 {
@@ -39,7 +41,10 @@ const void PrintHelper()
               << "    rank:      an alias of score" << std::endl
               << "    filter:    feature filter by expression level" << std::endl
               << "    mask:      k-mer sequence masking" << std::endl
+              << "    mask-build: build a mask index for repeated masking" << std::endl
               << "    query:     query sequences" << std::endl
+              << "    serve:     query sequences with the index loaded once" << std::endl
+              << "    pipeline:  mask, filter, score and merge without intermediate files" << std::endl
               << std::endl;
 }
 
@@ -72,10 +77,22 @@ int main(int argc, char *argv[])
         {
             MaskMain(argc - 1, &(argv[1]));
         }
+        else if (strcmp(argv[1], "mask-build") == 0)
+        {
+            MaskBuildMain(argc - 1, &(argv[1]));
+        }
         else if (strcmp(argv[1], "query") == 0)
         {
             QueryMain(argc - 1, &(argv[1]));
         }
+        else if (strcmp(argv[1], "serve") == 0)
+        {
+            ServeMain(argc - 1, &(argv[1]));
+        }
+        else if (strcmp(argv[1], "pipeline") == 0)
+        {
+            PipelineMain(argc - 1, &(argv[1]));
+        }
         else
         {
             PrintHelper();
@@ -8,6 +8,7 @@
 #            output directory                                                                              #
 # Output:    $n$ training-testing pairs of sample-condition files                                          #
 #                sampleshuf.train$n$.tsv is associated with sampleshuf.test$n$.tsv                         #
+#            a fold assignment file sampleshuf.folds.tsv, usable by kamrat score -cvfold                   #
 #                                                                                                          #
 # For avoiding removing files by accident,                                                                 #
 # please make sure that the output directory is empty before running the script                            #
@@ -89,6 +90,12 @@ then
 	echo -e ${RED}"ERROR: sampleshuf.test*.tsv already exists in the output directory\n        stop for avoiding accidental overwriting"${NOCOLOR}
 	exit 1
 fi
+# Make sure that fold assignment does not exist
+if [ -f $out_dir/sampleshuf.folds.tsv ]
+then
+	echo -e ${RED}"ERROR: sampleshuf.folds.tsv already exists in the output directory\n       stop for avoiding accidental overwriting"${NOCOLOR}
+	exit 1
+fi
 
 # Splitting starts
 awk -v outd=$out_dir '{print $0 >> outd"/sampleshuf.tmp1."$2".tsv"}' $smp_condi_path
@@ -108,4 +115,9 @@ do
 	cat $out_dir/sampleshuf.tmp3.fold$i.tsv > $out_dir/sampleshuf.test$i.tsv
 done
 
+for i in $(seq 0 $(( $nb_fold - 1 )))
+do
+	awk -v fold=fold$i '{print $1"\t"fold}' $out_dir/sampleshuf.tmp3.fold$i.tsv >> $out_dir/sampleshuf.folds.tsv
+done
+
 rm -f $out_dir/sampleshuf.tmp*.tsv
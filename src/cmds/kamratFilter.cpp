@@ -1,17 +1,25 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <map>
 #include <limits>
+#include <algorithm> // std::min
 #include <ctime>
 
 #include "filter_runinfo.hpp"
 #include "index_loading.hpp"
+#include "mapped_index.hpp"
+#include "filter_expr.hpp"
+#include "kamratFilter.hpp"
 
 #define RESET "\033[0m"
 #define BOLDYELLOW "\033[1m\033[33m"
 
+const size_t kFilterBatchRow = 1 << 16; // features read from idx-pos.bin per batch
+const size_t kFilterChunkRow = 1 << 10; // features per parallel task, output in order
 
 const std::pair<size_t, size_t> ParseDesign(std::vector<bool> &filter_stat_vect, const std::string &dsgn_path,
                                             const std::vector<std::string> &colname_vect, const size_t nb_smp)
@@ -63,44 +71,102 @@ const std::pair<size_t, size_t> ParseDesign(std::vector<bool> &filter_stat_vect,
     return std::make_pair(nb_smp_up, nb_smp_down);
 }
 
-void ScanPrint(std::ifstream &idx_mat, const std::vector<size_t> &ft_pos_vect, const std::vector<bool> &filter_stat_vect,
-               const size_t up_min_abd, const size_t up_min_rec, const size_t down_max_abd, const size_t down_min_rec,
-               const size_t nb_smp, const bool reverse_filter, const bool with_counts)
+/** Sample groups of the design file for a filter expression: the second column is the group of the sample, of any name,
+ * a sample may be given in several groups.
+ */
+void ParseGroups(std::map<std::string, std::vector<size_t>> &group_map, const std::string &dsgn_path,
+                 const std::vector<std::string> &colname_vect, const size_t nb_smp)
 {
-    std::vector<float> count_vect;
-    std::string ft_name;
-    for (size_t ft_pos : ft_pos_vect)
+    std::ifstream dsgn_file(dsgn_path);
+    if (!dsgn_file.is_open())
     {
-        GetCountVect(count_vect, idx_mat, ft_pos, nb_smp);
-        idx_mat >> ft_name;
-        size_t up_rec(0), down_rec(0);
-        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+        throw std::invalid_argument("error open design file: " + dsgn_path);
+    }
+    std::unordered_map<std::string, size_t> smp_idx_map;
+    for (size_t i(1); i <= nb_smp; ++i)
+    {
+        smp_idx_map.insert({colname_vect[i], i - 1});
+    }
+    std::string line, smp_name, group_name;
+    while (std::getline(dsgn_file, line))
+    {
+        if (line.empty())
         {
-            if (filter_stat_vect[i_smp] && count_vect[i_smp] >= up_min_abd)
-            {
-                ++up_rec;
-            }
-            else if (!filter_stat_vect[i_smp] && count_vect[i_smp] <= down_max_abd)
-            {
-                ++down_rec;
-            }
+            continue;
+        }
+        std::istringstream line_stream(line);
+        if (!(line_stream >> smp_name >> group_name))
+        {
+            throw std::invalid_argument("sample group expected in design file line: " + line);
+        }
+        const auto &it = smp_idx_map.find(smp_name);
+        if (it != smp_idx_map.cend())
+        {
+            group_map[group_name].push_back(it->second);
+        }
+    }
+    dsgn_file.close();
+}
+
+/** Print the features satisfying (or not) the filter expression in index order, idx-mat.bin being mapped in memory.
+ * Positions are read from idx-pos.bin by batches, each batch split into chunks of rows filtered and formatted in parallel,
+ * then written in order, so that the output does not depend on the number of threads.
+ */
+void ScanPrint(std::ifstream &idx_pos, const size_t code_size, MappedMat &mapped_mat, const FilterExpr &filter_expr,
+               const size_t nb_smp, const bool reverse_filter, const bool with_counts, const size_t nb_thread)
+{
+    std::vector<size_t> ft_pos_vect;
+    std::vector<std::string> chunk_vect;
+    size_t ft_pos;
+    while (idx_pos)
+    {
+        ft_pos_vect.clear();
+        while (ft_pos_vect.size() < kFilterBatchRow && idx_pos.ignore(code_size) && idx_pos.read(reinterpret_cast<char *>(&ft_pos), sizeof(size_t)))
+        {
+            ft_pos_vect.emplace_back(ft_pos);
+        }
+        for (const size_t pos : ft_pos_vect)
+        {
+            mapped_mat.VisitRow(pos);
         }
-        if (reverse_filter != (up_rec >= up_min_rec && down_rec >= down_min_rec)) // !reverse && eligible || reverse && !eligible
+        const size_t nb_row = ft_pos_vect.size(), nb_chunk = (nb_row + kFilterChunkRow - 1) / kFilterChunkRow;
+        chunk_vect.resize(nb_chunk);
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+        for (size_t i_chunk = 0; i_chunk < nb_chunk; ++i_chunk)
         {
-            std::cout << ft_name;
-            if (with_counts)
+            thread_local std::vector<float> count_vect;
+            thread_local std::ostringstream chunk_stream;
+            count_vect.resize(nb_smp);
+            chunk_stream.str("");
+            for (size_t i_row(i_chunk * kFilterChunkRow); i_row < std::min(nb_row, (i_chunk + 1) * kFilterChunkRow); ++i_row)
             {
-                for (const float x : count_vect)
+                mapped_mat.CopyCountVect(count_vect.data(), ft_pos_vect[i_row]);
+                if (reverse_filter == filter_expr.Eval(count_vect.data())) // reverse && eligible || !reverse && !eligible
                 {
-                    std::cout << "\t" << x;
+                    continue;
                 }
+                const char *name_start;
+                const size_t name_len = mapped_mat.GetName(name_start, ft_pos_vect[i_row]);
+                chunk_stream.write(name_start, name_len);
+                if (with_counts)
+                {
+                    for (const float x : count_vect)
+                    {
+                        chunk_stream << "\t" << x;
+                    }
+                }
+                else
+                {
+                    chunk_stream << "\t0\t1\t";
+                    chunk_stream.write(reinterpret_cast<const char *>(&ft_pos_vect[i_row]), sizeof(size_t));
+                }
+                chunk_stream << "\n";
             }
-            else
-            {
-                std::cout << "\t0\t1\t";
-                std::cout.write(reinterpret_cast<char *>(&ft_pos), sizeof(size_t));
-            }
-            std::cout << std::endl;
+            chunk_vect[i_chunk] = chunk_stream.str();
+        }
+        for (const std::string &chunk : chunk_vect)
+        {
+            std::cout << chunk;
         }
     }
 }
@@ -110,37 +176,57 @@ int FilterMain(int argc, char *argv[])
     FilterWelcome();
 
     std::clock_t begin_time = clock();
-    std::string idx_dir, dsgn_path, out_path;
-    size_t up_min_rec(0), up_min_abd(0), down_min_rec(0), down_max_abd(std::numeric_limits<size_t>::max()), nb_smp, k_len;
+    std::string idx_dir, dsgn_path, expr_str, out_path;
+    size_t up_min_rec(0), up_min_abd(0), down_min_rec(0), down_max_abd(std::numeric_limits<size_t>::max()), nb_smp, k_len, nb_thread(1);
     bool reverse_filter(false), with_counts(false), _stranded; // _stranded not needed
     std::vector<std::string> colname_vect;
 
-    ParseOptions(argc, argv, idx_dir, dsgn_path, up_min_abd, up_min_rec, down_max_abd, down_min_rec, reverse_filter, out_path, with_counts);
-    PrintRunInfo(idx_dir, dsgn_path, up_min_abd, up_min_rec, down_max_abd, down_min_rec, reverse_filter, out_path, with_counts);
+    ParseOptions(argc, argv, idx_dir, dsgn_path, expr_str, up_min_abd, up_min_rec, down_max_abd, down_min_rec, reverse_filter, nb_thread, out_path, with_counts);
+    PrintRunInfo(idx_dir, dsgn_path, expr_str, up_min_abd, up_min_rec, down_max_abd, down_min_rec, reverse_filter, nb_thread, out_path, with_counts);
     LoadIndexMeta(nb_smp, k_len, _stranded, colname_vect, idx_dir + "/idx-meta.bin");
 
-    std::vector<bool> filter_stat_vect;
-    const std::pair<size_t, size_t> &&dsgn_info = ParseDesign(filter_stat_vect, dsgn_path, colname_vect, nb_smp);
-
-    if (dsgn_info.first < up_min_rec)
+    std::map<std::string, std::vector<size_t>> group_map;
+    if (!expr_str.empty())
     {
-        std::cerr << BOLDYELLOW << "[warning] " << RESET << "UP column number smaller than given minimum recurrence threshold: "
-                  << dsgn_info.first << "<" << up_min_rec << std::endl
-                  << std::endl;
+        if (!dsgn_path.empty())
+        {
+            ParseGroups(group_map, dsgn_path, colname_vect, nb_smp);
+        }
     }
-    if (dsgn_info.second < down_min_rec)
+    else // the UP/DOWN design as an expression, DOWN being the samples not UP
     {
-        std::cerr << BOLDYELLOW << "[warning] " << RESET << "DOWN column number smaller than given minimum recurrence threshold: "
-                  << dsgn_info.second << "<" << down_min_rec << std::endl
-                  << std::endl;
+        std::vector<bool> filter_stat_vect;
+        const std::pair<size_t, size_t> &&dsgn_info = ParseDesign(filter_stat_vect, dsgn_path, colname_vect, nb_smp);
+
+        if (dsgn_info.first < up_min_rec)
+        {
+            std::cerr << BOLDYELLOW << "[warning] " << RESET << "UP column number smaller than given minimum recurrence threshold: "
+                      << dsgn_info.first << "<" << up_min_rec << std::endl
+                      << std::endl;
+        }
+        if (dsgn_info.second < down_min_rec)
+        {
+            std::cerr << BOLDYELLOW << "[warning] " << RESET << "DOWN column number smaller than given minimum recurrence threshold: "
+                      << dsgn_info.second << "<" << down_min_rec << std::endl
+                      << std::endl;
+        }
+        group_map["UP"], group_map["DOWN"]; // possibly empty
+        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+        {
+            group_map[filter_stat_vect[i_smp] ? "UP" : "DOWN"].push_back(i_smp);
+        }
+        expr_str = "nb(UP >= " + std::to_string(up_min_abd) + ") >= " + std::to_string(up_min_rec) +
+                   " AND nb(DOWN <= " + std::to_string(down_max_abd) + ") >= " + std::to_string(down_min_rec);
     }
-    std::vector<size_t> ft_pos_vect;
-    LoadPosVect(ft_pos_vect, idx_dir + "/idx-pos.bin", k_len != 0);
-    std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
-    if (!idx_mat.is_open())
+    const FilterExpr filter_expr(expr_str, group_map, nb_smp);
+    std::cerr << "Compiled filter expression: " << filter_expr.GetStr() << std::endl
+              << std::endl;
+    std::ifstream idx_pos(idx_dir + "/idx-pos.bin");
+    if (!idx_pos.is_open())
     {
-        throw std::invalid_argument("loading index-mat failed, KaMRaT index folder not found or may be corrupted");
+        throw std::invalid_argument("loading index-pos failed, KaMRaT index folder not found or may be corrupted");
     }
+    MappedMat mapped_mat(idx_dir + "/idx-mat.bin", nb_smp);
     std::ofstream out_file;
     if (!out_path.empty())
     {
@@ -164,8 +250,8 @@ int FilterMain(int argc, char *argv[])
         }
         std::cout << std::endl;
     }
-    ScanPrint(idx_mat, ft_pos_vect, filter_stat_vect, up_min_abd, up_min_rec, down_max_abd, down_min_rec, nb_smp, reverse_filter, with_counts);
-    idx_mat.close();
+    ScanPrint(idx_pos, GetCodeSize(k_len), mapped_mat, filter_expr, nb_smp, reverse_filter, with_counts, nb_thread);
+    idx_pos.close();
 
     std::cout.rdbuf(backup_buf);
     if (out_file.is_open())
@@ -6,11 +6,14 @@
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <cmath>
+#include <cstdio>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 
 #include "index_runinfo.hpp"
 #include "index_loading.hpp"
+#include "count_table.hpp"
 #include "seq_coding.hpp"
 
 #define RESET "\033[0m"
@@ -21,79 +24,26 @@
  *   - sample number, k length (0 if general feature), strandedness  * 
  *   - header row indicating column names                            *
  *   - sample sum vector (binarized double vector)                   *
- * idx-ftpos:                                                        *
- *   - {feature string, position} ordered by feature                 *
+ * idx-pos:                                                          *
+ *   - {k-mer code if k-mer mode, position} ordered by feature       *
+ *     k-mer code on 8 bytes, or 16 bytes if k > 32                  *
  * idx-mat:                                                          *
  *   - feature counts (binarized float vector)                       *
+ * idx-log (optional):                                               *
+ *   - same layout as idx-mat, with log2(count + 1) as float vector  *
 \* ----------------------------------------------------------------- */
 
-const size_t CountColumn(const std::string &line_str)
-{
-    size_t nb_smp(0);
-    std::istringstream conv(line_str);
-    std::string term;
-    // count sample number, skipping the first column
-    for (conv >> term; conv >> term; ++nb_smp){}
-    if (nb_smp == 0)
-    {
-        throw std::domain_error("input table parsing failed: sample number equals to 0");
-    }
-    return nb_smp;
-}
-
-void ComputeNF(std::vector<double> &nf_vect, std::istream &kmer_count_instream, const size_t nf_base)
-{
-    std::string line_str, term;
-    std::istringstream conv;
-    std::vector<float> count_vect;
-
-    std::getline(kmer_count_instream, line_str);
-    size_t nb_smp = CountColumn(line_str);
-    nf_vect.resize(nb_smp, 0);
-    while (std::getline(kmer_count_instream, line_str))
-    {
-        conv.str(line_str);
-        // parse feature name and following count columns
-        for (conv >> term; conv >> term; count_vect.push_back(std::stof(term))) {}
-        // check if all rows have same number of columns as the header row
-        if (count_vect.size() != nb_smp) 
-        {
-            throw std::length_error("sample numbers are not consistent: " + std::to_string(nb_smp) + " vs " + std::to_string(count_vect.size()));
-        }
-        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp) // add count vectors together for eventual normalization
-        {
-            nf_vect[i_smp] += count_vect[i_smp];
-        }
-        conv.clear();
-        count_vect.clear();
-    }
-    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
-    {
-        nf_vect[i_smp] = nf_base / nf_vect[i_smp];
-        if (nf_vect[i_smp] < 0.1)
-        {
-            throw std::invalid_argument("normalization factor too small (" + std::to_string(nf_vect[i_smp]) + "), please try larger base");
-        }
-	else if (nf_vect[i_smp] > 1000)
-	{
-	    throw std::invalid_argument("normalization factor too large (" + std::to_string(nf_vect[i_smp]) + "), please try smaller base");
-        }
-    }
-}
-
-void IndexCount(std::ofstream &idx_pos, std::ofstream &idx_mat, const std::vector<double> &nf_vect,
+template <typename kmerCode_t>
+void IndexCount(std::ofstream &idx_pos, std::ofstream &idx_mat, std::ofstream &idx_log, const std::vector<double> &nf_vect,
                 const std::string &line_str, const size_t k_len, const bool stranded, const size_t nb_smp, const bool to_norm)
 {
-    static std::istringstream conv(line_str);
-    static std::vector<float> count_vect;
-    static std::string ft_name, term;
-    static std::unordered_set<uint64_t> code_set;
-    static size_t ft_code(0), ft_pos;
+    static std::vector<float> count_vect, log_vect;
+    static std::string ft_name;
+    static std::unordered_set<kmerCode_t, KmerCodeHash> code_set;
+    static kmerCode_t ft_code(0);
+    static size_t ft_pos;
 
-    conv.str(line_str);
-    for (conv >> ft_name; conv >> term; count_vect.push_back(std::stof(term))) // parse feature name and following count columns
-    {
-    }
+    ParseCountRow(ft_name, count_vect, line_str);
     ft_pos = static_cast<size_t>(idx_mat.tellp());
     if (k_len > 0) // if index in k-mer mode => ft_code calculated by Seq2Int
     {
@@ -101,8 +51,15 @@ void IndexCount(std::ofstream &idx_pos, std::ofstream &idx_mat, const std::vecto
         {
             throw std::length_error("feature length checking failed: length of " + ft_name + " not equal to " + std::to_string(k_len));
         }
-        ft_code = Seq2Int(ft_name, k_len, stranded);
-        idx_pos.write(reinterpret_cast<char *>(&ft_code), sizeof(uint64_t)); // [idx_pos] if indexing k-mer, write also k-mer code
+        for (const char nuc : ft_name) // Seq2Int would code any other base as T
+        {
+            if (kNucNum[static_cast<unsigned char>(nuc)] > 3)
+            {
+                throw std::domain_error("feature checking failed, k-mer with a non-ACGT base: " + ft_name);
+            }
+        }
+        ft_code = Seq2Int<kmerCode_t>(ft_name, k_len, stranded);
+        idx_pos.write(reinterpret_cast<char *>(&ft_code), sizeof(kmerCode_t)); // [idx_pos] if indexing k-mer, write also k-mer code
         if (!code_set.insert(ft_code).second)
         {
             throw std::domain_error("unicity checking failed, an equivalent key already existed for feature: " + ft_name);
@@ -119,11 +76,22 @@ void IndexCount(std::ofstream &idx_pos, std::ofstream &idx_mat, const std::vecto
     }
     idx_mat.write(reinterpret_cast<char *>(&count_vect[0]), count_vect.size() * sizeof(float)); // [idx_mat] feature count vector
     idx_mat << ft_name << std::endl;
-    count_vect.clear();
-    conv.clear();
+    if (idx_log.is_open()) // [idx_log] rows at the same positions as in idx_mat
+    {
+        log_vect.resize(count_vect.size());
+        for (size_t i_smp(0); i_smp < count_vect.size(); ++i_smp)
+        {
+            log_vect[i_smp] = static_cast<float>(log2(static_cast<double>(count_vect[i_smp]) + 1));
+        }
+        idx_log.write(reinterpret_cast<char *>(&log_vect[0]), log_vect.size() * sizeof(float));
+        idx_log << ft_name << std::endl;
+    }
 }
 
-void ScanIndex(std::ofstream &idx_meta, std::ofstream &idx_pos, std::ofstream &idx_mat, std::istream &kmer_count_instream,
+/** Index the count table, with k-mer codes of kmerCode_t, 128-bit if k > 32.
+ */
+template <typename kmerCode_t>
+void ScanIndex(std::ofstream &idx_meta, std::ofstream &idx_pos, std::ofstream &idx_mat, std::ofstream &idx_log, std::istream &kmer_count_instream,
                const std::vector<double> &nf_vect, const size_t k_len, const bool stranded, const size_t nf_base)
 {
     std::string line_str;
@@ -139,7 +107,7 @@ void ScanIndex(std::ofstream &idx_meta, std::ofstream &idx_pos, std::ofstream &i
     idx_meta << line_str << std::endl; // [idx_meta 2] the header row
     while (std::getline(kmer_count_instream, line_str))
     {
-        IndexCount(idx_pos, idx_mat, nf_vect, line_str, k_len, stranded, nb_smp, !nf_vect.empty()); // [idx_pos, idx_mat] (inside)
+        IndexCount<kmerCode_t>(idx_pos, idx_mat, idx_log, nf_vect, line_str, k_len, stranded, nb_smp, !nf_vect.empty()); // [idx_pos, idx_mat] (inside)
     }
 }
 
@@ -164,7 +132,7 @@ void TestIndex(const std::string &idx_meta_path, const std::string &idx_pos_path
     std::cout << std::endl;
 
     std::vector<size_t> pos_vect;
-    LoadPosVect(pos_vect, idx_pos_path, k_len != 0);
+    LoadPosVect(pos_vect, idx_pos_path, GetCodeSize(k_len));
     std::vector<float> count_vect;
     for (const size_t p : pos_vect)
     {
@@ -188,10 +156,10 @@ int IndexMain(int argc, char **argv)
     std::clock_t begin_time = clock();
     std::string out_dir, count_tab_path, nf_file_path;
     size_t k_len(0), nf_base(0);
-    bool stranded(true);
+    bool stranded(true), log_cache(false);
 
-    ParseOptions(argc, argv, count_tab_path, out_dir, k_len, stranded, nf_base, nf_file_path);
-    PrintRunInfo(count_tab_path, out_dir, k_len, stranded, nf_base, nf_file_path);
+    ParseOptions(argc, argv, count_tab_path, out_dir, k_len, stranded, nf_base, nf_file_path, log_cache);
+    PrintRunInfo(count_tab_path, out_dir, k_len, stranded, nf_base, nf_file_path, log_cache);
     if (0 == k_len)
     {
         std::cerr << BOLDYELLOW << "[warning]" << RESET << " indexing in general: features are not considered as k-mers" << std::endl
@@ -214,6 +182,15 @@ int IndexMain(int argc, char **argv)
     {
         throw std::invalid_argument("output folder for index does not exist: " + out_dir);
     }
+    std::ofstream idx_log;
+    if (log_cache)
+    {
+        idx_log.open(out_dir + "/idx-log.bin");
+    }
+    else
+    {
+        std::remove((out_dir + "/idx-log.bin").c_str()); // a cache left by a previous index would be stale
+    }
 
     std::vector<double> nf_vect;
     if (nf_base > 0) // to compute NF
@@ -237,15 +214,7 @@ int IndexMain(int argc, char **argv)
     else if (!nf_file_path.empty()) // to load NF
     {
         std::cerr << "Loading NF..." << std::endl;
-        std::ifstream nf_file(nf_file_path);
-        if (!nf_file.is_open())
-        {
-            throw std::invalid_argument("cannot open count NF file: " + nf_file_path);
-        }
-        for (double x(0); nf_file >> x; nf_vect.push_back(x))
-        {
-        }
-        nf_file.close();
+        LoadNF(nf_vect, nf_file_path);
     }
 
     std::ifstream count_tab(count_tab_path);
@@ -261,7 +230,14 @@ int IndexMain(int argc, char **argv)
     inbuf.push(count_tab);
     std::istream kmer_count_instream(&inbuf);
     // Load and index the matrix
-    ScanIndex(idx_meta, idx_pos, idx_mat, kmer_count_instream, nf_vect, k_len, stranded, nf_base);
+    if (k_len > kMaxKLen64)
+    {
+        ScanIndex<uint128_t>(idx_meta, idx_pos, idx_mat, idx_log, kmer_count_instream, nf_vect, k_len, stranded, nf_base);
+    }
+    else
+    {
+        ScanIndex<uint64_t>(idx_meta, idx_pos, idx_mat, idx_log, kmer_count_instream, nf_vect, k_len, stranded, nf_base);
+    }
     // Write normalization factor values to idx-meta file
     if (!nf_vect.empty())
     {
@@ -273,6 +249,10 @@ int IndexMain(int argc, char **argv)
     }
     count_tab.close();
     idx_mat.close(), idx_pos.close(), idx_meta.close();
+    if (idx_log.is_open())
+    {
+        idx_log.close();
+    }
 
     // TestIndex(out_dir + "/idx-meta.bin", out_dir + "/idx-pos.bin", out_dir + "/idx-mat.bin");
 
@@ -1,57 +1,148 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <unordered_set>
 #include <fstream>
+#include <algorithm> // std::sort, std::unique, std::inplace_merge
 #include <ctime>
 
 #include "mask_runinfo.hpp"
+#include "maskbuild_runinfo.hpp"
 #include "index_loading.hpp"
+#include "mapped_index.hpp"
 #include "seq_coding.hpp"
+#include "seq_reader.hpp"
+#include "kamratMask.hpp"
 
-void MakeMask(std::unordered_set<uint64_t> &kmer_mask, const std::string &mask_file_path, const size_t k_len, const bool stranded)
+const size_t kMaskBatchBase = 1 << 20;  // bases of mask sequences per batch of parallel k-mer extraction
+const size_t kRadixSortMin = 1 << 16;   // fewer codes are sorted by std::sort
+
+/** Sort codes by LSD radix sort on 16-bit digits, over the 2k bits of the codes.
+ */
+template <typename kmerCode_t>
+void RadixSort(std::vector<kmerCode_t> &code_vect, const size_t first, const size_t k_len)
 {
-    std::ifstream contig_list_file(mask_file_path);
-    if (!contig_list_file.is_open())
+    const size_t nb_code = code_vect.size() - first;
+    if (nb_code < kRadixSortMin)
     {
-        throw std::domain_error("contig fasta file " + mask_file_path + " was not found");
+        std::sort(code_vect.begin() + first, code_vect.end());
+        return;
     }
-    std::string seq, line;
-    // std::getline(contig_list_file, line); // ignore the first header line
-    while (true)
+    std::vector<kmerCode_t> tmp_vect(nb_code);
+    std::vector<size_t> bucket_start(1 << 16);
+    kmerCode_t *src = code_vect.data() + first, *dest = tmp_vect.data();
+    for (size_t shift(0); shift < 2 * k_len; shift += 16)
     {
-        std::getline(contig_list_file, line);
-        if (line[0] == '>' || contig_list_file.eof()) // reading the last line
+        std::fill(bucket_start.begin(), bucket_start.end(), 0);
+        for (size_t i(0); i < nb_code; ++i)
         {
-            for (size_t start_pos(0); start_pos + k_len <= seq.size(); ++start_pos)
-            {
-                std::string kmer = seq.substr(start_pos, k_len);
-                kmer_mask.insert(Seq2Int(kmer, k_len, stranded));
-            }
-            seq.clear();
-            if (contig_list_file.eof())
+            ++bucket_start[static_cast<uint16_t>(src[i] >> shift)];
+        }
+        size_t start(0);
+        for (size_t &x : bucket_start)
+        {
+            std::swap(x, start);
+            start += x;
+        }
+        for (size_t i(0); i < nb_code; ++i)
+        {
+            dest[bucket_start[static_cast<uint16_t>(src[i] >> shift)]++] = src[i];
+        }
+        std::swap(src, dest);
+    }
+    if (src != code_vect.data() + first) // odd number of passes
+    {
+        std::copy(src, src + nb_code, code_vect.data() + first);
+    }
+}
+
+/** Sort and deduplicate the codes appended after the first nb_sorted ones, then merge them into the sorted part.
+ */
+template <typename kmerCode_t>
+void SortMergeCodes(std::vector<kmerCode_t> &kmer_mask, const size_t nb_sorted, const size_t k_len)
+{
+    RadixSort(kmer_mask, nb_sorted, k_len);
+    auto sorted_end = kmer_mask.begin() + nb_sorted, new_end = std::unique(sorted_end, kmer_mask.end());
+    std::inplace_merge(kmer_mask.begin(), sorted_end, new_end);
+    kmer_mask.erase(std::unique(kmer_mask.begin(), new_end), kmer_mask.end());
+}
+
+/** Sorted array of the distinct (canonical if unstranded) k-mer codes of the mask sequences.
+ * Codes are extracted in parallel by segments of at most kMaskBatchBase bases, long sequences being cut with k-1 bases of overlap,
+ * and merged into the sorted array whenever the unsorted codes reach a quarter of the sorted ones, so that memory stays within twice the final array.
+ */
+template <typename kmerCode_t>
+void MakeMask(std::vector<kmerCode_t> &kmer_mask, const std::string &mask_file_path, const size_t k_len, const bool stranded,
+              const size_t nb_thread)
+{
+    SeqReader seq_reader(mask_file_path);
+    std::vector<SeqRecord> seq_batch;
+    std::vector<std::pair<const char *, size_t>> seg_vect; // segments of the sequences in the batch
+    std::vector<std::vector<kmerCode_t>> code_batch;
+    size_t nb_sorted(0);
+    kmer_mask.clear();
+    while (seq_reader.NextBatch(seq_batch, kMaskBatchBase))
+    {
+        seg_vect.clear();
+        for (const SeqRecord &rec : seq_batch)
+        {
+            for (size_t start(0); start + k_len <= rec.seq_len; start += kMaskBatchBase)
             {
-                break;
+                seg_vect.emplace_back(rec.seq + start, std::min(rec.seq_len - start, kMaskBatchBase + k_len - 1));
             }
         }
-        else
+        for (size_t i_first(0), i_last; i_first < seg_vect.size(); i_first = i_last) // segments of about kMaskBatchBase bases in total
         {
-            seq += line;
+            size_t nb_base(0);
+            for (i_last = i_first; i_last < seg_vect.size() && nb_base < kMaskBatchBase; ++i_last)
+            {
+                nb_base += seg_vect[i_last].second;
+            }
+            code_batch.resize(i_last - i_first);
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+            for (size_t i_seg = i_first; i_seg < i_last; ++i_seg)
+            {
+                KmerRoller<kmerCode_t> kmer_roller(k_len);
+                std::vector<kmerCode_t> &code_vect = code_batch[i_seg - i_first];
+                code_vect.clear();
+                for (size_t i(0); i < seg_vect[i_seg].second; ++i)
+                {
+                    if (kmer_roller.Roll(seg_vect[i_seg].first[i]))
+                    {
+                        code_vect.push_back(kmer_roller.GetCode(stranded));
+                    }
+                }
+            }
+            for (const auto &code_vect : code_batch)
+            {
+                kmer_mask.insert(kmer_mask.end(), code_vect.cbegin(), code_vect.cend());
+            }
+            if (kmer_mask.size() - nb_sorted >= std::max(nb_sorted / 4, kRadixSortMin))
+            {
+                SortMergeCodes(kmer_mask, nb_sorted, k_len);
+                nb_sorted = kmer_mask.size();
+            }
         }
     }
-    contig_list_file.close();
+    SortMergeCodes(kmer_mask, nb_sorted, k_len);
+    kmer_mask.shrink_to_fit();
 }
+template void MakeMask<uint64_t>(std::vector<uint64_t> &, const std::string &, const size_t, const bool, const size_t);   // also for kamrat pipeline
+template void MakeMask<uint128_t>(std::vector<uint128_t> &, const std::string &, const size_t, const bool, const size_t);
 
-void ScanPrint(std::ifstream &idx_pos, std::ifstream &idx_mat, const std::unordered_set<uint64_t> &kmer_mask,
+/** Print the index k-mers in (or not in) the mask, in index order, codes being looked up in the mask by MaskLookup.
+ */
+template <typename kmerCode_t>
+void ScanPrint(std::ifstream &idx_pos, std::ifstream &idx_mat, const kmerCode_t *mask_begin, const kmerCode_t *mask_end,
                const bool reverse_mask, const bool with_counts, const size_t nb_smp)
 {
     std::string kmer_seq;
     std::vector<float> count_vect;
-    size_t code, pos;
-    while (idx_pos.read(reinterpret_cast<char *>(&code), sizeof(size_t)) && idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
+    kmerCode_t code;
+    size_t pos;
+    MaskLookup<kmerCode_t> mask_lookup(mask_begin, mask_end);
+    while (idx_pos.read(reinterpret_cast<char *>(&code), sizeof(kmerCode_t)) && idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
     {
-        const bool is_in_mask = (kmer_mask.find(code) != kmer_mask.cend());
-        if (is_in_mask == reverse_mask) // (is_in_mask && reverse_mask) || (!is_in_mask && !reverse_mask)
+        if (mask_lookup.IsInMask(code) == reverse_mask) // (is_in_mask && reverse_mask) || (!is_in_mask && !reverse_mask)
         {
             GetCountVect(count_vect, idx_mat, pos, nb_smp);
             idx_mat >> kmer_seq;
@@ -68,30 +159,61 @@ void ScanPrint(std::ifstream &idx_pos, std::ifstream &idx_mat, const std::unorde
                 std::cout << "\t0\t1\t";
                 std::cout.write(reinterpret_cast<char *>(&pos), sizeof(size_t));
             }
-            std::cout << std::endl;
+            std::cout << "\n";
         }
     }
 }
 
+/** Mask the index with k-mer codes of type kmerCode_t, the width of the codes in idx-pos.bin,
+ * from the mask index if a path is given, from the mask sequences otherwise.
+ */
+template <typename kmerCode_t>
+void MaskPrint(std::ifstream &idx_pos, std::ifstream &idx_mat, const std::string &mask_file_path, const std::string &mask_idx_path,
+               const size_t k_len, const bool stranded, const bool reverse_mask, const bool with_counts, const size_t nb_smp,
+               const size_t nb_thread)
+{
+    if (!mask_idx_path.empty())
+    {
+        const MappedMask<kmerCode_t> mapped_mask(mask_idx_path);
+        std::cerr << "Number of distinct k-mers in mask: " << mapped_mask.GetNbCode() << std::endl;
+        const kmerCode_t *mask_begin = mapped_mask.GetCodeArr();
+        ScanPrint(idx_pos, idx_mat, mask_begin, mask_begin + mapped_mask.GetNbCode(), reverse_mask, with_counts, nb_smp);
+        return;
+    }
+    std::vector<kmerCode_t> kmer_mask;
+    MakeMask(kmer_mask, mask_file_path, k_len, stranded, nb_thread);
+    std::cerr << "Number of distinct k-mers in mask: " << kmer_mask.size() << std::endl;
+    ScanPrint(idx_pos, idx_mat, kmer_mask.data(), kmer_mask.data() + kmer_mask.size(), reverse_mask, with_counts, nb_smp);
+}
+
 int MaskMain(int argc, char **argv)
 {
     MaskWelcome();
 
     std::clock_t begin_time = clock();
-    std::string idx_dir, mask_file_path, out_path;
+    std::string idx_dir, mask_file_path, mask_idx_path, out_path;
     size_t nb_smp, k_len;
+    size_t nb_thread(1);
     bool stranded, reverse_mask(false), with_counts(false);
     std::vector<std::string> colname_vect;
-    ParseOptions(argc, argv, idx_dir, mask_file_path, reverse_mask, out_path, with_counts);
+    ParseOptions(argc, argv, idx_dir, mask_file_path, mask_idx_path, reverse_mask, nb_thread, out_path, with_counts);
     LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
-    PrintRunInfo(idx_dir, k_len, stranded, mask_file_path, reverse_mask, out_path, with_counts);
+    PrintRunInfo(idx_dir, k_len, stranded, mask_file_path, mask_idx_path, reverse_mask, nb_thread, out_path, with_counts);
     if (k_len == 0)
     {
         throw std::invalid_argument("KaMRaT-mask relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
     }
-
-    std::unordered_set<uint64_t> kmer_mask;
-    MakeMask(kmer_mask, mask_file_path, k_len, stranded);
+    if (!mask_idx_path.empty())
+    {
+        size_t mask_k_len, nb_code;
+        bool mask_stranded;
+        LoadMaskMeta(mask_k_len, mask_stranded, nb_code, mask_idx_path);
+        if (mask_k_len != k_len || mask_stranded != stranded)
+        {
+            throw std::invalid_argument("mask index built with k-mer length " + std::to_string(mask_k_len) + (mask_stranded ? ", stranded" : ", unstranded") +
+                                        ", not matching the index, please rerun KaMRaT-mask-build with the same -klen and -unstrand options as KaMRaT-index");
+        }
+    }
 
     std::ifstream idx_pos(idx_dir + "/idx-pos.bin"), idx_mat(idx_dir + "/idx-mat.bin");
     if (!idx_pos.is_open() || !idx_mat.is_open())
@@ -121,7 +243,14 @@ int MaskMain(int argc, char **argv)
         }
         std::cout << std::endl;
     }
-    ScanPrint(idx_pos, idx_mat, kmer_mask, reverse_mask, with_counts, nb_smp);
+    if (k_len > kMaxKLen64)
+    {
+        MaskPrint<uint128_t>(idx_pos, idx_mat, mask_file_path, mask_idx_path, k_len, stranded, reverse_mask, with_counts, nb_smp, nb_thread);
+    }
+    else
+    {
+        MaskPrint<uint64_t>(idx_pos, idx_mat, mask_file_path, mask_idx_path, k_len, stranded, reverse_mask, with_counts, nb_smp, nb_thread);
+    }
     idx_pos.close(), idx_mat.close();
 
     std::cout.rdbuf(backup_buf);
@@ -131,4 +260,37 @@ int MaskMain(int argc, char **argv)
     }
     std::cerr << "Executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
     return EXIT_SUCCESS;
+}
+/** Build the mask k-mer codes of type kmerCode_t and write them as a mask index.
+ */
+template <typename kmerCode_t>
+void MaskBuild(const std::string &mask_file_path, const size_t k_len, const bool stranded, const size_t nb_thread, const std::string &out_path)
+{
+    std::vector<kmerCode_t> kmer_mask;
+    MakeMask(kmer_mask, mask_file_path, k_len, stranded, nb_thread);
+    std::cerr << "Number of distinct k-mers in mask: " << kmer_mask.size() << std::endl;
+    WriteMaskIndex(out_path, kmer_mask, k_len, stranded);
+}
+
+int MaskBuildMain(int argc, char **argv)
+{
+    MaskBuildWelcome();
+
+    std::clock_t begin_time = clock();
+    std::string mask_file_path, out_path;
+    size_t k_len(0), nb_thread(1);
+    bool stranded(true);
+    ParseOptions(argc, argv, mask_file_path, k_len, stranded, nb_thread, out_path);
+    PrintRunInfo(mask_file_path, k_len, stranded, nb_thread, out_path);
+
+    if (k_len > kMaxKLen64)
+    {
+        MaskBuild<uint128_t>(mask_file_path, k_len, stranded, nb_thread, out_path);
+    }
+    else
+    {
+        MaskBuild<uint64_t>(mask_file_path, k_len, stranded, nb_thread, out_path);
+    }
+    std::cerr << "Executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    return EXIT_SUCCESS;
 }
\ No newline at end of file
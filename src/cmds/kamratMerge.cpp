@@ -1,44 +1,87 @@
 #include <iostream>
 #include <ctime>
 #include <fstream>
+#include <sstream>
 #include <map>
-#include <unordered_map>
 #include <cmath>
-#include <algorithm> // std::remove_if
+#include <algorithm> // std::sort
+#include <cstring>   // std::memcpy
+#include <memory>    // std::unique_ptr
+#include <unistd.h>  // getpid
 
 #include "merge_runinfo.hpp"
-#include "contig_elem.hpp"
+#include "contig_store.hpp"
+#include "bucket_files.hpp"
 #include "merge_knot.hpp"
+#include "count_cache.hpp"
 #include "seq_coding.hpp"
 #include "index_loading.hpp"
+#include "kamratMerge.hpp"
 
-using contigVect_t = std::vector<std::unique_ptr<ContigElem>>;
+#define RESET "\033[0m"
+#define BOLDYELLOW "\033[1m\033[33m"
+
+template <typename fixCode_t>
+using knotShards_t = std::vector<fix2knot_t<fixCode_t>>; // knots partitioned by fix, for shards to be made independently
+
+/** Links of contig ends, for contig i left by its suffix at [2i], by its prefix at [2i+1]: serial and rc flag of the next contig.
+ */
+struct LinkVect
+{
+    explicit LinkVect(const size_t nb_serial) : next_vect(2 * nb_serial), next_rc_vect(2 * nb_serial, false) {}
+    SerialVect next_vect;               // kNoLink if the end is not linked
+    std::vector<uint8_t> next_rc_vect;  // bytes rather than bits, for ends to be linked by concurrent threads
+};
+
+const unsigned int kKnotShardBits = 6; // fixed shard number, for results not depending on the number of threads
+const size_t kNoLink = SerialVect::kNoSerial;
+const uint64_t kNoId = UINT64_MAX;       // in bucket records, for a contig end not linked
+const size_t kMinimizerLen = 15;         // for splitting contigs into buckets
+const size_t kBucketMemRatio = 4;        // bytes of memory per byte of a bucket loaded, at most
+const size_t kOutputBatchMem = 64 << 20; // bytes of member count vectors read per batch of output contigs
+const char kContigTag = 'c', kLinkTag = 'l'; // kinds of records in home buckets
 
 const double CalcPearsonDist(const std::vector<float> &x, const std::vector<float> &y);  // in utils/vect_opera.cpp
-const double CalcSpearmanDist(const std::vector<float> &x, const std::vector<float> &y); // in utils/vect_opera.cpp
+const double CalcSpearmanDistFromRanks(const std::vector<float> &x_rank, const std::vector<float> &y_rank); // in utils/vect_opera.cpp
 const double CalcMACDist(const std::vector<float> &x, const std::vector<float> &y);      // in utils/vect_opera.cpp
 
-const bool MakeContigListFromIndex(contigVect_t &ctg_vect, const std::string &idx_pos_path,
-                                   std::ifstream &idx_mat, const size_t nb_smp)
+inline void ReserveSerials(ContigStore &ctg_store, const size_t nb_serial)
+{
+    ctg_store.ReserveSerials(nb_serial);
+}
+
+inline void ReserveSerials(ContigSpool &, const size_t) // records are written as they come
+{
+}
+
+/** Input sequences are added to a contig store for merging in memory, or to a contig spool for merging out of core.
+ */
+template <typename ctgSink_t>
+const bool MakeContigListFromIndex(ctgSink_t &ctg_sink, const std::string &idx_pos_path,
+                                   std::ifstream &idx_mat, const size_t nb_smp, const size_t k_len)
 {
     std::ifstream idx_pos(idx_pos_path);
     if (!idx_pos.is_open())
     {
         throw std::invalid_argument("loading index-pos failed, KaMRaT index folder not found or may be corrupted");
     }
+    idx_pos.seekg(0, std::ios::end); // one entry per k-mer
+    ReserveSerials(ctg_sink, static_cast<size_t>(idx_pos.tellg()) / (GetCodeSize(k_len) + sizeof(size_t)));
+    idx_pos.seekg(0);
     size_t rep_pos;
     std::string kmer_seq;
-    while (idx_pos.read(reinterpret_cast<char *>(&rep_pos), sizeof(uint64_t)) && idx_pos.read(reinterpret_cast<char *>(&rep_pos), sizeof(size_t)))
+    while (idx_pos.ignore(GetCodeSize(k_len)) && idx_pos.read(reinterpret_cast<char *>(&rep_pos), sizeof(size_t)))
     {
         idx_mat.seekg(rep_pos + nb_smp * sizeof(float)); // skip the indexed count vector
         idx_mat >> kmer_seq;
-        ctg_vect.emplace_back(std::make_unique<ContigElem>(kmer_seq, rep_pos, 0));
+        ctg_sink.AddContig(kmer_seq, rep_pos, 0);
     }
     idx_pos.close();
     return false;
 }
 
-const bool MakeContigListFromFile(contigVect_t &ctg_vect, const std::string &with_path)
+template <typename ctgSink_t>
+const bool MakeContigListFromFile(ctgSink_t &ctg_sink, const std::string &with_path)
 {
     std::ifstream with_file(with_path);
     if (!with_file.is_open())
@@ -62,7 +105,7 @@ const bool MakeContigListFromFile(contigVect_t &ctg_vect, const std::string &wit
         {
             has_value = true;
         }
-        ctg_vect.emplace_back(std::make_unique<ContigElem>(kmer_seq, rep_pos, rep_val));
+        ctg_sink.AddContig(kmer_seq, rep_pos, rep_val);
     }
     with_file.close();
     if (!read_succ)
@@ -72,57 +115,133 @@ const bool MakeContigListFromFile(contigVect_t &ctg_vect, const std::string &wit
     return has_value;
 }
 
-/**
+/** Canonical codes of the contig's prefix and suffix at the given overlap, and whether they are reverse-complemented.
  */
-void MakeOverlapKnots(fix2knot_t &hashed_merge_knots, const contigVect_t &ctg_vect, const bool stranded, const size_t i_ovlp)
+template <typename fixCode_t>
+void GetContigFixes(fixCode_t &prefix, bool &is_prefix_rc, fixCode_t &suffix, bool &is_suffix_rc,
+                    const ContigStore &ctg_store, const size_t i_ctg, const bool stranded, const size_t i_ovlp)
 {
-    for (size_t i_ctg(0); i_ctg < ctg_vect.size(); ++i_ctg)
+    prefix = ctg_store.GetPrefixCode<fixCode_t>(i_ctg, i_ovlp);
+    suffix = ctg_store.GetSuffixCode<fixCode_t>(i_ctg, i_ovlp);
+    is_prefix_rc = false;
+    is_suffix_rc = false;
+    if (!stranded)
     {
-        const std::string &seq = ctg_vect[i_ctg]->GetSeq();
-        uint64_t prefix = Seq2Int(seq, i_ovlp, true), suffix = Seq2Int(seq.substr(seq.size() - i_ovlp), i_ovlp, true);
-        bool is_prefix_rc(false), is_suffix_rc(false);
-        if (!stranded)
+        fixCode_t prefix_rc = GetRC(prefix, i_ovlp), suffix_rc = GetRC(suffix, i_ovlp);
+        if (prefix_rc < prefix)
         {
-            uint64_t prefix_rc = GetRC(prefix, i_ovlp), suffix_rc = GetRC(suffix, i_ovlp);
-            if (prefix_rc < prefix)
-            {
-                prefix = prefix_rc;
-                is_prefix_rc = true;
-            }
-            if (suffix_rc < suffix)
-            {
-                suffix = suffix_rc;
-                is_suffix_rc = true;
-            }
+            prefix = prefix_rc;
+            is_prefix_rc = true;
         }
-        if (prefix == suffix) // if the k-mer has equal prefix and suffix
+        if (suffix_rc < suffix)
         {
-            const auto &ins_pair = hashed_merge_knots.insert({prefix, MergeKnot()});
-            if (!ins_pair.first->second.HasPred() && !is_suffix_rc)
-            {
-                ins_pair.first->second.AddContig(i_ctg, false, "pred");
-            }
-            else if (!ins_pair.first->second.HasPred() && is_prefix_rc)
-            {
-                ins_pair.first->second.AddContig(i_ctg, true, "pred");
-            }
-            else if (!ins_pair.first->second.HasSucc() && !is_prefix_rc)
-            {
-                ins_pair.first->second.AddContig(i_ctg, false, "succ");
-            }
-            else if (!ins_pair.first->second.HasSucc() && is_suffix_rc)
-            {
-                ins_pair.first->second.AddContig(i_ctg, true, "succ");
-            }
-            else
+            suffix = suffix_rc;
+            is_suffix_rc = true;
+        }
+    }
+}
+
+/** Register into the knot of the given fix the contig's ends bearing this fix.
+ */
+template <typename fixCode_t>
+void AddContigToKnot(MergeKnot &knot, const fixCode_t fix, const size_t i_ctg,
+                     const fixCode_t prefix, const bool is_prefix_rc, const fixCode_t suffix, const bool is_suffix_rc)
+{
+    if (prefix == suffix) // if the k-mer has equal prefix and suffix
+    {
+        if (!knot.HasPred() && !is_suffix_rc)
+        {
+            knot.AddContig(i_ctg, false, MergeKnot::kPred);
+        }
+        else if (!knot.HasPred() && is_prefix_rc)
+        {
+            knot.AddContig(i_ctg, true, MergeKnot::kPred);
+        }
+        else if (!knot.HasSucc() && !is_prefix_rc)
+        {
+            knot.AddContig(i_ctg, false, MergeKnot::kSucc);
+        }
+        else if (!knot.HasSucc() && is_suffix_rc)
+        {
+            knot.AddContig(i_ctg, true, MergeKnot::kSucc);
+        }
+        else
+        {
+            knot.AddContig(i_ctg, is_prefix_rc, (is_prefix_rc ? MergeKnot::kPred : MergeKnot::kSucc));
+        }
+    }
+    else if (fix == prefix)
+    {
+        knot.AddContig(i_ctg, is_prefix_rc, (is_prefix_rc ? MergeKnot::kPred : MergeKnot::kSucc));
+    }
+    else if (fix == suffix)
+    {
+        knot.AddContig(i_ctg, is_suffix_rc, (is_suffix_rc ? MergeKnot::kSucc : MergeKnot::kPred));
+    }
+}
+
+template <typename fixCode_t>
+inline const size_t GetKnotShardId(const fixCode_t fix)
+{
+    return ((FoldCode(fix) * 0xC2B2AE3D27D4EB4FULL) >> (64 - kKnotShardBits)); // not FixKnotMap's multiplier, which would cluster a shard's slots
+}
+
+template <typename fixCode_t>
+inline fix2knot_t<fixCode_t> &GetKnotShard(knotShards_t<fixCode_t> &knot_shards, const fixCode_t fix)
+{
+    return knot_shards[GetKnotShardId(fix)];
+}
+
+/** Make the knots of all contig ends at the given overlap.
+ * Contigs are split into one block per thread, each block sorting its contig ends by shard, then each shard is made by one thread.
+ * Blocks are read in serial order, so contig ends reach each knot in serial order whatever the number of threads.
+ */
+template <typename fixCode_t>
+void MakeOverlapKnots(knotShards_t<fixCode_t> &knot_shards, const ContigStore &ctg_store, const bool stranded, const size_t i_ovlp,
+                      const size_t nb_thread)
+{
+    struct ContigFixes
+    {
+        fixCode_t prefix, suffix;
+        bool is_prefix_rc, is_suffix_rc;
+    };
+    const auto &ctg_list = ctg_store.GetContigList();
+    const size_t nb_ctg = ctg_list.size(), nb_shard = knot_shards.size();
+    std::vector<ContigFixes> fixes_vect(nb_ctg);
+    // contig ends of each block by shard, as 2 * i for prefix and 2 * i + 1 for suffix of the i-th contig in list
+    std::vector<std::vector<std::vector<size_t>>> end_vect(nb_thread, std::vector<std::vector<size_t>>(nb_shard));
+#pragma omp parallel for num_threads(nb_thread)
+    for (size_t i_block = 0; i_block < nb_thread; ++i_block)
+    {
+        for (size_t i(nb_ctg * i_block / nb_thread); i < nb_ctg * (i_block + 1) / nb_thread; ++i)
+        {
+            auto &fixes = fixes_vect[i];
+            GetContigFixes(fixes.prefix, fixes.is_prefix_rc, fixes.suffix, fixes.is_suffix_rc, ctg_store, ctg_list[i], stranded, i_ovlp);
+            end_vect[i_block][GetKnotShardId(fixes.prefix)].push_back(2 * i);
+            if (fixes.suffix != fixes.prefix)
             {
-                ins_pair.first->second.AddContig(i_ctg, is_prefix_rc, (is_prefix_rc ? "pred" : "succ"));
+                end_vect[i_block][GetKnotShardId(fixes.suffix)].push_back(2 * i + 1);
             }
         }
-        else // if the k-mer has different prefix and suffix
+    }
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+    for (size_t i_shard = 0; i_shard < nb_shard; ++i_shard)
+    {
+        auto &knot_shard = knot_shards[i_shard];
+        size_t nb_end(0);
+        for (const auto &block_end_vect : end_vect)
+        {
+            nb_end += block_end_vect[i_shard].size();
+        }
+        knot_shard.reserve(nb_end / 2); // most knots joining two contig ends
+        for (const auto &block_end_vect : end_vect)
         {
-            hashed_merge_knots.insert({prefix, MergeKnot()}).first->second.AddContig(i_ctg, is_prefix_rc, (is_prefix_rc ? "pred" : "succ"));
-            hashed_merge_knots.insert({suffix, MergeKnot()}).first->second.AddContig(i_ctg, is_suffix_rc, (is_suffix_rc ? "succ" : "pred"));
+            for (const size_t i_end : block_end_vect[i_shard])
+            {
+                const auto &fixes = fixes_vect[i_end / 2];
+                const fixCode_t fix = (i_end % 2 == 0 ? fixes.prefix : fixes.suffix);
+                AddContigToKnot(knot_shard[fix], fix, ctg_list[i_end / 2], fixes.prefix, fixes.is_prefix_rc, fixes.suffix, fixes.is_suffix_rc);
+            }
         }
     }
 }
@@ -147,82 +266,176 @@ const bool IsFirstContigRep(const float ctg_val1, const float ctg_val2, const st
     }
 }
 
-const bool DoExtension(contigVect_t &ctg_vect, const fix2knot_t &hashed_mergeknot_list, const size_t i_ovlp,
-                       const std::string &interv_method, const float interv_thres,
-                       std::ifstream &idx_mat, const size_t nb_smp, const std::string &rep_mode)
+/** Check the count vectors of the two k-mers joined by a knot: the pred contig's rear and the succ contig's head.
+ */
+const bool IsInterventionPassed(const size_t pred_rear_pos, const size_t succ_head_pos,
+                                const std::string &interv_method, const float interv_thres, const CountCache &count_cache)
 {
-    static std::vector<float> pred_counts, succ_counts;
-    bool has_new_extensions(false);
-    for (auto it = hashed_mergeknot_list.cbegin(); it != hashed_mergeknot_list.cend(); ++it)
+    thread_local static std::vector<float> pred_counts, succ_counts;
+    if (interv_method == "pearson")
     {
-        if (!it->second.IsMergeable())
-        {
-            continue;
-        }
-        auto &pred_ctg = ctg_vect[it->second.GetSerial("pred")], &succ_ctg = ctg_vect[it->second.GetSerial("succ")];
-        if (pred_ctg == nullptr || succ_ctg == nullptr)
-        {
-            continue;
-        }
-        const bool pred_rc = it->second.IsRC("pred"), succ_rc = it->second.IsRC("succ");
-        if (interv_method == "pearson" &&
-            CalcPearsonDist(GetCountVect(pred_counts, idx_mat, pred_ctg->GetRearPos(pred_rc), nb_smp),
-                            GetCountVect(succ_counts, idx_mat, succ_ctg->GetHeadPos(succ_rc), nb_smp)) >= interv_thres)
+        return (CalcPearsonDist(count_cache.GetCountVect(pred_counts, pred_rear_pos),
+                                count_cache.GetCountVect(succ_counts, succ_head_pos)) < interv_thres);
+    }
+    else if (interv_method == "spearman")
+    {
+        return (CalcSpearmanDistFromRanks(count_cache.GetCountVect(pred_counts, pred_rear_pos),
+                                          count_cache.GetCountVect(succ_counts, succ_head_pos)) < interv_thres);
+    }
+    else if (interv_method == "mac")
+    {
+        return (CalcMACDist(count_cache.GetCountVect(pred_counts, pred_rear_pos),
+                            count_cache.GetCountVect(succ_counts, succ_head_pos)) < interv_thres);
+    }
+    return true; // none
+}
+
+/** Link the two contig ends of a mergeable knot, if it passes the intervention check.
+ * Each contig end belongs to one knot only, so that knots link distinct ends, and can be linked in parallel.
+ */
+void LinkMergeKnot(LinkVect &link_vect, const MergeKnot &knot, const ContigStore &ctg_store,
+                   const std::string &interv_method, const float interv_thres, const CountCache &count_cache)
+{
+    if (!knot.IsMergeable())
+    {
+        return;
+    }
+    const size_t pred_serial = knot.GetSerial(MergeKnot::kPred), succ_serial = knot.GetSerial(MergeKnot::kSucc);
+    const bool pred_rc = knot.IsRC(MergeKnot::kPred), succ_rc = knot.IsRC(MergeKnot::kSucc);
+    if (IsInterventionPassed(ctg_store.GetRearPos(pred_serial, pred_rc), ctg_store.GetHeadPos(succ_serial, succ_rc),
+                             interv_method, interv_thres, count_cache))
+    {
+        link_vect.next_vect.set(2 * pred_serial + pred_rc, succ_serial);
+        link_vect.next_rc_vect[2 * pred_serial + pred_rc] = succ_rc;
+        link_vect.next_vect.set(2 * succ_serial + !succ_rc, pred_serial);
+        link_vect.next_rc_vect[2 * succ_serial + !succ_rc] = !pred_rc;
+    }
+}
+
+/** Hash of the minimizer of a fix, m-mers being ordered by hash rather than lexicographically, not to gather poly-A.
+ */
+template <typename fixCode_t>
+inline const uint64_t GetMinimizerHash(const fixCode_t fix, const size_t fix_len)
+{
+    const size_t mini_len = std::min(kMinimizerLen, fix_len);
+    const uint64_t mini_mask = (1ULL << (2 * mini_len)) - 1;
+    uint64_t min_hash(UINT64_MAX);
+    for (size_t i(0); i + mini_len <= fix_len; ++i)
+    {
+        min_hash = std::min<uint64_t>(min_hash, (static_cast<uint64_t>(fix >> (2 * i)) & mini_mask) * 0x9E3779B97F4A7C15ULL);
+    }
+    return min_hash;
+}
+
+inline const size_t GetHashBucket(const uint64_t hash, const size_t nb_bucket)
+{
+    return ((hash >> 32) % nb_bucket);
+}
+
+inline const size_t GetKeyBucket(const uint64_t key, const size_t nb_bucket) // for ids and fixes, which are not hashes
+{
+    return GetHashBucket(static_cast<uint64_t>(key * 0xC2B2AE3D27D4EB4FULL), nb_bucket);
+}
+
+using ctgLink_t = std::pair<size_t, bool>; // serial and reverse-complement flag of the next contig on a path
+
+inline const ctgLink_t GetLink(const LinkVect &link_vect, const size_t serial, const bool rc)
+{
+    return ctgLink_t(link_vect.next_vect[2 * serial + rc], link_vect.next_rc_vect[2 * serial + rc]);
+}
+
+/** Contigs of the maximal non-branching path through the given contig, in walk order, which are marked as walked.
+ * Linked contig ends chain contigs into paths, or into cycles which are cut open before the contig where the walk entered them.
+ */
+void GetUnitigPath(std::vector<ctgLink_t> &path_vect, std::vector<bool> &is_walked, const LinkVect &link_vect, const size_t i_ctg)
+{
+    ctgLink_t start(i_ctg, false); // go backward to the path start
+    for (ctgLink_t lk = GetLink(link_vect, i_ctg, true); lk.first != kNoLink && lk.first != i_ctg; lk = GetLink(link_vect, lk.first, lk.second))
+    {
+        start = ctgLink_t(lk.first, !lk.second);
+    }
+    path_vect.clear();
+    for (ctgLink_t lk = start; lk.first != kNoLink && !is_walked[lk.first]; lk = GetLink(link_vect, lk.first, lk.second))
+    {
+        is_walked[lk.first] = true;
+        path_vect.push_back(lk);
+    }
+}
+
+/** Merge the contigs of a path in one walk, instead of one extension per linked pair.
+ * As by pairwise extension, the path keeps the representative k-mer and value of its most representative contig, and its orientation.
+ * @return Serial of the merged contig
+ */
+const size_t MergeUnitigPath(ContigStore &ctg_store, std::vector<ctgLink_t> &path_vect, const size_t i_ovlp, const std::string &rep_mode)
+{
+    size_t i_rep(0);
+    for (size_t i(1); i < path_vect.size(); ++i)
+    {
+        if (!IsFirstContigRep(ctg_store.GetRepVal(path_vect[i_rep].first), ctg_store.GetRepVal(path_vect[i].first), rep_mode))
         {
-            continue;
+            i_rep = i;
         }
-        else if (interv_method == "spearman" &&
-                 CalcSpearmanDist(GetCountVect(pred_counts, idx_mat, pred_ctg->GetRearPos(pred_rc), nb_smp),
-                                  GetCountVect(succ_counts, idx_mat, succ_ctg->GetHeadPos(succ_rc), nb_smp)) >= interv_thres)
+    }
+    if (path_vect[i_rep].second) // keep the representative contig in its own orientation
+    {
+        std::reverse(path_vect.begin(), path_vect.end());
+        for (auto &lk : path_vect)
         {
-            continue;
+            lk.second = !lk.second;
         }
-        else if (interv_method == "mac" &&
-                 CalcMACDist(GetCountVect(pred_counts, idx_mat, pred_ctg->GetRearPos(pred_rc), nb_smp),
-                             GetCountVect(succ_counts, idx_mat, succ_ctg->GetHeadPos(succ_rc), nb_smp)) >= interv_thres)
+        i_rep = path_vect.size() - 1 - i_rep;
+    }
+    const size_t rep_serial = path_vect[i_rep].first; // extensions cost the added nucleotides only
+    for (size_t i(i_rep + 1); i < path_vect.size(); ++i)
+    {
+        ctg_store.RightExtend(rep_serial, path_vect[i].first, path_vect[i].second, i_ovlp);
+    }
+    for (size_t i(i_rep); i > 0; --i)
+    {
+        ctg_store.LeftExtend(rep_serial, path_vect[i - 1].first, path_vect[i - 1].second, i_ovlp);
+    }
+    return rep_serial;
+}
+
+/** Merge all contigs of each maximal non-branching path in one walk, instead of one extension per path per round.
+ * @return Number of extensions done
+ */
+const size_t WalkUnitigs(ContigStore &ctg_store, const LinkVect &link_vect, const size_t i_ovlp, const std::string &rep_mode)
+{
+    size_t nb_extensions(0);
+    std::vector<bool> is_walked(ctg_store.GetNbSerial(), false);
+    std::vector<ctgLink_t> path_vect;
+    for (const size_t i_ctg : ctg_store.GetContigList())
+    {
+        if (is_walked[i_ctg])
         {
             continue;
         }
-        // the base contig should have minimum p-value or input order //
-        if (IsFirstContigRep(pred_ctg->GetRepVal(), succ_ctg->GetRepVal(), rep_mode)) // merge right to left
+        GetUnitigPath(path_vect, is_walked, link_vect, i_ctg);
+        if (path_vect.size() > 1)
         {
-            if (pred_rc) // prevent base contig from reverse-complement transformation, for being coherent with merging knot
-            {
-                pred_ctg->LeftExtend(std::move(succ_ctg), !succ_rc, i_ovlp); // reverse this ctg and extend at right <=> reverse right ctg and extend to left of this ctg
-            }
-            else
-            {
-                pred_ctg->RightExtend(std::move(succ_ctg), succ_rc, i_ovlp);
-            }
+            MergeUnitigPath(ctg_store, path_vect, i_ovlp, rep_mode);
+            nb_extensions += path_vect.size() - 1;
         }
-        else // merge left to right
-        {
-            if (succ_rc) // prevent base contig from reverse-complement transformation, for being coherent with merging knot
-            {
-                succ_ctg->RightExtend(std::move(pred_ctg), !pred_rc, i_ovlp); // reverse this ctg and extend at left <=> reverse left ctg and extend to right of this ctg
-            }
-            else
-            {
-                succ_ctg->LeftExtend(std::move(pred_ctg), pred_rc, i_ovlp);
-            }
-        }
-        has_new_extensions = true;
     }
-    return has_new_extensions;
+    return nb_extensions;
 }
 
-void Int2Seq(std::string &seq, const uint64_t code, const size_t k_length);
-void PrintMergeKnots(const fix2knot_t &hashed_merge_knots, const contigVect_t &ctg_vect, const size_t k_len)
+template <typename fixCode_t>
+void PrintMergeKnots(const knotShards_t<fixCode_t> &hashed_merge_knots, const ContigStore &ctg_store, const size_t k_len)
 {
-    for (const auto &elem : hashed_merge_knots)
+    for (const auto &knot_shard : hashed_merge_knots)
     {
-        if (elem.second.IsMergeable())
+        for (const auto &elem : knot_shard)
         {
-            std::string fix,
-                contig_pred = ctg_vect[elem.second.GetSerial("pred")]->GetSeq(),
-                contig_succ = ctg_vect[elem.second.GetSerial("succ")]->GetSeq();
-            Int2Seq(fix, elem.first, k_len);
-            std::cout << fix << ": " << contig_pred << " ======= " << contig_succ << std::endl;
+            if (elem.second.IsMergeable())
+            {
+                std::string fix,
+                    contig_pred = ctg_store.GetSeq(elem.second.GetSerial(MergeKnot::kPred)),
+                    contig_succ = ctg_store.GetSeq(elem.second.GetSerial(MergeKnot::kSucc));
+                Int2Seq(fix, elem.first, k_len);
+                std::cout << fix << ": " << contig_pred << " ======= " << contig_succ << std::endl;
+            }
         }
     }
 }
@@ -241,58 +454,169 @@ void PrintHeader(const bool has_value, const std::vector<std::string> &colname_v
     std::cout << std::endl;
 }
 
-void PrintWithCounts(const bool has_value, const contigVect_t &ctg_vect, std::ifstream &idx_mat,
-                     const std::string &out_mode, const size_t nb_smp, const size_t min_nbkmer)
+/** Median of each column of a member-by-sample count matrix, as arma::median does:
+ * the middle value, or for an even number of values the mean of the two middle ones.
+ * Columns are copied contiguously first, selections then running on contiguous values.
+ */
+void CalcMedianCountVect(std::vector<float> &count_vect, const float *count_mat, const size_t nb_mem, const size_t nb_smp)
 {
-    std::string rep_seq;
-    std::vector<float> count_vect;
-    for (const auto &elem : ctg_vect)
+    thread_local static std::vector<float> col_arr;
+    col_arr.resize(nb_mem * nb_smp);
+    for (size_t i_mem(0); i_mem < nb_mem; ++i_mem)
     {
-        if (elem->GetNbMemKmer() < min_nbkmer)
+        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
         {
-            continue;
+            col_arr[i_smp * nb_mem + i_mem] = count_mat[i_mem * nb_smp + i_smp];
+        }
+    }
+    const size_t half = nb_mem / 2;
+    count_vect.resize(nb_smp);
+    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+    {
+        float *col = col_arr.data() + i_smp * nb_mem;
+        std::nth_element(col, col + half, col + nb_mem);
+        if (nb_mem % 2 == 0)
+        {
+            const float val1 = col[half], val2 = *std::max_element(col, col + half);
+            count_vect[i_smp] = val1 + (val2 - val1) / 2;
+        }
+        else
+        {
+            count_vect[i_smp] = col[half];
+        }
+    }
+}
+
+/** Print contigs with count vectors, by batches of contigs.
+ * The index rows of a batch's member k-mers are read in file order, contiguous rows in one go,
+ * then output lines are made in parallel, and written in contig order.
+ */
+void PrintWithCounts(const bool has_value, const ContigStore &ctg_store, std::ifstream &idx_mat, const std::string &out_mode,
+                     const size_t nb_smp, const size_t k_len, const size_t min_nbkmer, const size_t nb_thread)
+{
+    const size_t count_size = nb_smp * sizeof(float), row_size = count_size + k_len + 1; // count vector, k-mer, '\n'
+    const auto &ctg_list = ctg_store.GetContigList();
+    std::vector<size_t> batch_ctg_vect;
+    std::vector<size_t> mem_start_vect, mem_pos_vect, ctg_mem_pos_vect, order_vect; // the members of i-th contig are [mem_start_vect[i], mem_start_vect[i+1])
+    std::vector<float> count_arr;   // count vectors of members, member by member
+    std::vector<char> rep_seq_arr;  // representative k-mers of contigs
+    std::vector<std::string> line_vect;
+    for (size_t i_list(0); i_list < ctg_list.size();)
+    {
+        batch_ctg_vect.clear();
+        mem_pos_vect.clear();
+        mem_start_vect.assign(1, 0);
+        for (; i_list < ctg_list.size() && mem_pos_vect.size() * count_size < kOutputBatchMem; ++i_list)
+        {
+            const size_t i_ctg = ctg_list[i_list];
+            if (ctg_store.GetNbMemKmer(i_ctg) < min_nbkmer)
+            {
+                continue;
+            }
+            batch_ctg_vect.push_back(i_ctg);
+            if (out_mode == "rep")
+            {
+                mem_pos_vect.push_back(ctg_store.GetRepPos(i_ctg));
+            }
+            else // representative k-mer as first member
+            {
+                ctg_store.GetMemPosVect(ctg_mem_pos_vect, i_ctg);
+                mem_pos_vect.insert(mem_pos_vect.end(), ctg_mem_pos_vect.cbegin(), ctg_mem_pos_vect.cend());
+            }
+            mem_start_vect.push_back(mem_pos_vect.size());
         }
-        std::cout << elem->GetSeq();
-        std::cout << "\t" << elem->GetNbMemKmer();
-        if (has_value)
+
+        order_vect.resize(mem_pos_vect.size());
+        for (size_t i_mem(0); i_mem < mem_pos_vect.size(); ++i_mem)
         {
-            std::cout << "\t" << elem->GetRepVal();
+            order_vect[i_mem] = i_mem;
         }
-        std::cout << "\t" << GetTagSeq(rep_seq, idx_mat, elem->GetRepPos(), nb_smp);
-        if (out_mode == "rep")
+        std::sort(order_vect.begin(), order_vect.end(), [&mem_pos_vect](const size_t i, const size_t j)
+                  { return mem_pos_vect[i] < mem_pos_vect[j]; });
+        count_arr.resize(mem_pos_vect.size() * nb_smp);
+        idx_mat.clear();
+        size_t next_pos(SIZE_MAX);
+        for (const size_t i_mem : order_vect)
         {
-            GetCountVect(count_vect, idx_mat, elem->GetRepPos(), nb_smp); // output sample count vector of representative k-mer
+            if (mem_pos_vect[i_mem] != next_pos) // rows are read in one go when contiguous
+            {
+                idx_mat.seekg(mem_pos_vect[i_mem]);
+            }
+            idx_mat.read(reinterpret_cast<char *>(&count_arr[i_mem * nb_smp]), count_size);
+            idx_mat.ignore(row_size - count_size);
+            next_pos = mem_pos_vect[i_mem] + row_size;
         }
-        else if (out_mode == "mean")
+        rep_seq_arr.resize(batch_ctg_vect.size() * k_len);
+        for (size_t i(0); i < batch_ctg_vect.size(); ++i)
         {
-            GetMeanCountVect(count_vect, idx_mat, nb_smp, elem->GetMemPosVect()); // output mean sample count vector
+            idx_mat.seekg(mem_pos_vect[mem_start_vect[i]] + count_size);
+            idx_mat.read(&rep_seq_arr[i * k_len], k_len);
         }
-        else // out_mode == "median"
+
+        line_vect.resize(batch_ctg_vect.size());
+#pragma omp parallel for schedule(dynamic, 64) num_threads(nb_thread)
+        for (size_t i = 0; i < batch_ctg_vect.size(); ++i)
         {
-            GetMedianCountVect(count_vect, idx_mat, nb_smp, elem->GetMemPosVect()); // output median sample count vector
+            thread_local static std::vector<float> count_vect;
+            const size_t i_ctg = batch_ctg_vect[i];
+            const size_t nb_mem = mem_start_vect[i + 1] - mem_start_vect[i];
+            const float *count_mat = &count_arr[mem_start_vect[i] * nb_smp];
+            if (out_mode == "median")
+            {
+                CalcMedianCountVect(count_vect, count_mat, nb_mem, nb_smp);
+            }
+            else // sum in member order, as rep mode has a single member
+            {
+                count_vect.assign(count_mat, count_mat + nb_smp);
+                for (size_t i_mem(1); i_mem < nb_mem; ++i_mem)
+                {
+                    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+                    {
+                        count_vect[i_smp] += count_mat[i_mem * nb_smp + i_smp];
+                    }
+                }
+                for (size_t i_smp(0); i_smp < nb_smp && nb_mem > 1; ++i_smp)
+                {
+                    count_vect[i_smp] /= nb_mem;
+                }
+            }
+            std::ostringstream line;
+            line << ctg_store.GetSeq(i_ctg) << "\t" << ctg_store.GetNbMemKmer(i_ctg);
+            if (has_value)
+            {
+                line << "\t" << ctg_store.GetRepVal(i_ctg);
+            }
+            line << "\t";
+            line.write(&rep_seq_arr[i * k_len], k_len);
+            for (const float x : count_vect)
+            {
+                line << "\t" << x;
+            }
+            line << "\n";
+            line_vect[i] = line.str();
         }
-        for (const float x : count_vect)
+        for (const auto &line : line_vect)
         {
-            std::cout << "\t" << x;
+            std::cout << line;
         }
-        std::cout << std::endl;
-        count_vect.clear();
     }
+    std::cout.flush();
 }
 
-void PrintAsIntermediate(const contigVect_t &ctg_vect, const size_t min_nbkmer)
+void PrintAsIntermediate(const ContigStore &ctg_store, const size_t min_nbkmer)
 {
     size_t rep_pos;
-    for (const auto &elem : ctg_vect)
+    std::vector<size_t> mem_pos_vect;
+    for (const size_t i_ctg : ctg_store.GetContigList())
     {
-        if (elem->GetNbMemKmer() < min_nbkmer)
+        if (ctg_store.GetNbMemKmer(i_ctg) < min_nbkmer)
         {
             continue;
         }
-        std::cout << elem->GetSeq() << "\t0\t" << elem->GetNbMemKmer() << "\t";
-        rep_pos = elem->GetRepPos();
+        std::cout << ctg_store.GetSeq(i_ctg) << "\t0\t" << ctg_store.GetNbMemKmer(i_ctg) << "\t";
+        rep_pos = ctg_store.GetRepPos(i_ctg);
         std::cout.write(reinterpret_cast<char *>(&rep_pos), sizeof(size_t));
-        for (size_t p : elem->GetMemPosVect())
+        for (size_t p : ctg_store.GetMemPosVect(mem_pos_vect, i_ctg))
         {
             if (p != rep_pos) // not repeat the representative position
             {
@@ -303,102 +627,742 @@ void PrintAsIntermediate(const contigVect_t &ctg_vect, const size_t min_nbkmer)
     }
 }
 
-int MergeMain(int argc, char **argv)
+/** Merge contigs at one overlap, with fixes coded by fixCode_t: uint64_t up to 32 nucleotides, uint128_t beyond.
+ * Mergeable knots passing the intervention check link contig ends, then contigs are merged along linked paths in one walk:
+ * merging keeps the fixes of the path ends, so that no knot becomes mergeable by merging.
+ */
+template <typename fixCode_t>
+void MergeAtOverlap(ContigStore &ctg_store, const size_t i_ovlp, const bool stranded, const size_t nb_thread,
+                    const std::string &itv_mthd, const float itv_thres, const CountCache &count_cache, const std::string &rep_mode)
 {
-    MergeWelcome();
-
-    std::clock_t begin_time = clock(), inter_time;
-    std::string idx_dir, with_path, rep_mode("min"), itv_mthd("pearson"), out_path, out_mode;
-    float itv_thres(0.20);
-    size_t max_ovlp(0), min_ovlp(0), nb_smp(0), k_len(0), min_nbkmer(1);
-    bool stranded(false);
-    std::vector<std::string> colname_vect;
-    ParseOptions(argc, argv, idx_dir, max_ovlp, min_ovlp, with_path, rep_mode, itv_mthd, itv_thres, min_nbkmer, out_path, out_mode);
+    std::cerr << "\tcontig list size: " << ctg_store.GetContigList().size() << std::endl;
+    knotShards_t<fixCode_t> hashed_merge_knots(1 << kKnotShardBits);
+    MakeOverlapKnots(hashed_merge_knots, ctg_store, stranded, i_ovlp, nb_thread);
+    LinkVect link_vect(ctg_store.GetNbSerial());
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+    for (size_t i_shard = 0; i_shard < hashed_merge_knots.size(); ++i_shard)
+    {
+        for (const auto &elem : hashed_merge_knots[i_shard])
+        {
+            LinkMergeKnot(link_vect, elem.second, ctg_store, itv_mthd, itv_thres, count_cache);
+        }
+    }
+    knotShards_t<fixCode_t>().swap(hashed_merge_knots); // knots are not needed for walking
+    WalkUnitigs(ctg_store, link_vect, i_ovlp, rep_mode);
+}
 
-    // --- Loading ---
-    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
-    if (k_len == 0)
+/** Print with std::cout sent to the output file if a path is given, to screen if not.
+ */
+template <typename printFunc_t>
+void PrintToPath(const std::string &out_path, printFunc_t print_func)
+{
+    std::ofstream out_file;
+    if (!out_path.empty())
     {
-        throw std::invalid_argument("KaMRaT-merge relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
+        out_file.open(out_path);
+        if (!out_file.is_open())
+        {
+            throw std::domain_error("cannot open file: " + out_path);
+        }
     }
-    if (max_ovlp == 0 && min_ovlp == 0) 
+    auto backup_buf = std::cout.rdbuf();
+    if (!out_path.empty())
     {
-        max_ovlp = k_len - 1;
-        min_ovlp = static_cast<size_t>(k_len / 2);
+        std::cout.rdbuf(out_file.rdbuf());
     }
-    if (k_len <= max_ovlp)
+    print_func();
+    std::cout.rdbuf(backup_buf);
+    if (out_file.is_open())
     {
-        throw std::invalid_argument("max overlap (" + std::to_string(max_ovlp) + ") should not exceed k-mer length (" + std::to_string(k_len) + ")");
+        out_file.close();
     }
-    PrintRunInfo(idx_dir, k_len, stranded, max_ovlp, min_ovlp, with_path, rep_mode, itv_mthd, itv_thres, min_nbkmer, out_path, out_mode);
+}
 
-    contigVect_t ctg_vect;
-    std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
-    if (!idx_mat.is_open())
+/** Merge the contigs of the store from overlap max_ovlp down to min_ovlp, then print them.
+ * Shared by kamrat merge and kamrat pipeline, the store being filled from the index, an input file, or the pipeline stages.
+ */
+void MergeAndPrint(ContigStore &ctg_store, const bool has_value, std::ifstream &idx_mat, const std::vector<std::string> &colname_vect,
+                   const size_t nb_smp, const size_t k_len, const bool stranded, const size_t max_ovlp, const size_t min_ovlp,
+                   const std::string &rep_mode, const std::string &itv_mthd, const float itv_thres, const size_t min_nbkmer,
+                   const size_t nb_thread, const size_t cache_mem, const std::string &out_path, const std::string &out_mode)
+{
+    if (has_value && out_mode.empty())
     {
-        throw std::invalid_argument("loading index-mat failed, KaMRaT index folder not found or may be corrupted");
+        throw std::invalid_argument("output as intermediate after rank-merge is not possible");
+    }
+    std::clock_t inter_time = clock();
+
+    // count vectors checked by intervention: those of all input k-mers if they fit in memory, else those of contig ends at each overlap
+    CountCache count_cache(idx_mat, nb_smp, k_len, cache_mem << 20, itv_mthd == "spearman"); // ranks are cached for Spearman
+    bool is_input_cached(false);
+    std::vector<size_t> cache_pos_vect;
+    if (itv_mthd != "none")
+    {
+        for (const size_t i_ctg : ctg_store.GetContigList())
+        {
+            cache_pos_vect.push_back(ctg_store.GetRepPos(i_ctg));
+        }
+        is_input_cached = count_cache.Load(cache_pos_vect);
+        if (!is_input_cached)
+        {
+            std::cerr << BOLDYELLOW << "[warning]" << RESET << " count vectors of input k-mers exceed the cache memory, only those of contig ends are cached" << std::endl;
+        }
     }
-    const bool has_value = (with_path.empty() ? MakeContigListFromIndex(ctg_vect, idx_dir + "/idx-pos.bin", idx_mat, nb_smp)
-                                              : MakeContigListFromFile(ctg_vect, with_path));
-    std::cerr << "Option parsing and index loading finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
-    inter_time = clock();
 
-    fix2knot_t hashed_merge_knots;
     for (size_t i_ovlp(max_ovlp); i_ovlp >= min_ovlp; --i_ovlp)
     {
         std::cerr << "Merging contigs with overlap " << i_ovlp << std::endl;
-        bool has_new_extensions(true);
-        while (has_new_extensions)
+        if (itv_mthd != "none" && !is_input_cached)
         {
-            std::cerr << "\tcontig list size: " << ctg_vect.size() << std::endl;
-            MakeOverlapKnots(hashed_merge_knots, ctg_vect, stranded, i_ovlp);
-            // PrintMergeKnots(hashed_merge_knots, ctg_vect, k_len);
-            has_new_extensions = DoExtension(ctg_vect, hashed_merge_knots, i_ovlp, itv_mthd, itv_thres, idx_mat, nb_smp, rep_mode);
-            // PrintContigList(ctg_vect, kmer_count_tab, k_len, stranded, min_ovl, interv_method, interv_thres, quant_mode, idx_mat);
-            ctg_vect.erase(std::remove_if(ctg_vect.begin(), ctg_vect.end(), [](const auto &elem)
-                                          { return elem == nullptr; }),
-                           ctg_vect.end());
-            hashed_merge_knots.clear();
+            cache_pos_vect.clear();
+            for (const size_t i_ctg : ctg_store.GetContigList())
+            {
+                cache_pos_vect.push_back(ctg_store.GetHeadPos(i_ctg, false));
+                cache_pos_vect.push_back(ctg_store.GetRearPos(i_ctg, false));
+            }
+            count_cache.Load(cache_pos_vect);
         }
+        if (i_ovlp > kMaxKLen64)
+        {
+            MergeAtOverlap<uint128_t>(ctg_store, i_ovlp, stranded, nb_thread, itv_mthd, itv_thres, count_cache, rep_mode);
+        }
+        else
+        {
+            MergeAtOverlap<uint64_t>(ctg_store, i_ovlp, stranded, nb_thread, itv_mthd, itv_thres, count_cache, rep_mode);
+        }
+        ctg_store.Compact();
     }
     std::cerr << "Contig extension finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
     inter_time = clock();
 
-    std::ofstream out_file;
-    if (!out_path.empty())
+    PrintToPath(out_path, [&]() {
+        if (!out_mode.empty())
+        {
+            PrintHeader(has_value, colname_vect);
+            PrintWithCounts(has_value, ctg_store, idx_mat, out_mode, nb_smp, k_len, min_nbkmer, nb_thread);
+        }
+        else
+        {
+            PrintAsIntermediate(ctg_store, min_nbkmer);
+        }
+    });
+    std::cerr << "Contig print finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+}
+
+/* ------------------------------------------------------------------------------------------------------------------------ *\
+ * Out-of-core merging: contigs are known by ids, which are input serials and then the ids of representative contigs,        *
+ * as serials are in memory. At each overlap, contigs lie in range buckets by id, and pass through:                         *
+ * - end buckets, by the minimizer of the fix of each contig end, where knots are made and linked;                          *
+ * - home buckets, by the smaller minimizer of the two fixes of each contig, where linked paths lying in one bucket merge;   *
+ * - assembly buckets, by component, for paths linked across home buckets once stitched;                                   *
+ * and merged contigs go to the range buckets of the next overlap. Each component of linked contigs is walked from its      *
+ * contig of smallest id with the same links as in memory, so that the output does not depend on the number of buckets.     *
+\* ------------------------------------------------------------------------------------------------------------------------ */
+
+template <typename fixCode_t>
+struct EndRecord // written zero-filled, padding included
+{
+    uint64_t id, home;           // contig id, and its home bucket
+    uint64_t head_pos, rear_pos; // of the contig's head and rear k-mers, for the intervention check
+    fixCode_t prefix, suffix;
+    bool is_prefix_rc, is_suffix_rc, is_suffix_end;
+};
+
+struct LinkRecord // one side of a link, as in LinkVect: the contig of the given id left at slot 0 by its suffix, at slot 1 by its prefix
+{
+    uint64_t id, slot, next_id, next_rc;
+};
+
+struct PendingHead // of a contig on a path linked across home buckets, followed by its contig record
+{
+    uint64_t piece;      // id of the first contig of its path in its home bucket, then of the first piece of its component
+    uint64_t next_id[2]; // by slot as in LinkVect, kNoId if none
+    uint64_t next_rc[2];
+};
+
+struct StitchRecord // a link leaving a home bucket
+{
+    uint64_t id, piece, next_id;
+};
+
+inline const size_t GetRangePart(const char *record, const size_t nb_id, const size_t nb_range, const size_t i_range, const size_t nb_part)
+{
+    return (static_cast<uint128_t>(ContigStore::GetRecordId(record)) * nb_range * nb_part / nb_id - i_range * nb_part);
+}
+
+inline const size_t GetRangeBucket(const size_t id, const size_t nb_id, const size_t nb_range)
+{
+    return (static_cast<uint128_t>(id) * nb_range / nb_id);
+}
+
+inline void AppendTagged(BucketFiles::Buffer &buffer, const size_t i_bucket, const char tag, const char *record, const size_t record_size)
+{
+    thread_local static std::vector<char> tagged;
+    tagged.assign(1, tag);
+    tagged.insert(tagged.end(), record, record + record_size);
+    buffer.Append(i_bucket, tagged.data(), tagged.size());
+}
+
+/** Process a bucket at once if it fits in max_bytes, else part by part, parts being split into bucket files of their own.
+ * @param get_part (record, nb_part) -> part of the record
+ * @param process (data) on the loaded bucket or part
+ */
+template <typename partFunc_t, typename processFunc_t>
+void ProcessBucketParts(BucketFiles &bucket_files, const size_t i_bucket, const size_t max_bytes, partFunc_t get_part, processFunc_t process)
+{
+    std::vector<char> data;
+    const size_t nb_part = bucket_files.GetBucketSize(i_bucket) / std::max<size_t>(max_bytes, 1) + 1;
+    if (nb_part == 1)
     {
-        out_file.open(out_path);
-        if (!out_file.is_open())
+        bucket_files.Load(data, i_bucket);
+        process(data);
+        return;
+    }
+    BucketFiles part_files(bucket_files.GetPathPrefix() + std::to_string(i_bucket) + "-part.", nb_part);
+    {
+        BucketFiles::Buffer part_buffer(part_files);
+        bucket_files.Stream(i_bucket, [&part_buffer, &get_part, nb_part](const char *record, const size_t record_size) {
+            part_buffer.Append(get_part(record, nb_part), record, record_size);
+        });
+    }
+    for (size_t i_part(0); i_part < nb_part; ++i_part)
+    {
+        part_files.Load(data, i_part);
+        process(data);
+    }
+}
+
+/** Add the recorded contigs to the store by id order, for contigs to be in the same order as among all contigs.
+ * @param id_vect Ids by serial (output)
+ */
+void LoadSortedContigs(ContigStore &ctg_store, std::vector<size_t> &id_vect, std::vector<const char *> &record_vect)
+{
+    std::sort(record_vect.begin(), record_vect.end(), [](const char *record1, const char *record2) {
+        return ContigStore::GetRecordId(record1) < ContigStore::GetRecordId(record2);
+    });
+    for (const char *record : record_vect)
+    {
+        const size_t i_ctg = ctg_store.ReadContig(record);
+        id_vect.resize(ctg_store.GetNbSerial(), kNoId);
+        id_vect[i_ctg] = ContigStore::GetRecordId(record);
+    }
+}
+
+/** Serial of the contig of the given id in a store filled by LoadSortedContigs, kNoLink if absent.
+ */
+const size_t FindContig(const ContigStore &ctg_store, const std::vector<size_t> &id_vect, const size_t id)
+{
+    const SerialVect &ctg_list = ctg_store.GetContigList();
+    size_t low(0), high(ctg_list.size());
+    while (low < high)
+    {
+        const size_t mid = (low + high) / 2;
+        if (id_vect[ctg_list[mid]] < id)
         {
-            throw std::domain_error("cannot open file: " + out_path);
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
         }
     }
-    auto backup_buf = std::cout.rdbuf();
-    if (!out_path.empty()) // output to file if a path is given, to screen if not
+    return ((low < ctg_list.size() && id_vect[ctg_list[low]] == id) ? ctg_list[low] : kNoLink);
+}
+
+/** Write the ends of contigs to end buckets by the minimizer of their fix, and contigs to home buckets by the smaller minimizer of their two fixes,
+ * so that two contigs linked at a knot mostly share a home bucket. Range buckets are read by id order, for ends to reach each knot in id order.
+ * @return Number of contigs
+ */
+template <typename fixCode_t>
+const size_t ScanContigs(BucketFiles &end_files, BucketFiles &home_files, BucketFiles &range_files, const size_t nb_id,
+                         const size_t k_len, const bool stranded, const size_t i_ovlp, const size_t max_bytes)
+{
+    const size_t nb_range = range_files.GetNbBucket(), nb_bucket = end_files.GetNbBucket();
+    BucketFiles::Buffer end_buffer(end_files), home_buffer(home_files);
+    std::vector<char> record;
+    size_t nb_ctg(0);
+    for (size_t i_range(0); i_range < nb_range; ++i_range)
     {
-        std::cout.rdbuf(out_file.rdbuf());
+        const auto get_part = [nb_id, nb_range, i_range](const char *rec, const size_t nb_part) {
+            return GetRangePart(rec, nb_id, nb_range, i_range, nb_part);
+        };
+        ProcessBucketParts(range_files, i_range, max_bytes, get_part, [&](const std::vector<char> &data) {
+            ContigStore ctg_store(k_len);
+            std::vector<size_t> id_vect;
+            std::vector<const char *> record_vect;
+            BucketFiles::ForEachRecord(data, [&record_vect](const char *rec, size_t) { record_vect.push_back(rec); });
+            LoadSortedContigs(ctg_store, id_vect, record_vect);
+            EndRecord<fixCode_t> end;
+            std::memset(&end, 0, sizeof(end));
+            for (const size_t i_ctg : ctg_store.GetContigList())
+            {
+                GetContigFixes(end.prefix, end.is_prefix_rc, end.suffix, end.is_suffix_rc, ctg_store, i_ctg, stranded, i_ovlp);
+                const uint64_t prefix_hash = GetMinimizerHash(end.prefix, i_ovlp), suffix_hash = GetMinimizerHash(end.suffix, i_ovlp);
+                end.id = id_vect[i_ctg];
+                end.home = GetHashBucket(std::min(prefix_hash, suffix_hash), nb_bucket);
+                end.head_pos = ctg_store.GetHeadPos(i_ctg, false);
+                end.rear_pos = ctg_store.GetRearPos(i_ctg, false);
+                end.is_suffix_end = false;
+                end_buffer.Append(GetHashBucket(prefix_hash, nb_bucket), reinterpret_cast<const char *>(&end), sizeof(end));
+                if (end.suffix != end.prefix)
+                {
+                    end.is_suffix_end = true;
+                    end_buffer.Append(GetHashBucket(suffix_hash, nb_bucket), reinterpret_cast<const char *>(&end), sizeof(end));
+                }
+                ctg_store.WriteContig(record, i_ctg, end.id);
+                AppendTagged(home_buffer, end.home, kContigTag, record.data(), record.size());
+                ++nb_ctg;
+            }
+        });
+    }
+    return nb_ctg;
+}
+
+/** Make and link the knots of each end bucket, as MakeOverlapKnots and LinkMergeKnot do: ends reach each knot in id order.
+ * Count vectors checked by intervention are cached per bucket. The two sides of each link go to the home buckets of their contigs.
+ */
+template <typename fixCode_t>
+void LinkEndBuckets(BucketFiles &home_files, BucketFiles &end_files, std::ifstream &idx_mat, const size_t nb_smp, const size_t k_len,
+                    const std::string &itv_mthd, const float itv_thres, const size_t max_bytes, const size_t nb_thread)
+{
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+    for (size_t i_bucket = 0; i_bucket < end_files.GetNbBucket(); ++i_bucket)
+    {
+        BucketFiles::Buffer home_buffer(home_files);
+        std::vector<EndRecord<fixCode_t>> end_vect;
+        std::vector<size_t> pos_vect;
+        const auto get_part = [](const char *rec, const size_t nb_part) {
+            EndRecord<fixCode_t> end;
+            std::memcpy(&end, rec, sizeof(end));
+            return GetKeyBucket(static_cast<uint64_t>(end.is_suffix_end ? end.suffix : end.prefix), nb_part);
+        };
+        ProcessBucketParts(end_files, i_bucket, max_bytes, get_part, [&](const std::vector<char> &data) {
+            end_vect.clear();
+            BucketFiles::ForEachRecord(data, [&end_vect](const char *rec, size_t) {
+                end_vect.emplace_back();
+                std::memcpy(&end_vect.back(), rec, sizeof(EndRecord<fixCode_t>));
+            });
+            fix2knot_t<fixCode_t> knot_map;
+            knot_map.reserve(end_vect.size() / 2); // most knots joining two contig ends
+            for (size_t i_end(0); i_end < end_vect.size(); ++i_end) // ends known by their index in the bucket
+            {
+                const EndRecord<fixCode_t> &end = end_vect[i_end];
+                const fixCode_t fix = (end.is_suffix_end ? end.suffix : end.prefix);
+                AddContigToKnot(knot_map[fix], fix, i_end, end.prefix, end.is_prefix_rc, end.suffix, end.is_suffix_rc);
+            }
+            const auto get_pred_rear = [&end_vect](const MergeKnot &knot) {
+                const EndRecord<fixCode_t> &pred = end_vect[knot.GetSerial(MergeKnot::kPred)];
+                return (knot.IsRC(MergeKnot::kPred) ? pred.head_pos : pred.rear_pos);
+            };
+            const auto get_succ_head = [&end_vect](const MergeKnot &knot) {
+                const EndRecord<fixCode_t> &succ = end_vect[knot.GetSerial(MergeKnot::kSucc)];
+                return (knot.IsRC(MergeKnot::kSucc) ? succ.rear_pos : succ.head_pos);
+            };
+            CountCache count_cache(idx_mat, nb_smp, k_len, max_bytes, itv_mthd == "spearman");
+            if (itv_mthd != "none")
+            {
+                pos_vect.clear();
+                for (const auto &elem : knot_map)
+                {
+                    if (elem.second.IsMergeable())
+                    {
+                        pos_vect.push_back(get_pred_rear(elem.second));
+                        pos_vect.push_back(get_succ_head(elem.second));
+                    }
+                }
+#pragma omp critical(count_cache_read) // the index file is shared by threads
+                {
+                    count_cache.Load(pos_vect);
+                }
+            }
+            for (const auto &elem : knot_map)
+            {
+                const MergeKnot &knot = elem.second;
+                if (!knot.IsMergeable() || !IsInterventionPassed(get_pred_rear(knot), get_succ_head(knot), itv_mthd, itv_thres, count_cache))
+                {
+                    continue;
+                }
+                const EndRecord<fixCode_t> &pred = end_vect[knot.GetSerial(MergeKnot::kPred)], &succ = end_vect[knot.GetSerial(MergeKnot::kSucc)];
+                const bool pred_rc = knot.IsRC(MergeKnot::kPred), succ_rc = knot.IsRC(MergeKnot::kSucc);
+                const LinkRecord pred_side{pred.id, pred_rc, succ.id, succ_rc}, succ_side{succ.id, !succ_rc, pred.id, !pred_rc};
+                AppendTagged(home_buffer, pred.home, kLinkTag, reinterpret_cast<const char *>(&pred_side), sizeof(LinkRecord));
+                AppendTagged(home_buffer, succ.home, kLinkTag, reinterpret_cast<const char *>(&succ_side), sizeof(LinkRecord));
+            }
+        });
+    }
+}
+
+/** Merge in each home bucket the linked paths lying in the bucket, which go to the range buckets of the next overlap.
+ * Paths linked to other buckets are written as pending pieces with their links, and their links leaving the bucket for stitching.
+ * @return Number of pending contigs
+ */
+const size_t MergeHomeBuckets(BucketFiles &range_files, BucketFiles &pending_files, BucketFiles &stitch_files, BucketFiles &home_files,
+                              const size_t nb_id, const size_t k_len, const size_t i_ovlp, const std::string &rep_mode,
+                              const size_t max_bytes, const size_t nb_thread)
+{
+    size_t nb_pending(0);
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread) reduction(+ : nb_pending)
+    for (size_t i_bucket = 0; i_bucket < home_files.GetNbBucket(); ++i_bucket)
+    {
+        BucketFiles::Buffer range_buffer(range_files), pending_buffer(pending_files), stitch_buffer(stitch_files);
+        std::vector<char> record, pending_record;
+        const auto get_part = [](const char *rec, const size_t nb_part) {
+            uint64_t id;
+            std::memcpy(&id, rec + 1, sizeof(uint64_t)); // first field of a contig record and of a link record
+            return GetKeyBucket(id, nb_part);
+        };
+        ProcessBucketParts(home_files, i_bucket, max_bytes, get_part, [&](const std::vector<char> &data) {
+            ContigStore ctg_store(k_len);
+            std::vector<size_t> id_vect;
+            std::vector<const char *> record_vect;
+            std::vector<LinkRecord> side_vect;
+            BucketFiles::ForEachRecord(data, [&record_vect, &side_vect](const char *rec, size_t) {
+                if (rec[0] == kContigTag)
+                {
+                    record_vect.push_back(rec + 1);
+                }
+                else
+                {
+                    side_vect.emplace_back();
+                    std::memcpy(&side_vect.back(), rec + 1, sizeof(LinkRecord));
+                }
+            });
+            LoadSortedContigs(ctg_store, id_vect, record_vect);
+            LinkVect link_vect(ctg_store.GetNbSerial());
+            std::vector<LinkRecord> out_side_vect(2 * ctg_store.GetNbSerial(), LinkRecord{kNoId, 0, kNoId, 0}); // links leaving the bucket
+            for (const LinkRecord &side : side_vect)
+            {
+                const size_t i_ctg = FindContig(ctg_store, id_vect, side.id), next_ctg = FindContig(ctg_store, id_vect, side.next_id);
+                if (next_ctg != kNoLink)
+                {
+                    link_vect.next_vect.set(2 * i_ctg + side.slot, next_ctg);
+                    link_vect.next_rc_vect[2 * i_ctg + side.slot] = side.next_rc;
+                }
+                else
+                {
+                    out_side_vect[2 * i_ctg + side.slot] = side;
+                }
+            }
+
+            std::vector<bool> is_walked(ctg_store.GetNbSerial(), false);
+            std::vector<ctgLink_t> path_vect;
+            for (const size_t i_ctg : ctg_store.GetContigList())
+            {
+                if (is_walked[i_ctg])
+                {
+                    continue;
+                }
+                GetUnitigPath(path_vect, is_walked, link_vect, i_ctg);
+                const bool is_pending = std::any_of(path_vect.cbegin(), path_vect.cend(), [&out_side_vect](const ctgLink_t &lk) {
+                    return (out_side_vect[2 * lk.first].id != kNoId || out_side_vect[2 * lk.first + 1].id != kNoId);
+                });
+                if (!is_pending)
+                {
+                    const size_t rep_serial = (path_vect.size() > 1 ? MergeUnitigPath(ctg_store, path_vect, i_ovlp, rep_mode) : i_ctg);
+                    ctg_store.WriteContig(record, rep_serial, id_vect[rep_serial]);
+                    range_buffer.Append(GetRangeBucket(id_vect[rep_serial], nb_id, range_files.GetNbBucket()), record.data(), record.size());
+                    continue;
+                }
+                PendingHead head;
+                head.piece = id_vect[path_vect.front().first];
+                for (const ctgLink_t &lk : path_vect)
+                {
+                    for (const bool slot : {false, true})
+                    {
+                        const ctgLink_t next = GetLink(link_vect, lk.first, slot);
+                        const LinkRecord &out_side = out_side_vect[2 * lk.first + slot];
+                        head.next_id[slot] = (next.first != kNoLink ? id_vect[next.first] : out_side.next_id);
+                        head.next_rc[slot] = (next.first != kNoLink ? next.second : out_side.next_rc);
+                        if (out_side.id != kNoId)
+                        {
+                            const StitchRecord stitch{out_side.id, head.piece, out_side.next_id};
+                            stitch_buffer.Append(0, reinterpret_cast<const char *>(&stitch), sizeof(StitchRecord));
+                        }
+                    }
+                    ctg_store.WriteContig(record, lk.first, id_vect[lk.first]);
+                    pending_record.assign(reinterpret_cast<const char *>(&head), reinterpret_cast<const char *>(&head) + sizeof(PendingHead));
+                    pending_record.insert(pending_record.end(), record.cbegin(), record.cend());
+                    pending_buffer.Append(i_bucket, pending_record.data(), pending_record.size());
+                    ++nb_pending;
+                }
+            }
+        });
+    }
+    return nb_pending;
+}
+
+/** Gather pending pieces into components, pieces being joined by the links leaving their home buckets.
+ * A component is known by its smallest piece id, by which its contigs are written to assembly buckets.
+ */
+void StitchPieces(BucketFiles &asm_files, BucketFiles &pending_files, BucketFiles &stitch_files)
+{
+    std::vector<char> data;
+    std::vector<StitchRecord> stitch_vect;
+    stitch_files.Load(data, 0);
+    BucketFiles::ForEachRecord(data, [&stitch_vect](const char *rec, size_t) {
+        stitch_vect.emplace_back();
+        std::memcpy(&stitch_vect.back(), rec, sizeof(StitchRecord));
+    });
+    std::vector<char>().swap(data);
+
+    std::vector<std::pair<uint64_t, uint64_t>> ctg_piece_vect; // pieces of contigs with links leaving their home buckets, by contig id
+    std::vector<uint64_t> piece_vect;
+    for (const StitchRecord &stitch : stitch_vect)
+    {
+        ctg_piece_vect.emplace_back(stitch.id, stitch.piece);
+        piece_vect.push_back(stitch.piece);
+    }
+    std::sort(ctg_piece_vect.begin(), ctg_piece_vect.end());
+    std::sort(piece_vect.begin(), piece_vect.end());
+    piece_vect.erase(std::unique(piece_vect.begin(), piece_vect.end()), piece_vect.end());
+    const auto get_piece_index = [&piece_vect](const uint64_t piece) {
+        return static_cast<size_t>(std::lower_bound(piece_vect.cbegin(), piece_vect.cend(), piece) - piece_vect.cbegin());
+    };
+    std::vector<size_t> parent_vect(piece_vect.size()); // union-find over pieces, roots being the smallest pieces
+    for (size_t i(0); i < parent_vect.size(); ++i)
+    {
+        parent_vect[i] = i;
+    }
+    const auto find_root = [&parent_vect](size_t i) {
+        while (parent_vect[i] != i)
+        {
+            i = parent_vect[i] = parent_vect[parent_vect[i]];
+        }
+        return i;
+    };
+    for (const StitchRecord &stitch : stitch_vect) // the next contig has a link back to its own bucket, so that it has a piece
+    {
+        const auto next_iter = std::lower_bound(ctg_piece_vect.cbegin(), ctg_piece_vect.cend(), std::make_pair(stitch.next_id, uint64_t(0)));
+        if (next_iter == ctg_piece_vect.cend() || next_iter->first != stitch.next_id)
+        {
+            throw std::domain_error("link without its reverse side in bucket files");
+        }
+        const size_t root1 = find_root(get_piece_index(stitch.piece)), root2 = find_root(get_piece_index(next_iter->second));
+        parent_vect[std::max(root1, root2)] = std::min(root1, root2);
+    }
+
+    BucketFiles::Buffer asm_buffer(asm_files);
+    PendingHead head;
+    for (size_t i_bucket(0); i_bucket < pending_files.GetNbBucket(); ++i_bucket)
+    {
+        pending_files.Stream(i_bucket, [&](const char *rec, const size_t rec_size) {
+            std::memcpy(&head, rec, sizeof(PendingHead));
+            head.piece = piece_vect[find_root(get_piece_index(head.piece))];
+            data.assign(reinterpret_cast<const char *>(&head), reinterpret_cast<const char *>(&head) + sizeof(PendingHead));
+            data.insert(data.end(), rec + sizeof(PendingHead), rec + rec_size);
+            asm_buffer.Append(GetKeyBucket(head.piece, asm_files.GetNbBucket()), data.data(), data.size());
+        });
     }
+}
+
+/** Merge the stitched components, each assembly bucket holding whole components.
+ */
+void MergeAssemblyBuckets(BucketFiles &range_files, BucketFiles &asm_files, const size_t nb_id, const size_t k_len, const size_t i_ovlp,
+                          const std::string &rep_mode, const size_t max_bytes, const size_t nb_thread)
+{
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+    for (size_t i_bucket = 0; i_bucket < asm_files.GetNbBucket(); ++i_bucket)
+    {
+        BucketFiles::Buffer range_buffer(range_files);
+        std::vector<char> record;
+        const auto get_part = [](const char *rec, const size_t nb_part) {
+            uint64_t piece;
+            std::memcpy(&piece, rec, sizeof(uint64_t)); // first field of the pending head
+            return GetKeyBucket(piece, nb_part);
+        };
+        ProcessBucketParts(asm_files, i_bucket, max_bytes, get_part, [&](const std::vector<char> &data) {
+            ContigStore ctg_store(k_len);
+            std::vector<size_t> id_vect;
+            std::vector<const char *> record_vect;
+            BucketFiles::ForEachRecord(data, [&record_vect](const char *rec, size_t) { record_vect.push_back(rec + sizeof(PendingHead)); });
+            LoadSortedContigs(ctg_store, id_vect, record_vect);
+            LinkVect link_vect(ctg_store.GetNbSerial());
+            PendingHead head;
+            for (size_t i(0); i < record_vect.size(); ++i) // the contig list follows the sorted records
+            {
+                const size_t i_ctg = ctg_store.GetContigList()[i];
+                std::memcpy(&head, record_vect[i] - sizeof(PendingHead), sizeof(PendingHead));
+                for (const size_t slot : {0, 1})
+                {
+                    if (head.next_id[slot] == kNoId)
+                    {
+                        continue;
+                    }
+                    const size_t next_ctg = FindContig(ctg_store, id_vect, head.next_id[slot]);
+                    if (next_ctg == kNoLink)
+                    {
+                        throw std::domain_error("linked contig missing from its component");
+                    }
+                    link_vect.next_vect.set(2 * i_ctg + slot, next_ctg);
+                    link_vect.next_rc_vect[2 * i_ctg + slot] = head.next_rc[slot];
+                }
+            }
+            WalkUnitigs(ctg_store, link_vect, i_ovlp, rep_mode);
+            for (const size_t i_ctg : ctg_store.GetContigList())
+            {
+                if (!ctg_store.IsAbsorbed(i_ctg))
+                {
+                    ctg_store.WriteContig(record, i_ctg, id_vect[i_ctg]);
+                    range_buffer.Append(GetRangeBucket(id_vect[i_ctg], nb_id, range_files.GetNbBucket()), record.data(), record.size());
+                }
+            }
+        });
+    }
+}
+
+/** Merge contigs at one overlap out of core, from the range buckets in_range_files to those of out_range_files.
+ */
+template <typename fixCode_t>
+void MergeAtOverlapByBuckets(BucketFiles &out_range_files, BucketFiles &in_range_files, const size_t nb_id, std::ifstream &idx_mat,
+                             const size_t nb_smp, const size_t k_len, const bool stranded, const size_t i_ovlp,
+                             const std::string &rep_mode, const std::string &itv_mthd, const float itv_thres, const size_t nb_thread,
+                             const size_t thread_bytes, const size_t seq_bytes, const size_t nb_bucket, const std::string &tmp_prefix)
+{
+    BucketFiles end_files(tmp_prefix + "end.", nb_bucket), home_files(tmp_prefix + "home.", nb_bucket),
+        pending_files(tmp_prefix + "pending.", nb_bucket), stitch_files(tmp_prefix + "stitch.", 1), asm_files(tmp_prefix + "asm.", nb_bucket);
+    std::cerr << "\tcontig list size: "
+              << ScanContigs<fixCode_t>(end_files, home_files, in_range_files, nb_id, k_len, stranded, i_ovlp, seq_bytes) << std::endl;
+    LinkEndBuckets<fixCode_t>(home_files, end_files, idx_mat, nb_smp, k_len, itv_mthd, itv_thres, thread_bytes, nb_thread);
+    std::cerr << "\tcontigs linked across buckets: "
+              << MergeHomeBuckets(out_range_files, pending_files, stitch_files, home_files, nb_id, k_len, i_ovlp, rep_mode, thread_bytes, nb_thread)
+              << std::endl;
+    StitchPieces(asm_files, pending_files, stitch_files);
+    MergeAssemblyBuckets(out_range_files, asm_files, nb_id, k_len, i_ovlp, rep_mode, thread_bytes, nb_thread);
+}
+
+const std::string GetMergeTmpPrefix(const std::string &tmp_dir)
+{
+    return (tmp_dir + "/merge-" + std::to_string(getpid()) + ".");
+}
+
+/** Merge the contigs of the spool out of core from overlap max_ovlp down to min_ovlp, then print them in the same order as in memory.
+ * At most max_mem MB of buckets are in memory at once, shared by threads, larger buckets being processed by parts.
+ */
+void MergeAndPrint(ContigSpool &ctg_spool, const bool has_value, std::ifstream &idx_mat, const std::vector<std::string> &colname_vect,
+                   const size_t nb_smp, const size_t k_len, const bool stranded, const size_t max_ovlp, const size_t min_ovlp,
+                   const std::string &rep_mode, const std::string &itv_mthd, const float itv_thres, const size_t min_nbkmer,
+                   const size_t nb_thread, const size_t max_mem, const size_t nb_bucket, const std::string &tmp_dir,
+                   const std::string &out_path, const std::string &out_mode)
+{
     if (has_value && out_mode.empty())
     {
         throw std::invalid_argument("output as intermediate after rank-merge is not possible");
     }
-    if (!out_mode.empty())
+    std::clock_t inter_time = clock();
+
+    const std::string tmp_prefix = GetMergeTmpPrefix(tmp_dir);
+    const size_t nb_id = ctg_spool.GetNbContig(), seq_bytes = (max_mem << 20) / kBucketMemRatio, thread_bytes = seq_bytes / nb_thread;
+    BucketFiles *in_range_files = &ctg_spool.GetBucketFiles();
+    std::unique_ptr<BucketFiles> range_files;
+    for (size_t i_ovlp(max_ovlp); i_ovlp >= min_ovlp; --i_ovlp)
+    {
+        std::cerr << "Merging contigs with overlap " << i_ovlp << std::endl;
+        std::unique_ptr<BucketFiles> out_range_files(new BucketFiles(tmp_prefix + "range" + std::to_string(i_ovlp) + ".", nb_bucket));
+        if (i_ovlp > kMaxKLen64)
+        {
+            MergeAtOverlapByBuckets<uint128_t>(*out_range_files, *in_range_files, nb_id, idx_mat, nb_smp, k_len, stranded, i_ovlp, rep_mode,
+                                               itv_mthd, itv_thres, nb_thread, thread_bytes, seq_bytes, nb_bucket, tmp_prefix);
+        }
+        else
+        {
+            MergeAtOverlapByBuckets<uint64_t>(*out_range_files, *in_range_files, nb_id, idx_mat, nb_smp, k_len, stranded, i_ovlp, rep_mode,
+                                              itv_mthd, itv_thres, nb_thread, thread_bytes, seq_bytes, nb_bucket, tmp_prefix);
+        }
+        range_files = std::move(out_range_files);
+        in_range_files = range_files.get();
+    }
+    std::cerr << "Contig extension finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    inter_time = clock();
+
+    PrintToPath(out_path, [&]() {
+        if (!out_mode.empty())
+        {
+            PrintHeader(has_value, colname_vect);
+        }
+        const size_t nb_range = in_range_files->GetNbBucket();
+        for (size_t i_range(0); i_range < nb_range; ++i_range) // ranges by id order, contigs being printed as in memory
+        {
+            const auto get_part = [nb_id, nb_range, i_range](const char *rec, const size_t nb_part) {
+                return GetRangePart(rec, nb_id, nb_range, i_range, nb_part);
+            };
+            ProcessBucketParts(*in_range_files, i_range, seq_bytes, get_part, [&](const std::vector<char> &data) {
+                ContigStore ctg_store(k_len);
+                std::vector<size_t> id_vect;
+                std::vector<const char *> record_vect;
+                BucketFiles::ForEachRecord(data, [&record_vect](const char *rec, size_t) { record_vect.push_back(rec); });
+                LoadSortedContigs(ctg_store, id_vect, record_vect);
+                if (!out_mode.empty())
+                {
+                    PrintWithCounts(has_value, ctg_store, idx_mat, out_mode, nb_smp, k_len, min_nbkmer, nb_thread);
+                }
+                else
+                {
+                    PrintAsIntermediate(ctg_store, min_nbkmer);
+                }
+            });
+        }
+    });
+    std::cerr << "Contig print finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+}
+
+int MergeMain(int argc, char **argv)
+{
+    MergeWelcome();
+
+    std::clock_t begin_time = clock();
+    std::string idx_dir, with_path, rep_mode("min"), itv_mthd("pearson"), out_path, out_mode;
+    float itv_thres(0.20);
+    std::string tmp_dir;
+    size_t max_ovlp(0), min_ovlp(0), nb_smp(0), k_len(0), min_nbkmer(1), nb_thread(1), cache_mem(4096), nb_bucket(0), max_mem(4096);
+    bool stranded(false);
+    std::vector<std::string> colname_vect;
+    ParseOptions(argc, argv, idx_dir, max_ovlp, min_ovlp, with_path, rep_mode, itv_mthd, itv_thres, min_nbkmer, nb_thread, cache_mem,
+                 nb_bucket, max_mem, tmp_dir, out_path, out_mode);
+
+    // --- Loading ---
+    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
+    if (k_len == 0)
     {
-        PrintHeader(has_value, colname_vect);
-        PrintWithCounts(has_value, ctg_vect, idx_mat, out_mode, nb_smp, min_nbkmer);
+        throw std::invalid_argument("KaMRaT-merge relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
     }
-    else
+    if (max_ovlp == 0 && min_ovlp == 0) 
     {
-        PrintAsIntermediate(ctg_vect, min_nbkmer);
+        max_ovlp = k_len - 1;
+        min_ovlp = static_cast<size_t>(k_len / 2);
     }
-    idx_mat.close();
+    if (k_len <= max_ovlp)
+    {
+        throw std::invalid_argument("max overlap (" + std::to_string(max_ovlp) + ") should not exceed k-mer length (" + std::to_string(k_len) + ")");
+    }
+    PrintRunInfo(idx_dir, k_len, stranded, max_ovlp, min_ovlp, with_path, rep_mode, itv_mthd, itv_thres, min_nbkmer, nb_thread, cache_mem,
+                 nb_bucket, max_mem, tmp_dir, out_path, out_mode);
 
-    std::cout.rdbuf(backup_buf);
-    if (out_file.is_open())
+    std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
+    if (!idx_mat.is_open())
     {
-        out_file.close();
+        throw std::invalid_argument("loading index-mat failed, KaMRaT index folder not found or may be corrupted");
     }
-    std::cerr << "Contig print finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    const auto load_contigs = [&](auto &ctg_sink) {
+        const bool has_value = (with_path.empty() ? MakeContigListFromIndex(ctg_sink, idx_dir + "/idx-pos.bin", idx_mat, nb_smp, k_len)
+                                                  : MakeContigListFromFile(ctg_sink, with_path));
+        std::cerr << "Option parsing and index loading finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+        return has_value;
+    };
+    if (nb_bucket == 0)
+    {
+        ContigStore ctg_store(k_len);
+        const bool has_value = load_contigs(ctg_store);
+        MergeAndPrint(ctg_store, has_value, idx_mat, colname_vect, nb_smp, k_len, stranded, max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres,
+                      min_nbkmer, nb_thread, cache_mem, out_path, out_mode);
+    }
+    else
+    {
+        ContigSpool ctg_spool(GetMergeTmpPrefix(tmp_dir) + "input.");
+        const bool has_value = load_contigs(ctg_spool);
+        MergeAndPrint(ctg_spool, has_value, idx_mat, colname_vect, nb_smp, k_len, stranded, max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres,
+                      min_nbkmer, nb_thread, max_mem, nb_bucket, tmp_dir, out_path, out_mode);
+    }
+    idx_mat.close();
     std::cerr << "Total executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
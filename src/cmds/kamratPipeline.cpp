@@ -0,0 +1,298 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>    // std::unique_ptr
+#include <algorithm> // std::sort
+#include <cstring>   // memcpy
+#include <ctime>
+
+#include "pipeline_runinfo.hpp"
+#include "index_loading.hpp"
+#include "mapped_index.hpp"
+#include "seq_coding.hpp"
+#include "filter_expr.hpp"
+#include "scorer.hpp"
+#include "contig_store.hpp"
+#include "bucket_files.hpp"
+#include "kamratFilter.hpp"
+#include "kamratMask.hpp"
+#include "kamratRank.hpp"
+#include "kamratMerge.hpp"
+
+#define RESET "\033[0m"
+#define BOLDYELLOW "\033[1m\033[33m"
+
+const size_t kPipelineBatchRow = 1 << 16; // k-mers read from idx-pos.bin per batch
+const size_t kPipelineChunkRow = 1 << 10; // k-mers per parallel task, kept in index order
+
+/** Mask, filter and score the index k-mers in a single pass, idx-mat.bin (and idx-log.bin for t-test scores if given) being mapped in memory.
+ * Codes and positions are read from idx-pos.bin by batches, the mask being looked up by MaskLookup as in kamrat mask,
+ * then the k-mers passing the mask are filtered and scored in parallel by chunks of rows, and kept in index order,
+ * so that the retained k-mers do not depend on the number of threads.
+ * A null mask, filter expression or scorer skips the stage.
+ */
+template <typename kmerCode_t>
+void ScanStages(std::vector<size_t> &pos_vect, std::vector<double> &score_vect, std::ifstream &idx_pos,
+                MappedMat &mapped_mat, const char *log_map, const size_t nb_smp,
+                const kmerCode_t *mask_begin, const kmerCode_t *mask_end, const bool reverse_mask,
+                const FilterExpr *filter_expr, const bool reverse_filter, const Scorer *scorer, const size_t nb_thread)
+{
+    std::vector<size_t> batch_pos_vect;
+    std::vector<std::vector<size_t>> chunk_pos_vect;
+    std::vector<std::vector<double>> chunk_score_vect;
+    kmerCode_t code;
+    size_t pos;
+    MaskLookup<kmerCode_t> mask_lookup(mask_begin, mask_end);
+    while (idx_pos)
+    {
+        batch_pos_vect.clear();
+        for (size_t i_row(0); i_row < kPipelineBatchRow &&
+                              idx_pos.read(reinterpret_cast<char *>(&code), sizeof(kmerCode_t)) &&
+                              idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t));
+             ++i_row)
+        {
+            mapped_mat.VisitRow(pos);
+            if (mask_begin != nullptr && mask_lookup.IsInMask(code) != reverse_mask)
+            {
+                continue;
+            }
+            batch_pos_vect.push_back(pos);
+        }
+        const size_t nb_row = batch_pos_vect.size(), nb_chunk = (nb_row + kPipelineChunkRow - 1) / kPipelineChunkRow;
+        chunk_pos_vect.resize(nb_chunk);
+        chunk_score_vect.resize(nb_chunk);
+#pragma omp parallel for schedule(dynamic) num_threads(nb_thread)
+        for (size_t i_chunk = 0; i_chunk < nb_chunk; ++i_chunk)
+        {
+            thread_local std::vector<float> count_vect;
+            std::vector<size_t> &kept_pos_vect = chunk_pos_vect[i_chunk];
+            std::vector<double> &kept_score_vect = chunk_score_vect[i_chunk];
+            kept_pos_vect.clear();
+            kept_score_vect.clear();
+            for (size_t i_row(i_chunk * kPipelineChunkRow); i_row < std::min(nb_row, (i_chunk + 1) * kPipelineChunkRow); ++i_row)
+            {
+                const size_t row_pos = batch_pos_vect[i_row];
+                count_vect.resize(nb_smp);
+                mapped_mat.CopyCountVect(count_vect.data(), row_pos);
+                if (filter_expr != nullptr && reverse_filter == filter_expr->Eval(count_vect.data()))
+                {
+                    continue;
+                }
+                kept_pos_vect.push_back(row_pos);
+                if (scorer != nullptr && log_map != nullptr)
+                {
+                    std::memcpy(count_vect.data(), log_map + row_pos, nb_smp * sizeof(float));
+                    kept_score_vect.push_back(scorer->EstimateScoreFromLog(count_vect));
+                }
+                else if (scorer != nullptr)
+                {
+                    kept_score_vect.push_back(scorer->EstimateScore(count_vect)); // some scorers reorder the vector
+                }
+            }
+        }
+        for (size_t i_chunk(0); i_chunk < nb_chunk; ++i_chunk)
+        {
+            pos_vect.insert(pos_vect.end(), chunk_pos_vect[i_chunk].cbegin(), chunk_pos_vect[i_chunk].cend());
+            score_vect.insert(score_vect.end(), chunk_score_vect[i_chunk].cbegin(), chunk_score_vect[i_chunk].cend());
+        }
+    }
+}
+
+/** Run the scan stages with k-mer codes of type kmerCode_t, the width of the codes in idx-pos.bin,
+ * the mask being loaded from the mask index or made from the mask sequences, whichever path is given, and skipped if none is.
+ */
+template <typename kmerCode_t>
+void ScanIndexStages(std::vector<size_t> &pos_vect, std::vector<double> &score_vect, std::ifstream &idx_pos,
+                     MappedMat &mapped_mat, const char *log_map, const size_t nb_smp, const size_t k_len, const bool stranded,
+                     const std::string &mask_file_path, const std::string &mask_idx_path, const bool reverse_mask,
+                     const FilterExpr *filter_expr, const bool reverse_filter, const Scorer *scorer, const size_t nb_thread)
+{
+    if (!mask_idx_path.empty())
+    {
+        const MappedMask<kmerCode_t> mapped_mask(mask_idx_path);
+        std::cerr << "Number of distinct k-mers in mask: " << mapped_mask.GetNbCode() << std::endl;
+        const kmerCode_t *mask_begin = mapped_mask.GetCodeArr();
+        ScanStages(pos_vect, score_vect, idx_pos, mapped_mat, log_map, nb_smp, mask_begin, mask_begin + mapped_mask.GetNbCode(), reverse_mask,
+                   filter_expr, reverse_filter, scorer, nb_thread);
+    }
+    else if (!mask_file_path.empty())
+    {
+        std::vector<kmerCode_t> kmer_mask;
+        MakeMask(kmer_mask, mask_file_path, k_len, stranded, nb_thread);
+        std::cerr << "Number of distinct k-mers in mask: " << kmer_mask.size() << std::endl;
+        ScanStages(pos_vect, score_vect, idx_pos, mapped_mat, log_map, nb_smp, kmer_mask.data(), kmer_mask.data() + kmer_mask.size(), reverse_mask,
+                   filter_expr, reverse_filter, scorer, nb_thread);
+    }
+    else
+    {
+        ScanStages<kmerCode_t>(pos_vect, score_vect, idx_pos, mapped_mat, log_map, nb_smp, nullptr, nullptr, reverse_mask,
+                               filter_expr, reverse_filter, scorer, nb_thread);
+    }
+}
+
+/** Select the top scored k-mers as kamrat score does, adjusting p-values by BH procedure for ttest.padj,
+ * and keep the selected ones in index order, as kamrat score outputs features given by a file.
+ */
+void SelectTopScored(std::vector<size_t> &pos_vect, std::vector<double> &score_vect, const Scorer &scorer, const float sel_top)
+{
+    std::vector<uint64_t> features;
+    const size_t max_to_sel = RankTopFeatures(score_vect, features, scorer, sel_top);
+    features.resize(max_to_sel);
+    std::sort(features.begin(), features.end());
+    for (size_t i(0); i < features.size(); ++i) // features[i] >= i, selected k-mers are moved forward in place
+    {
+        pos_vect[i] = pos_vect[features[i]];
+        score_vect[i] = score_vect[features[i]];
+    }
+    pos_vect.resize(max_to_sel);
+    score_vect.resize(max_to_sel);
+}
+
+int PipelineMain(int argc, char *argv[])
+{
+    PipelineWelcome();
+
+    std::clock_t begin_time = clock(), inter_time;
+    std::string idx_dir, mask_file_path, mask_idx_path, dsgn_path, expr_str, rk_mthd, rep_mode("min"), itv_mthd("pearson"), tmp_dir, out_path, out_mode;
+    float sel_top(-1), itv_thres(0.20);
+    size_t nfold(1), max_ovlp(0), min_ovlp(0), nb_smp(0), k_len(0), min_nbkmer(1), nb_thread(1), cache_mem(4096), nb_bucket(0), max_mem(4096);
+    bool stranded(false), reverse_mask(false), reverse_filter(false);
+    std::vector<std::string> colname_vect;
+    ParseOptions(argc, argv, idx_dir, mask_file_path, mask_idx_path, reverse_mask, dsgn_path, expr_str, reverse_filter, rk_mthd, nfold, sel_top,
+                 max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres, min_nbkmer, nb_thread, cache_mem, nb_bucket, max_mem, tmp_dir, out_path, out_mode);
+
+    // --- Loading ---
+    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
+    if (k_len == 0)
+    {
+        throw std::invalid_argument("KaMRaT-pipeline relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
+    }
+    if (max_ovlp == 0 && min_ovlp == 0)
+    {
+        max_ovlp = k_len - 1;
+        min_ovlp = static_cast<size_t>(k_len / 2);
+    }
+    if (k_len <= max_ovlp)
+    {
+        throw std::invalid_argument("max overlap (" + std::to_string(max_ovlp) + ") should not exceed k-mer length (" + std::to_string(k_len) + ")");
+    }
+    PrintRunInfo(idx_dir, k_len, stranded, mask_file_path, mask_idx_path, reverse_mask, dsgn_path, expr_str, reverse_filter, rk_mthd, nfold, sel_top,
+                 max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres, min_nbkmer, nb_thread, cache_mem, nb_bucket, max_mem, tmp_dir, out_path, out_mode);
+    if (!mask_idx_path.empty())
+    {
+        size_t mask_k_len, nb_code;
+        bool mask_stranded;
+        LoadMaskMeta(mask_k_len, mask_stranded, nb_code, mask_idx_path);
+        if (mask_k_len != k_len || mask_stranded != stranded)
+        {
+            throw std::invalid_argument("mask index built with k-mer length " + std::to_string(mask_k_len) + (mask_stranded ? ", stranded" : ", unstranded") +
+                                        ", not matching the index, please rerun KaMRaT-mask-build with the same -klen and -unstrand options as KaMRaT-index");
+        }
+    }
+
+    std::unique_ptr<FilterExpr> filter_expr;
+    if (!expr_str.empty())
+    {
+        std::map<std::string, std::vector<size_t>> group_map;
+        if (!dsgn_path.empty())
+        {
+            ParseGroups(group_map, dsgn_path, colname_vect, nb_smp);
+        }
+        filter_expr.reset(new FilterExpr(expr_str, group_map, nb_smp));
+        std::cerr << "Compiled filter expression: " << filter_expr->GetStr() << std::endl;
+    }
+    std::unique_ptr<Scorer> scorer;
+    if (!rk_mthd.empty())
+    {
+        std::vector<std::string> col_target_vect;
+        std::vector<std::vector<std::string>> col_covar_vect;
+        if (rk_mthd != "sd" && rk_mthd != "rsd1" && rk_mthd != "rsd2" && rk_mthd != "rsd3" && rk_mthd != "entropy")
+        {
+            ParseDesign(col_target_vect, col_covar_vect, dsgn_path, colname_vect);
+        }
+        scorer.reset(new Scorer(rk_mthd, nfold, col_target_vect, col_covar_vect));
+    }
+
+    std::ifstream idx_pos(idx_dir + "/idx-pos.bin"), idx_mat(idx_dir + "/idx-mat.bin");
+    if (!idx_pos.is_open() || !idx_mat.is_open())
+    {
+        throw std::invalid_argument("loading index-pos or index-mat failed, KaMRaT index folder not found or may be corrupted");
+    }
+    std::unique_ptr<MappedMat> mapped_mat(new MappedMat(idx_dir + "/idx-mat.bin", nb_smp)); // released before merging
+    size_t log_size(0);
+    const char *log_map(nullptr);
+    // Log2(x + 1) counts cached by kamrat index -logcache, at the same positions as in idx-mat.bin
+    if (scorer != nullptr && (scorer->GetScorerCode() == ScorerCode::kTtestPadj || scorer->GetScorerCode() == ScorerCode::kTtestPi) &&
+        std::ifstream(idx_dir + "/idx-log.bin").good())
+    {
+        log_map = MapFile(log_size, idx_dir + "/idx-log.bin");
+        if (log_size == mapped_mat->GetSize()) // same layout as idx-mat.bin
+        {
+            std::cerr << "[info] log-transformed count cache found in index folder, used for t-test" << std::endl;
+        }
+        else
+        {
+            std::cerr << BOLDYELLOW << "[warning]" << RESET << " log-transformed count cache not matching index-mat, not used" << std::endl;
+            UnmapFile(log_map, log_size);
+            log_map = nullptr, log_size = 0;
+        }
+    }
+    std::cerr << "Option parsing and index loading finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    inter_time = clock();
+
+    // --- Mask, filter and score in one pass ---
+    std::vector<size_t> pos_vect;
+    std::vector<double> score_vect;
+    if (k_len > kMaxKLen64)
+    {
+        ScanIndexStages<uint128_t>(pos_vect, score_vect, idx_pos, *mapped_mat, log_map, nb_smp, k_len, stranded, mask_file_path, mask_idx_path,
+                                   reverse_mask, filter_expr.get(), reverse_filter, scorer.get(), nb_thread);
+    }
+    else
+    {
+        ScanIndexStages<uint64_t>(pos_vect, score_vect, idx_pos, *mapped_mat, log_map, nb_smp, k_len, stranded, mask_file_path, mask_idx_path,
+                                  reverse_mask, filter_expr.get(), reverse_filter, scorer.get(), nb_thread);
+    }
+    idx_pos.close();
+    UnmapFile(log_map, log_size);
+    std::cerr << pos_vect.size() << " k-mers retained by mask and filter" << std::endl;
+    if (scorer != nullptr)
+    {
+        SelectTopScored(pos_vect, score_vect, *scorer, sel_top);
+        std::cerr << pos_vect.size() << " top scored k-mers selected" << std::endl;
+    }
+    std::cerr << "Mask, filter and score finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+
+    // --- Merge ---
+    const auto add_contigs = [&](auto &ctg_sink) {
+        const char *seq_start;
+        for (size_t i(0); i < pos_vect.size(); ++i)
+        {
+            const size_t seq_len = mapped_mat->GetName(seq_start, pos_vect[i]);
+            ctg_sink.AddContig(std::string(seq_start, seq_len), pos_vect[i], (scorer != nullptr ? score_vect[i] : 0));
+        }
+        mapped_mat.reset();
+        std::vector<size_t>().swap(pos_vect);
+        std::vector<double>().swap(score_vect);
+    };
+    if (nb_bucket == 0)
+    {
+        ContigStore ctg_store(k_len);
+        ctg_store.ReserveSerials(pos_vect.size());
+        add_contigs(ctg_store);
+        MergeAndPrint(ctg_store, scorer != nullptr, idx_mat, colname_vect, nb_smp, k_len, stranded, max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres,
+                      min_nbkmer, nb_thread, cache_mem, out_path, out_mode);
+    }
+    else
+    {
+        ContigSpool ctg_spool(GetMergeTmpPrefix(tmp_dir) + "input.");
+        add_contigs(ctg_spool);
+        MergeAndPrint(ctg_spool, scorer != nullptr, idx_mat, colname_vect, nb_smp, k_len, stranded, max_ovlp, min_ovlp, rep_mode, itv_mthd, itv_thres,
+                      min_nbkmer, nb_thread, max_mem, nb_bucket, tmp_dir, out_path, out_mode);
+    }
+    idx_mat.close();
+    std::cerr << "Total executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    return EXIT_SUCCESS;
+}
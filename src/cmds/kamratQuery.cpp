@@ -1,105 +1,216 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
+#include <algorithm> // std::sort, std::unique, std::lower_bound
+#include <cctype>    // isspace
 #include <fstream>
 #include <sstream>
 #include <limits>
 #include <ctime>
+#include <armadillo>
 
 #include "query_runinfo.hpp"
 #include "seq_coding.hpp"
+#include "mapped_index.hpp"
 #include "index_loading.hpp"
+#include "seq_reader.hpp"
+#include "kamratQuery.hpp"
 
 const float kMinDistance = 0, kMaxDistance = 1;
+const size_t kQueryBatchMem = 64 << 20; // bytes of count vectors fetched per batch of sequences, counted before deduplication
 
 
-void PrintHeader(const std::vector<std::string> &colname_vect)
+void PrintQueryHeader(std::ostream &res_out, const std::vector<std::string> &colname_vect, const bool as_profile)
 {
-    std::cout << colname_vect[0];
+    res_out << (as_profile ? "read\tnb-kmer\tnb-hit\tcoverage" : colname_vect[0]);
     for (size_t i(1); i < colname_vect.size(); ++i)
     {
-        std::cout << "\t" << colname_vect[i];
+        res_out << "\t" << colname_vect[i];
     }
-    std::cout << std::endl;
+    res_out << "\n";
 }
 
-void PrintQueryRes(const std::string &seq, const std::string &query_mthd,
-                   std::ifstream &idx_mat, const std::map<uint64_t, size_t> &code_pos_map,
-                   const size_t nb_smp, const size_t k_len, const bool stranded, const bool with_absent)
+/** Positions in idx-mat.bin of the k-mers composing a sequence, in sequence order,
+ * with the number of k-mers of the sequence, and the number of its bases covered by the k-mers found in the index.
+ */
+template <typename kmerCode_t>
+void CollectMemPos(std::vector<size_t> &mem_pos_vect, size_t &nb_kmer, size_t &nb_cov_base, const SeqRecord &seq_rec,
+                   const MappedIndex<kmerCode_t> &mapped_idx)
 {
-    static std::vector<size_t> mem_pos_vect;
-    static std::vector<float> count_vect;
-    const size_t seq_len = seq.size();
-    mem_pos_vect.reserve(seq_len - k_len + 1);
-    std::map<uint64_t, size_t>::const_iterator iter;
-    uint64_t kmer_code(Seq2Int(seq.substr(0, k_len), k_len, true));
-    for (size_t start_pos(0); start_pos + k_len - 1 < seq_len; ++start_pos)
-    {
-        if (((iter = code_pos_map.find(kmer_code)) != code_pos_map.cend()) ||
-            (!stranded && (iter = code_pos_map.find(GetRC(kmer_code, k_len))) != code_pos_map.cend()))
+    const size_t k_len = mapped_idx.GetKLen();
+    const bool stranded = mapped_idx.IsStranded();
+    mem_pos_vect.clear();
+    nb_kmer = 0, nb_cov_base = 0;
+    if (seq_rec.seq_len < k_len)
+    {
+        return;
+    }
+    mem_pos_vect.reserve(seq_rec.seq_len - k_len + 1);
+    KmerRoller<kmerCode_t> kmer_roller(k_len);
+    size_t pos, cov_end(0); // end of the bases covered so far
+    for (size_t i(0); i < seq_rec.seq_len; ++i)
+    {
+        if (!kmer_roller.Roll(seq_rec.seq[i]))
         {
-            mem_pos_vect.emplace_back(iter->second);
+            continue;
         }
-        if (start_pos + k_len < seq_len)
+        ++nb_kmer;
+        if (mapped_idx.FindPos(pos, kmer_roller.GetCode(stranded))) // unstranded index holds canonical codes
         {
-            kmer_code = NextCode(kmer_code, k_len, seq[start_pos + k_len]);
+            mem_pos_vect.emplace_back(pos);
+            nb_cov_base += i + 1 - std::max(cov_end, i + 1 - k_len);
+            cov_end = i + 1;
         }
     }
-    if (mem_pos_vect.empty() && with_absent)
+}
+
+/** Row head: the sequence itself, or the read name and its k-mer statistics for a per-read profile.
+ */
+void WriteRowHead(std::ostringstream &res_stream, const SeqRecord &seq_rec, const bool as_profile,
+                  const size_t nb_kmer, const size_t nb_hit, const size_t nb_cov_base)
+{
+    if (as_profile)
     {
-        std::cout << seq;
-        for (size_t i(0); i < nb_smp; ++i)
-        {
-            std::cout << "\t0";
-        }
-        std::cout << std::endl;
+        const char *name_end = std::find_if(seq_rec.name, seq_rec.name + seq_rec.name_len, [](const char c)
+                                            { return isspace(c); }); // first word of the header
+        res_stream.write(seq_rec.name, name_end - seq_rec.name);
+        res_stream << "\t" << nb_kmer << "\t" << nb_hit << "\t"
+                   << (seq_rec.seq_len == 0 ? 0 : static_cast<float>(nb_cov_base) / seq_rec.seq_len);
     }
-    else if (!mem_pos_vect.empty())
+    else
     {
-        if (query_mthd == "mean")
-        {
-            GetMeanCountVect(count_vect, idx_mat, nb_smp, mem_pos_vect);
-        }
-        else
-        {
-            GetMedianCountVect(count_vect, idx_mat, nb_smp, mem_pos_vect);
-        }
-        std::cout << seq;
-        for (const float x : count_vect)
-        {
-            std::cout << "\t" << x;
-        }
-        std::cout << std::endl;
+        res_stream.write(seq_rec.seq, seq_rec.seq_len);
     }
-    mem_pos_vect.clear();
-    count_vect.clear();
 }
 
-int QueryMain(int argc, char **argv)
+/** Query a batch of sequences and write their rows in input order.
+ * K-mers are looked up in parallel, then the count rows needed by the batch are fetched once each, in file order,
+ * and the rows of the sequences are built in parallel from the fetched counts.
+ * Per-sequence buffers are kept from one batch to the next by each calling thread, not to allocate them again for each read.
+ */
+template <typename kmerCode_t>
+void QueryBatch(std::ostream &res_out, const std::vector<SeqRecord> &seq_batch, const std::string &query_mthd,
+                const MappedIndex<kmerCode_t> &mapped_idx, const bool with_absent, const bool as_profile, const size_t nb_thread)
 {
-    QueryWelcome();
+    struct BatchBuffers
+    {
+        std::vector<std::vector<size_t>> mem_pos_batch;
+        std::vector<size_t> nb_kmer_vect, nb_cov_vect;
+        std::vector<std::string> res_batch;
+    };
+    thread_local BatchBuffers caller_buf; // buffers of the calling thread, e.g. of one served connection
+    auto &mem_pos_batch = caller_buf.mem_pos_batch; // references shared by the threads of the loops below
+    auto &nb_kmer_vect = caller_buf.nb_kmer_vect, &nb_cov_vect = caller_buf.nb_cov_vect;
+    auto &res_batch = caller_buf.res_batch;
+    const size_t nb_seq = seq_batch.size(), nb_smp = mapped_idx.GetNbSmp();
+    mem_pos_batch.resize(nb_seq), nb_kmer_vect.resize(nb_seq), nb_cov_vect.resize(nb_seq), res_batch.resize(nb_seq);
+#pragma omp parallel for schedule(dynamic, 64) num_threads(nb_thread)
+    for (size_t i_seq = 0; i_seq < nb_seq; ++i_seq)
+    {
+        CollectMemPos(mem_pos_batch[i_seq], nb_kmer_vect[i_seq], nb_cov_vect[i_seq], seq_batch[i_seq], mapped_idx);
+    }
 
-    std::clock_t begin_time = clock(), inter_time;
-    std::string idx_dir, seq_file_path, query_mtd, out_path;
-    size_t nb_smp, k_len;
-    bool stranded(true), with_absent(false);
-    std::vector<std::string> colname_vect;
-    ParseOptions(argc, argv, idx_dir, seq_file_path, query_mtd, with_absent, out_path);
-    PrintRunInfo(idx_dir, seq_file_path, query_mtd, with_absent, out_path);
+    std::vector<size_t> row_pos_vect; // distinct rows needed by the batch, in file order
+    for (size_t i_seq(0); i_seq < nb_seq; ++i_seq)
+    {
+        row_pos_vect.insert(row_pos_vect.end(), mem_pos_batch[i_seq].cbegin(), mem_pos_batch[i_seq].cend());
+    }
+    std::sort(row_pos_vect.begin(), row_pos_vect.end());
+    row_pos_vect.erase(std::unique(row_pos_vect.begin(), row_pos_vect.end()), row_pos_vect.end());
+    const size_t nb_row = row_pos_vect.size();
+    std::vector<float> row_counts(nb_row * nb_smp);
+#pragma omp parallel for num_threads(nb_thread)
+    for (size_t i_row = 0; i_row < nb_row; ++i_row)
+    {
+        mapped_idx.CopyCountVect(&row_counts[i_row * nb_smp], row_pos_vect[i_row]);
+    }
 
-    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
-    if (k_len == 0)
+#pragma omp parallel for schedule(dynamic, 64) num_threads(nb_thread)
+    for (size_t i_seq = 0; i_seq < nb_seq; ++i_seq)
     {
-        throw std::invalid_argument("KaMRaT-query relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
+        thread_local std::vector<float> count_vect;
+        thread_local arma::Mat<float> mem_kmer_counts;
+        thread_local std::ostringstream res_stream;
+        const std::vector<size_t> &mem_pos_vect = mem_pos_batch[i_seq];
+        const size_t nb_mem_kmer = mem_pos_vect.size();
+        res_stream.str("");
+        if (nb_mem_kmer == 0 && with_absent)
+        {
+            WriteRowHead(res_stream, seq_batch[i_seq], as_profile, nb_kmer_vect[i_seq], 0, 0);
+            for (size_t i(0); i < nb_smp; ++i)
+            {
+                res_stream << "\t0";
+            }
+            res_stream << "\n";
+        }
+        else if (nb_mem_kmer > 0)
+        {
+            if (query_mthd == "mean")
+            {
+                count_vect.assign(nb_smp, 0);
+            }
+            else
+            {
+                mem_kmer_counts.set_size(nb_mem_kmer, nb_smp);
+            }
+            for (size_t i_pos(0); i_pos < nb_mem_kmer; ++i_pos)
+            {
+                const size_t i_row = std::lower_bound(row_pos_vect.cbegin(), row_pos_vect.cend(), mem_pos_vect[i_pos]) - row_pos_vect.cbegin();
+                const float *count_arr = &row_counts[i_row * nb_smp];
+                if (query_mthd == "mean")
+                {
+                    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+                    {
+                        count_vect[i_smp] += count_arr[i_smp];
+                    }
+                }
+                else
+                {
+                    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+                    {
+                        mem_kmer_counts(i_pos, i_smp) = count_arr[i_smp];
+                    }
+                }
+            }
+            if (query_mthd == "mean")
+            {
+                for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+                {
+                    count_vect[i_smp] /= nb_mem_kmer;
+                }
+            }
+            else
+            {
+                count_vect = arma::conv_to<std::vector<float>>::from(arma::median(mem_kmer_counts, 0));
+            }
+            WriteRowHead(res_stream, seq_batch[i_seq], as_profile, nb_kmer_vect[i_seq], nb_mem_kmer, nb_cov_vect[i_seq]);
+            for (const float x : count_vect)
+            {
+                res_stream << "\t" << x;
+            }
+            res_stream << "\n";
+        }
+        res_batch[i_seq] = res_stream.str();
     }
-    std::map<uint64_t, size_t> code_pos_map;
-    LoadCodePosMap(code_pos_map, idx_dir + "/idx-pos.bin");
-    std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
-    if (!idx_mat.is_open())
+    for (size_t i_seq(0); i_seq < nb_seq; ++i_seq)
     {
-        throw std::invalid_argument("loading index-mat failed, KaMRaT index folder not found or may be corrupted");
+        res_out << res_batch[i_seq];
     }
+}
+
+template void QueryBatch(std::ostream &res_out, const std::vector<SeqRecord> &seq_batch, const std::string &query_mthd,
+                         const MappedIndex<uint64_t> &mapped_idx, const bool with_absent, const bool as_profile, const size_t nb_thread);
+template void QueryBatch(std::ostream &res_out, const std::vector<SeqRecord> &seq_batch, const std::string &query_mthd,
+                         const MappedIndex<uint128_t> &mapped_idx, const bool with_absent, const bool as_profile, const size_t nb_thread);
+
+/** Query all sequences of the fasta or fastq file, with k-mer codes of type kmerCode_t as in the index.
+ */
+template <typename kmerCode_t>
+void QueryIndex(const std::string &idx_dir, const std::string &seq_file_path, const std::string &query_mtd, const bool with_absent,
+                const bool as_profile, const size_t nb_thread, const std::string &out_path, const std::clock_t begin_time)
+{
+    std::clock_t inter_time;
+    const MappedIndex<kmerCode_t> mapped_idx(idx_dir); // throws if the index is not in k-mer mode
     std::cerr << "Option parsing and index loading finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
     inter_time = clock();
 
@@ -117,38 +228,20 @@ int QueryMain(int argc, char **argv)
     {
         std::cout.rdbuf(out_file.rdbuf());
     }
-    PrintHeader(colname_vect);
+    PrintQueryHeader(std::cout, mapped_idx.GetColNameVect(), as_profile);
 
-    std::ifstream seq_list_file(seq_file_path);
-    if (!seq_list_file.is_open())
-    {
-        throw std::invalid_argument("cannot open file: " + seq_file_path);
-    }
-    std::string seq, line;
-    bool is_first_line(true);
+    SeqReader seq_reader(seq_file_path); // fasta or fastq, plain or gzipped
+    const size_t row_mem = mapped_idx.GetNbSmp() * sizeof(float);
+    const size_t batch_base = std::max<size_t>(kQueryBatchMem / row_mem, 1); // each base may bring a count row
+    std::vector<SeqRecord> seq_batch;
     size_t nb_seq(0);
-    while (std::getline(seq_list_file, line))
+    while (seq_reader.NextBatch(seq_batch, batch_base))
     {
-        if (line[0] == '>') // if a header line (i.e. a new sequence)
-        {
-            if (!is_first_line)
-            {
-                PrintQueryRes(seq, query_mtd, idx_mat, code_pos_map, nb_smp, k_len, stranded, with_absent);
-                seq.clear(); // prepare for the next sequence
-                nb_seq++;
-            }
-            is_first_line = false;
-        }
-        else
-        {
-            seq += line;
-        }
+        QueryBatch(std::cout, seq_batch, query_mtd, mapped_idx, with_absent, as_profile, nb_thread);
+        nb_seq += seq_batch.size();
     }
-    PrintQueryRes(seq, query_mtd, idx_mat, code_pos_map, nb_smp, k_len, stranded, with_absent); // query the last sequence
-    seq_list_file.close();
     std::cerr << "Number of sequence for evaluation: " << nb_seq << std::endl;
 
-    idx_mat.close();
     std::cout.rdbuf(backup_buf);
     if (out_file.is_open())
     {
@@ -156,6 +249,31 @@ int QueryMain(int argc, char **argv)
     }
 
     std::cerr << "Query and print finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+}
+
+int QueryMain(int argc, char **argv)
+{
+    QueryWelcome();
+
+    std::clock_t begin_time = clock();
+    std::string idx_dir, seq_file_path, query_mtd, out_path;
+    bool with_absent(false), as_profile(false);
+    size_t nb_thread(1);
+    ParseOptions(argc, argv, idx_dir, seq_file_path, query_mtd, with_absent, as_profile, nb_thread, out_path);
+    PrintRunInfo(idx_dir, seq_file_path, query_mtd, with_absent, as_profile, nb_thread, out_path);
+
+    size_t nb_smp, k_len;
+    bool stranded;
+    std::vector<std::string> colname_vect;
+    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
+    if (k_len > kMaxKLen64) // k-mer code width is fixed once for the whole query
+    {
+        QueryIndex<uint128_t>(idx_dir, seq_file_path, query_mtd, with_absent, as_profile, nb_thread, out_path, begin_time);
+    }
+    else
+    {
+        QueryIndex<uint64_t>(idx_dir, seq_file_path, query_mtd, with_absent, as_profile, nb_thread, out_path, begin_time);
+    }
     std::cerr << "Executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
     return EXIT_SUCCESS;
 }
@@ -5,14 +5,24 @@
 #include <string>
 #include <unordered_map>
 #include <memory>
+#include <algorithm>
 #include <ctime>
+#include <map>
+#include <limits>
+#include <numeric>
+#include <cstdio>
+
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
 
 #include "rank_runinfo.hpp"
 #include "index_loading.hpp"
+#include "count_table.hpp"
 #include "feature_elem.hpp"
 #include "FeatureStreamer.hpp"
 #include "IndexRandomAccess.hpp"
 #include "scorer.hpp"
+#include "kamratRank.hpp"
 
 #define BOLDYELLOW "\033[1m\033[33m"
 #define RESET "\033[0m"
@@ -21,8 +31,11 @@ using namespace std;
 
 using featureVect_t = std::vector<std::unique_ptr<FeatureElem>>;
 
+const size_t kScoreBlockSize = 4096; // number of features scored together by batched scorers
+
 
-void ParseDesign(std::vector<std::string> &col_target_vect, const std::string &dsgn_path, const std::vector<std::string> &colname_vect)
+void ParseDesign(std::vector<std::string> &col_target_vect, std::vector<std::vector<std::string>> &col_covar_vect,
+                 const std::string &dsgn_path, const std::vector<std::string> &colname_vect)
 {
     const size_t nb_smp = colname_vect.size() - 1; // set aside the first column representing features
     
@@ -41,8 +54,10 @@ void ParseDesign(std::vector<std::string> &col_target_vect, const std::string &d
     }
 
     col_target_vect.resize(nb_smp, "");
-    std::string line, smp_name, condi("");
+    std::string line, smp_name, condi(""), covar;
+    std::vector<std::string> covar_vect;
     std::istringstream line_conv;
+    bool first_line(true);
 
     while (std::getline(dsgn_file, line))
     {
@@ -51,7 +66,19 @@ void ParseDesign(std::vector<std::string> &col_target_vect, const std::string &d
         {
             throw std::domain_error("failed in design file parsing: line " + line);
         }
+        for (covar_vect.clear(); line_conv >> covar; covar_vect.push_back(covar)) // supplementary columns as covariates
+        {
+        }
         line_conv.clear();
+        if (first_line)
+        {
+            col_covar_vect.assign(covar_vect.size(), std::vector<std::string>(nb_smp, ""));
+            first_line = false;
+        }
+        else if (covar_vect.size() != col_covar_vect.size())
+        {
+            throw std::domain_error("covariate number not consistent in design file: line " + line);
+        }
         auto iter = col_name2num.find(smp_name);
         if (iter == col_name2num.cend())
         {
@@ -59,6 +86,10 @@ void ParseDesign(std::vector<std::string> &col_target_vect, const std::string &d
             continue;
         }
         col_target_vect[iter->second] = condi;
+        for (size_t i_cov(0); i_cov < covar_vect.size(); ++i_cov)
+        {
+            col_covar_vect[i_cov][iter->second] = covar_vect[i_cov];
+        }
     }
     for (size_t i(0); i < nb_smp; ++i)
     {
@@ -79,7 +110,8 @@ void ParseDesign(std::vector<std::string> &col_target_vect, const std::string &d
  **/
 void SortFeatures(const std::vector<double> & scores, std::vector<uint64_t> & features, const ScorerCode scorer_code)
 {
-    if (scorer_code == ScorerCode::kSNR || scorer_code == ScorerCode::kPearson || scorer_code == ScorerCode::kSpearman) // decabs
+    if (scorer_code == ScorerCode::kSNR || scorer_code == ScorerCode::kLM ||
+        scorer_code == ScorerCode::kPearson || scorer_code == ScorerCode::kSpearman) // decabs
     {
         auto comp = [&scores](const uint64_t pos1, const uint64_t pos2)
             -> bool { return fabs(scores[pos1]) > fabs(scores[pos2]); };
@@ -102,6 +134,53 @@ void SortFeatures(const std::vector<double> & scores, std::vector<uint64_t> & fe
     }
 }
 
+const size_t CountTopSelect(const float sel_top, const size_t nb_features)
+{
+    size_t max_to_sel;
+    if (sel_top <= 0) max_to_sel = nb_features;
+    else if (sel_top < 0.999999) // for avoiding when sel_top == 0.999999999999
+    { max_to_sel = static_cast<size_t>(nb_features * sel_top + 0.5); }
+    else if (sel_top <= nb_features)
+    { max_to_sel = static_cast<size_t>(sel_top + 0.00005); }// for avoiding when sel_top == 0.999999999999
+    else
+    {
+        throw std::invalid_argument("number of top feature selection exceeds total feature number: " +
+                                    std::to_string(static_cast<size_t>(sel_top + 0.00005)) + ">" + std::to_string(nb_features));
+    }
+    return max_to_sel;
+}
+
+void AdjustPValueBH(std::vector<double> &pval_vect)
+{
+    const double tot = static_cast<double>(pval_vect.size());
+    for (size_t i(pval_vect.empty() ? 0 : pval_vect.size() - 1); i > 0; --i)
+    {
+        pval_vect[i - 1] = FeatureElem::AdjustScore(pval_vect[i - 1], tot / (i + 1), 0, pval_vect[i]);
+    }
+}
+
+const size_t RankTopFeatures(std::vector<double> &scores, std::vector<uint64_t> &features, const Scorer &scorer, const float sel_top)
+{
+    const size_t max_to_sel = CountTopSelect(sel_top, scores.size());
+    features.resize(scores.size());
+    std::iota(features.begin(), features.end(), 0);
+    SortFeatures(scores, features, scorer.GetScorerCode());
+    if (scorer.GetScorerCode() == ScorerCode::kTtestPadj) // BH procedure on scores gathered in rank order
+    {
+        std::vector<double> pval_vect(features.size());
+        for (size_t i(0); i < features.size(); ++i)
+        {
+            pval_vect[i] = scores[features[i]];
+        }
+        AdjustPValueBH(pval_vect);
+        for (size_t i(0); i < features.size(); ++i)
+        {
+            scores[features[i]] = pval_vect[i];
+        }
+    }
+    return max_to_sel;
+}
+
 
 void PrintHeader(const bool after_merge, const std::vector<std::string> &colname_vect, const std::string &scorer_name)
 {
@@ -206,7 +285,7 @@ void PrintAsIntermediate_features(std::vector<double> & scores, std::vector<uint
     std::vector<float> count_vect;
 
     uint64_t feature_idx = 0, idx = 0;
-    while (stream.hasNext()) {
+    while (stream.hasNext() and feature_idx < max_to_sel) {
         feature_t feature = stream.next();
 
         // If the next feature of interest is not yet reached
@@ -270,18 +349,468 @@ void PrintAsIntermediate_kmers(std::vector<double> &scores, std::vector<uint64_t
 }
 
 
+/** Parse the fold assignment file and deduce the training samples of each fold.
+ * @param fold_label_vect Fold labels, in order of first appearance in the file
+ * @param fold_train_vect For each fold, matrix sample indices (0-based) not held out by the fold
+ * @param fold_path Path to the fold assignment file, two columns: sample name, fold label
+ * @param colname_vect Matrix column names, including the first feature column
+ **/
+void ParseFolds(std::vector<std::string> &fold_label_vect, std::vector<std::vector<size_t>> &fold_train_vect,
+                const std::string &fold_path, const std::vector<std::string> &colname_vect)
+{
+    const size_t nb_smp = colname_vect.size() - 1;
+
+    std::ifstream fold_file(fold_path);
+    if (!fold_file.is_open())
+    {
+        throw std::invalid_argument("error open fold assignment file: " + fold_path);
+    }
+    std::map<std::string, size_t> col_name2num, label2fold;
+    for (size_t i(1); i <= nb_smp; ++i)
+    {
+        col_name2num.insert({colname_vect[i], i - 1});
+    }
+    std::vector<size_t> smp_fold_vect(nb_smp, std::numeric_limits<size_t>::max()); // max means not yet assigned
+    std::string line, smp_name, fold_label;
+    std::istringstream line_conv;
+    while (std::getline(fold_file, line))
+    {
+        line_conv.str(line);
+        if (!(line_conv >> smp_name >> fold_label))
+        {
+            throw std::domain_error("failed in fold assignment file parsing: line " + line);
+        }
+        line_conv.clear();
+        auto iter = col_name2num.find(smp_name);
+        if (iter == col_name2num.cend())
+        {
+            std::cerr << "[info] a sample in the fold assignment file not found in the matrix header line: " + smp_name << std::endl;
+            continue;
+        }
+        const auto &ins_fold = label2fold.insert({fold_label, fold_label_vect.size()});
+        if (ins_fold.second)
+        {
+            fold_label_vect.push_back(fold_label);
+        }
+        smp_fold_vect[iter->second] = ins_fold.first->second;
+    }
+    fold_file.close();
+    if (fold_label_vect.size() < 2)
+    {
+        throw std::domain_error("fold assignment file should define at least two folds: " + fold_path);
+    }
+    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+    {
+        if (smp_fold_vect[i_smp] == std::numeric_limits<size_t>::max())
+        {
+            throw std::invalid_argument("a column in the matrix was not assigned to a fold by the fold assignment file: " + colname_vect[i_smp + 1]);
+        }
+    }
+    fold_train_vect.assign(fold_label_vect.size(), std::vector<size_t>());
+    for (size_t i_fold(0); i_fold < fold_label_vect.size(); ++i_fold)
+    {
+        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+        {
+            if (smp_fold_vect[i_smp] != i_fold)
+            {
+                fold_train_vect[i_fold].push_back(i_smp);
+            }
+        }
+    }
+}
+
+template <typename T>
+const std::vector<T> &SubsetVect(std::vector<T> &sub_vect, const std::vector<T> &vect, const std::vector<size_t> &idx_vect)
+{
+    sub_vect.resize(idx_vect.size());
+    for (size_t i(0); i < idx_vect.size(); ++i)
+    {
+        sub_vect[i] = vect[idx_vect[i]];
+    }
+    return sub_vect;
+}
+
+/** Select the top features according to their scores, adjust p-values if needed, and print them.
+ * @param scores Score of each feature in the input order, adjusted in place for ttest.padj
+ * @return Number of features written
+ **/
+const size_t SelectAndPrint(std::vector<double> &scores, const Scorer &scorer, const float sel_top,
+                            const std::string &out_path, const bool with_counts, const bool after_merge,
+                            const std::string &idx_dir, const std::string &with_path, const std::string &count_mode,
+                            const std::vector<std::string> &colname_vect, const size_t nb_smp,
+                            IndexRandomAccess &ira, std::ifstream &idx_mat)
+{
+    std::clock_t inter_time = clock();
+    if (scorer.GetScorerCode() == ScorerCode::kTtestPadj)
+    {
+        std::cerr << "\tadjusting p-values using BH procedure..." << std::endl
+                  << std::endl;
+    }
+    // Rank the features, feature indexes being sorted according to the scores
+    std::vector<uint64_t> features;
+    const size_t max_to_sel = RankTopFeatures(scores, features, scorer, sel_top);
+    if (scorer.GetScorerCode() == ScorerCode::kTtestPadj)
+    {
+        std::cerr << "P-value adjusting finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+        inter_time = clock();
+    }
+
+    std::ofstream out_file;
+    if (!out_path.empty())
+    {
+        out_file.open(out_path);
+        if (!out_file.is_open())
+        {
+            throw std::domain_error("cannot open file: " + out_path);
+        }
+    }
+    auto backup_buf = std::cout.rdbuf();
+    if (!out_path.empty()) // output to file if a path is given, to screen if not
+    {
+        std::cout.rdbuf(out_file.rdbuf());
+    }
+    if (with_counts)
+    {
+        PrintHeader(after_merge, colname_vect, scorer.GetScorerName());
+        if (after_merge) {
+            std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
+            FeatureStreamer stream(with_path);
+            PrintWithCounts_features(scores, features, max_to_sel, stream, idx_mat, nb_smp, count_mode);
+        } else {
+            PrintWithCounts_kmers(scores, features, idx_mat, count_mode, nb_smp, max_to_sel, ira);
+        }
+    }
+    else
+    {
+        if (with_path.empty())
+            PrintAsIntermediate_kmers(scores, features, max_to_sel, ira);
+        else {
+            std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
+            FeatureStreamer stream(with_path);
+            PrintAsIntermediate_features(scores, features, max_to_sel, stream, idx_mat, nb_smp, count_mode);
+        }
+    }
+
+    std::cout.rdbuf(backup_buf);
+    if (out_file.is_open())
+    {
+        out_file.close();
+    }
+    return max_to_sel;
+}
+
+
+/** Tell whether a score ranks before another one, following the same orders as SortFeatures. **/
+inline const bool IsBetterScore(const double score1, const double score2, const ScorerCode scorer_code)
+{
+    if (scorer_code == ScorerCode::kSNR || scorer_code == ScorerCode::kLM ||
+        scorer_code == ScorerCode::kPearson || scorer_code == ScorerCode::kSpearman) // decabs
+    {
+        return fabs(score1) > fabs(score2);
+    }
+    else if (scorer_code == ScorerCode::kTtestPadj || scorer_code == ScorerCode::kEntropy) // inc
+    {
+        return score1 < score2;
+    }
+    return score1 > score2; // dec
+}
+
+struct TableRow
+{
+    double score;
+    size_t row_idx; // row number in the count table, header excluded
+};
+
+/** Open a count table, gzip-compressed or not, as the source of a stream buffer. **/
+void OpenCountTable(std::ifstream &count_tab, boost::iostreams::filtering_streambuf<boost::iostreams::input> &inbuf,
+                    const std::string &count_tab_path)
+{
+    count_tab.open(count_tab_path);
+    if (!count_tab.is_open())
+    {
+        throw std::invalid_argument("cannot open count table file: " + count_tab_path);
+    }
+    if (count_tab_path.substr(count_tab_path.size() - 2) == "gz")
+    {
+        inbuf.push(boost::iostreams::gzip_decompressor());
+    }
+    inbuf.push(count_tab);
+}
+
+/** Score features streamed from a count table, without going through an index.
+ * Rows are parsed by blocks and scored in parallel, only scores and row numbers are kept in memory
+ * (the best ones when -seltop NUM > 1 is given). Selected rows are re-read in a second scan of the table,
+ * spilled to a temporary file in table order, then copied to the output in score order.
+ **/
+int RankFromTable(const std::string &count_tab_path, const size_t nf_base, const std::string &nf_file_path,
+                  const std::string &rk_mthd, const size_t nfold, const std::string &dsgn_path,
+                  const float sel_top, const std::string &out_path)
+{
+    std::clock_t begin_time = clock(), inter_time;
+
+    std::vector<double> nf_vect;
+    if (nf_base > 0) // to compute NF, the table is scanned once more
+    {
+        std::cerr << "Computing NF..." << std::endl;
+        std::ifstream count_tab;
+        boost::iostreams::filtering_streambuf<boost::iostreams::input> inbuf;
+        OpenCountTable(count_tab, inbuf, count_tab_path);
+        std::istream kmer_count_instream(&inbuf);
+        ComputeNF(nf_vect, kmer_count_instream, nf_base);
+        count_tab.close();
+    }
+    else if (!nf_file_path.empty()) // to load NF
+    {
+        std::cerr << "Loading NF..." << std::endl;
+        LoadNF(nf_vect, nf_file_path);
+    }
+
+    std::string line_str, term, ft_name;
+    std::vector<std::string> colname_vect;
+    size_t nb_smp;
+    {
+        std::ifstream count_tab;
+        boost::iostreams::filtering_streambuf<boost::iostreams::input> inbuf;
+        OpenCountTable(count_tab, inbuf, count_tab_path);
+        std::istream kmer_count_instream(&inbuf);
+        std::getline(kmer_count_instream, line_str); // header row
+        nb_smp = CountColumn(line_str);
+        std::istringstream conv(line_str);
+        while (conv >> term)
+        {
+            colname_vect.push_back(term);
+        }
+        count_tab.close();
+    }
+    if (!nf_vect.empty() && nf_vect.size() != nb_smp)
+    {
+        throw std::length_error("normalization factor number not consistent with sample number: " + std::to_string(nf_vect.size()) + " vs " + std::to_string(nb_smp));
+    }
+    auto parse_row = [&nf_vect, nb_smp](std::string &ft_name, std::vector<float> &count_vect, const std::string &line_str) {
+        ParseCountRow(ft_name, count_vect, line_str);
+        if (count_vect.size() != nb_smp)
+        {
+            throw std::length_error("sample numbers are not consistent: " + std::to_string(nb_smp) + " vs " + std::to_string(count_vect.size()));
+        }
+        for (size_t i_smp(0); i_smp < nf_vect.size(); ++i_smp)
+        {
+            count_vect[i_smp] *= nf_vect[i_smp];
+        }
+    };
+
+    std::vector<std::string> col_target_vect;
+    std::vector<std::vector<std::string>> col_covar_vect;
+    if (rk_mthd != "sd" && rk_mthd != "rsd1" && rk_mthd != "rsd2" && rk_mthd != "rsd3" && rk_mthd != "entropy")
+    {
+        ParseDesign(col_target_vect, col_covar_vect, dsgn_path, colname_vect);
+    }
+    const Scorer scorer(rk_mthd, nfold, col_target_vect, col_covar_vect);
+    const ScorerCode scorer_code = scorer.GetScorerCode();
+
+    const size_t max_to_keep = (sel_top >= 0.999999 ? static_cast<size_t>(sel_top + 0.00005) : std::numeric_limits<size_t>::max());
+    auto is_worse_row = [scorer_code](const TableRow &row1, const TableRow &row2)
+        -> bool { return IsBetterScore(row1.score, row2.score, scorer_code); }; // heap top is the worst kept row
+
+    std::cerr << "Option parsing and metadata loading finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    inter_time = clock();
+
+    std::ifstream count_tab;
+    boost::iostreams::filtering_streambuf<boost::iostreams::input> inbuf;
+    OpenCountTable(count_tab, inbuf, count_tab_path);
+    std::istream kmer_count_instream(&inbuf);
+    std::getline(kmer_count_instream, line_str); // header row
+
+    std::vector<std::vector<float>> count_vect_block(kScoreBlockSize);
+    std::vector<TableRow> top_rows;
+    std::vector<double> score_block, all_scores; // all scores are only needed for p-value adjustment
+    arma::Mat<double> count_block;
+    if (scorer_code == ScorerCode::kLM)
+    {
+        count_block.set_size(nb_smp, kScoreBlockSize);
+    }
+    size_t nb_features(0), nb_in_block(0);
+    bool to_continue(true);
+    while (to_continue)
+    {
+        for (nb_in_block = 0; nb_in_block < kScoreBlockSize && std::getline(kmer_count_instream, line_str); ++nb_in_block)
+        {
+            parse_row(ft_name, count_vect_block[nb_in_block], line_str);
+        }
+        to_continue = (nb_in_block == kScoreBlockSize);
+
+        score_block.clear();
+        if (scorer_code == ScorerCode::kLM) // batched scorer
+        {
+            for (size_t i(0); i < nb_in_block; ++i)
+            {
+                std::copy(count_vect_block[i].cbegin(), count_vect_block[i].cend(), count_block.colptr(i));
+            }
+            if (nb_in_block > 0)
+            {
+                scorer.EstimateScoreBlock(score_block, count_block.head_cols(nb_in_block));
+            }
+        }
+        else
+        {
+            score_block.resize(nb_in_block);
+#pragma omp parallel for schedule(dynamic, 64)
+            for (size_t i = 0; i < nb_in_block; ++i) // some scorers reorder the vector, which is not reused
+            {
+                score_block[i] = scorer.EstimateScore(count_vect_block[i]);
+            }
+        }
+
+        for (size_t i(0); i < nb_in_block; ++i)
+        {
+            const TableRow row{score_block[i], nb_features + i};
+            if (scorer_code == ScorerCode::kTtestPadj)
+            {
+                all_scores.push_back(row.score);
+            }
+            if (top_rows.size() < max_to_keep)
+            {
+                top_rows.push_back(row);
+                std::push_heap(top_rows.begin(), top_rows.end(), is_worse_row);
+            }
+            else if (IsBetterScore(row.score, top_rows.front().score, scorer_code))
+            {
+                std::pop_heap(top_rows.begin(), top_rows.end(), is_worse_row);
+                top_rows.back() = row;
+                std::push_heap(top_rows.begin(), top_rows.end(), is_worse_row);
+            }
+        }
+        nb_features += nb_in_block;
+    }
+    count_tab.close();
+
+    std::cerr << "Score evalution finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    inter_time = clock();
+
+    const size_t max_to_sel = CountTopSelect(sel_top, nb_features);
+    std::sort_heap(top_rows.begin(), top_rows.end(), is_worse_row); // best first
+    top_rows.resize(max_to_sel);
+
+    if (scorer_code == ScorerCode::kTtestPadj) // BH procedure, same as on indexed features
+    {
+        std::cerr << "\tadjusting p-values using BH procedure..." << std::endl
+                  << std::endl;
+        std::sort(all_scores.begin(), all_scores.end());
+        AdjustPValueBH(all_scores);
+        for (size_t i(0); i < top_rows.size(); ++i)
+        {
+            top_rows[i].score = all_scores[i];
+        }
+        std::cerr << "P-value adjusting finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+        inter_time = clock();
+    }
+    std::vector<double>().swap(all_scores);
+
+    // Second scan: selected rows are formatted in table order into a spill file, keeping their place by rank
+    std::vector<std::pair<size_t, size_t>> sel_row_vect; // row number, rank
+    sel_row_vect.reserve(top_rows.size());
+    for (size_t i(0); i < top_rows.size(); ++i)
+    {
+        sel_row_vect.emplace_back(top_rows[i].row_idx, i);
+    }
+    std::sort(sel_row_vect.begin(), sel_row_vect.end());
+    std::unique_ptr<FILE, int (*)(FILE *)> spill_file(std::tmpfile(), &std::fclose);
+    if (spill_file == nullptr)
+    {
+        throw std::domain_error("cannot create temporary file for selected rows");
+    }
+    std::vector<std::pair<long, size_t>> spill_pos_vect(top_rows.size()); // offset and length of each selected row, by rank
+    {
+        std::ifstream count_tab;
+        boost::iostreams::filtering_streambuf<boost::iostreams::input> inbuf;
+        OpenCountTable(count_tab, inbuf, count_tab_path);
+        std::istream kmer_count_instream(&inbuf);
+        std::getline(kmer_count_instream, line_str); // header row
+        std::vector<float> count_vect;
+        std::ostringstream row_conv;
+        long spill_pos(0);
+        for (size_t row_idx(0), i_sel(0); i_sel < sel_row_vect.size() && std::getline(kmer_count_instream, line_str); ++row_idx)
+        {
+            if (row_idx != sel_row_vect[i_sel].first)
+            {
+                continue;
+            }
+            const size_t rank = sel_row_vect[i_sel++].second;
+            parse_row(ft_name, count_vect, line_str);
+            row_conv.str("");
+            row_conv << ft_name << "\t" << top_rows[rank].score;
+            for (float x : count_vect)
+            {
+                row_conv << "\t" << x;
+            }
+            row_conv << "\n";
+            const std::string &row_str = row_conv.str();
+            if (std::fwrite(row_str.data(), 1, row_str.size(), spill_file.get()) != row_str.size())
+            {
+                throw std::domain_error("failed in writing selected rows to temporary file");
+            }
+            spill_pos_vect[rank] = {spill_pos, row_str.size()};
+            spill_pos += row_str.size();
+        }
+        count_tab.close();
+    }
+
+    std::ofstream out_file;
+    if (!out_path.empty())
+    {
+        out_file.open(out_path);
+        if (!out_file.is_open())
+        {
+            throw std::domain_error("cannot open file: " + out_path);
+        }
+    }
+    auto backup_buf = std::cout.rdbuf();
+    if (!out_path.empty()) // output to file if a path is given, to screen if not
+    {
+        std::cout.rdbuf(out_file.rdbuf());
+    }
+    PrintHeader(false, colname_vect, scorer.GetScorerName());
+    std::vector<char> row_buf;
+    for (const auto &spill_pos : spill_pos_vect)
+    {
+        row_buf.resize(spill_pos.second);
+        if (std::fseek(spill_file.get(), spill_pos.first, SEEK_SET) != 0 ||
+            std::fread(row_buf.data(), 1, row_buf.size(), spill_file.get()) != row_buf.size())
+        {
+            throw std::domain_error("failed in reading selected rows from temporary file");
+        }
+        std::cout.write(row_buf.data(), row_buf.size());
+    }
+    std::cout.flush();
+    std::cout.rdbuf(backup_buf);
+    if (out_file.is_open())
+    {
+        out_file.close();
+    }
+
+    std::cerr << max_to_sel << " features have been written." << std::endl;
+    std::cerr << "Output finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    std::cerr << "Executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+
 int RankMain(int argc, char *argv[])
 {
     RankWelcome();
 
     std::clock_t begin_time = clock(), inter_time;
-    std::string idx_dir, rk_mthd, with_path, count_mode("rep"), dsgn_path, out_path;
+    std::string idx_dir, count_tab_path, nf_file_path, rk_mthd, with_path, count_mode("rep"), dsgn_path, fold_path, out_path;
     float sel_top(-1); // negative value means without selection, print all features
-    size_t nfold, nb_smp, k_len, max_to_sel;
+    size_t nfold, nb_smp, k_len, nf_base(0);
     bool with_counts(false), after_merge(false), _stranded; // _stranded not needed in KaMRaT-rank
     std::vector<std::string> colname_vect;
-    ParseOptions(argc, argv, idx_dir, rk_mthd, nfold, with_path, count_mode, dsgn_path, sel_top, out_path, with_counts);
-    PrintRunInfo(idx_dir, rk_mthd, nfold, with_path, count_mode, dsgn_path, sel_top, out_path, with_counts);
+    ParseOptions(argc, argv, idx_dir, count_tab_path, nf_base, nf_file_path, rk_mthd, nfold, with_path, count_mode, dsgn_path, fold_path, sel_top, out_path, with_counts);
+    PrintRunInfo(idx_dir, count_tab_path, nf_base, nf_file_path, rk_mthd, nfold, with_path, count_mode, dsgn_path, fold_path, sel_top, out_path, with_counts);
+    if (!count_tab_path.empty())
+    {
+        return RankFromTable(count_tab_path, nf_base, nf_file_path, rk_mthd, nfold, dsgn_path, sel_top, out_path);
+    }
     LoadIndexMeta(nb_smp, k_len, _stranded, colname_vect, idx_dir + "/idx-meta.bin");
 
     IndexRandomAccess ira(idx_dir + "/idx-pos.bin", idx_dir + "/idx-mat.bin", idx_dir + "/idx-meta.bin");
@@ -306,111 +835,158 @@ int RankMain(int argc, char *argv[])
     inter_time = clock();
 
     std::vector<std::string> col_target_vect;
+    std::vector<std::vector<std::string>> col_covar_vect;
     if (rk_mthd != "sd" && rk_mthd != "rsd1" && rk_mthd != "rsd2" && rk_mthd != "rsd3" && rk_mthd != "entropy")
     {
-        ParseDesign(col_target_vect, dsgn_path, colname_vect);
+        ParseDesign(col_target_vect, col_covar_vect, dsgn_path, colname_vect);
     }
-    Scorer scorer(rk_mthd, nfold, col_target_vect);
-
-    // Load and score all the usefull features
-    size_t nb_features = 0;
-    std::vector<float> count_vect;
-    vector<double> scores;
-    while (stream.hasNext()) {
-        feature_t feature = stream.next();
-        feature->EstimateCountVect(count_vect, idx_mat, nb_smp, count_mode);
-        double score = scorer.EstimateScore(count_vect);
-        scores.push_back(score);
 
-        nb_features += 1;
+    // Cross-validation folds: one scorer per training set, all fed by the same scan of the features,
+    // the scorer on all samples is only built without folds
+    std::unique_ptr<Scorer> scorer;
+    std::vector<std::string> fold_label_vect;
+    std::vector<std::vector<size_t>> fold_train_vect;
+    std::vector<Scorer> fold_scorer_vect;
+    if (fold_path.empty())
+    {
+        scorer.reset(new Scorer(rk_mthd, nfold, col_target_vect, col_covar_vect));
     }
-
-    // Postprocess variables
-    after_merge = stream.merged_features;
-    if (sel_top <= 0) max_to_sel = scores.size();
-    else if (sel_top < 0.999999) // for avoiding when sel_top == 0.999999999999
-    { max_to_sel = static_cast<size_t>(scores.size() * sel_top + 0.5); }
-    else if (sel_top <= scores.size())
-    { max_to_sel = static_cast<size_t>(sel_top + 0.00005); }// for avoiding when sel_top == 0.999999999999
     else
     {
-        throw std::invalid_argument("number of top feature selection exceeds total feature number: " +
-                                    std::to_string(static_cast<size_t>(sel_top + 0.00005)) + ">" + std::to_string(scores.size()));
+        ParseFolds(fold_label_vect, fold_train_vect, fold_path, colname_vect);
+        fold_scorer_vect.reserve(fold_label_vect.size());
+        std::vector<std::string> fold_target_vect;
+        std::vector<std::vector<std::string>> fold_covar_vect(col_covar_vect.size());
+        for (const auto &train_idx_vect : fold_train_vect)
+        {
+            if (!col_target_vect.empty())
+            {
+                SubsetVect(fold_target_vect, col_target_vect, train_idx_vect);
+            }
+            for (size_t i_cov(0); i_cov < col_covar_vect.size(); ++i_cov)
+            {
+                SubsetVect(fold_covar_vect[i_cov], col_covar_vect[i_cov], train_idx_vect);
+            }
+            fold_scorer_vect.emplace_back(rk_mthd, nfold, fold_target_vect, fold_covar_vect);
+        }
     }
+    const ScorerCode scorer_code = (scorer ? scorer->GetScorerCode() : fold_scorer_vect.front().GetScorerCode());
 
-    // Fill a vector that will be sorted acording the scores
-    std::vector<uint64_t> features(nb_features) ;
-    std::iota (std::begin(features), std::end(features), 0); // Fill with 0, 1, ..., 99...
-    
-    // Rank the features
-    SortFeatures(scores, features, scorer.GetScorerCode());
-
-    std::cerr << "Score evalution finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
-    inter_time = clock();
-
-    double tot = static_cast<double>(features.size());
-    if (scorer.GetScorerCode() == ScorerCode::kTtestPadj) // BH procedure
+    // Log2(x + 1) counts cached by kamrat index -logcache, only valid for features counted by a single k-mer
+    std::ifstream idx_log;
+    if (scorer_code == ScorerCode::kTtestPadj || scorer_code == ScorerCode::kTtestPi)
     {
-        std::cerr << "\tadjusting p-values using BH procedure..." << std::endl
-                  << std::endl;
-        for (size_t i(features.size() - 1); i > 0; --i)
+        idx_log.open(idx_dir + "/idx-log.bin");
+        if (idx_log.is_open())
         {
-            uint64_t i_score = features[i-1];
-            uint64_t i1_score = features[i];
-
-            scores[i_score] = FeatureElem::AdjustScore(
-                scores[i_score],
-                tot / (i + 1),
-                0, scores[i1_score]
-            );
-
+            std::cerr << "[info] log-transformed count cache found in index folder, used for t-test" << std::endl;
         }
-        std::cerr << "P-value adjusting finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
-        inter_time = clock();
     }
+    bool from_log(false);
 
-    std::ofstream out_file;
-    if (!out_path.empty())
+    // Load and score all the usefull features
+    size_t nb_features = 0;
+    std::vector<float> count_vect;
+    vector<double> scores;
+    std::vector<std::vector<double>> fold_scores(fold_scorer_vect.size());
+    if (!fold_scorer_vect.empty() && scorer_code == ScorerCode::kLM) // batched scorer: one block of training columns per fold
     {
-        out_file.open(out_path);
-        if (!out_file.is_open())
+        std::vector<arma::Mat<double>> fold_block_vect;
+        for (const auto &train_idx_vect : fold_train_vect)
         {
-            throw std::domain_error("cannot open file: " + out_path);
+            fold_block_vect.emplace_back(train_idx_vect.size(), kScoreBlockSize);
+        }
+        size_t nb_in_block(0);
+        while (stream.hasNext()) {
+            feature_t feature = stream.next();
+            feature->EstimateCountVect(count_vect, idx_mat, nb_smp, count_mode);
+            for (size_t i_fold(0); i_fold < fold_scorer_vect.size(); ++i_fold) {
+                const std::vector<size_t> &train_idx_vect = fold_train_vect[i_fold];
+                double *fold_col = fold_block_vect[i_fold].colptr(nb_in_block);
+                for (size_t i(0); i < train_idx_vect.size(); ++i) {
+                    fold_col[i] = count_vect[train_idx_vect[i]];
+                }
+            }
+            if (++nb_in_block == kScoreBlockSize) {
+                for (size_t i_fold(0); i_fold < fold_scorer_vect.size(); ++i_fold) {
+                    fold_scorer_vect[i_fold].EstimateScoreBlock(fold_scores[i_fold], fold_block_vect[i_fold]);
+                }
+                nb_in_block = 0;
+            }
+            nb_features += 1;
+        }
+        for (size_t i_fold(0); i_fold < fold_scorer_vect.size() && nb_in_block > 0; ++i_fold) {
+            fold_scorer_vect[i_fold].EstimateScoreBlock(fold_scores[i_fold], fold_block_vect[i_fold].head_cols(nb_in_block));
         }
     }
-    auto backup_buf = std::cout.rdbuf();
-    if (!out_path.empty()) // output to file if a path is given, to screen if not
+    else if (!fold_scorer_vect.empty())
     {
-        std::cout.rdbuf(out_file.rdbuf());
+        std::vector<float> fold_count_vect;
+        while (stream.hasNext()) {
+            feature_t feature = stream.next();
+            from_log = (idx_log.is_open() && (count_mode == "rep" || feature->GetNbMemPos() == 1));
+            feature->EstimateCountVect(count_vect, (from_log ? idx_log : idx_mat), nb_smp, count_mode);
+            for (size_t i_fold(0); i_fold < fold_scorer_vect.size(); ++i_fold) {
+                SubsetVect(fold_count_vect, count_vect, fold_train_vect[i_fold]);
+                fold_scores[i_fold].push_back(from_log ? fold_scorer_vect[i_fold].EstimateScoreFromLog(fold_count_vect)
+                                                       : fold_scorer_vect[i_fold].EstimateScore(fold_count_vect));
+            }
+            nb_features += 1;
+        }
     }
-    if (with_counts)
+    else if (scorer_code == ScorerCode::kLM) // batched scorer: features are scored by blocks of columns
     {
-        PrintHeader(after_merge, colname_vect, scorer.GetScorerName());
-        if (after_merge) {
-            std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
-            FeatureStreamer stream(with_path);
-            PrintWithCounts_features(scores, features, max_to_sel, stream, idx_mat, nb_smp, count_mode);
-        } else {
-            PrintWithCounts_kmers(scores, features, idx_mat, count_mode, nb_smp, max_to_sel, ira);
+        arma::Mat<double> count_block(nb_smp, kScoreBlockSize);
+        size_t nb_in_block(0);
+        while (stream.hasNext()) {
+            feature_t feature = stream.next();
+            feature->EstimateCountVect(count_vect, idx_mat, nb_smp, count_mode);
+            std::copy(count_vect.cbegin(), count_vect.cend(), count_block.colptr(nb_in_block));
+            if (++nb_in_block == kScoreBlockSize) {
+                scorer->EstimateScoreBlock(scores, count_block);
+                nb_in_block = 0;
+            }
+            nb_features += 1;
+        }
+        if (nb_in_block > 0) {
+            scorer->EstimateScoreBlock(scores, count_block.head_cols(nb_in_block));
         }
     }
     else
     {
-        if (with_path.empty())
-            PrintAsIntermediate_kmers(scores, features, max_to_sel, ira);
-        else {
-            std::ifstream idx_mat(idx_dir + "/idx-mat.bin");
-            FeatureStreamer stream(with_path);
-            PrintAsIntermediate_features(scores, features, max_to_sel, stream, idx_mat, nb_smp, count_mode);
+        while (stream.hasNext()) {
+            feature_t feature = stream.next();
+            from_log = (idx_log.is_open() && (count_mode == "rep" || feature->GetNbMemPos() == 1));
+            feature->EstimateCountVect(count_vect, (from_log ? idx_log : idx_mat), nb_smp, count_mode);
+            double score = (from_log ? scorer->EstimateScoreFromLog(count_vect) : scorer->EstimateScore(count_vect));
+            scores.push_back(score);
+
+            nb_features += 1;
         }
     }
-    idx_mat.close();
+    after_merge = stream.merged_features;
+    if (idx_log.is_open())
+    {
+        idx_log.close();
+    }
 
-    std::cout.rdbuf(backup_buf);
-    if (out_file.is_open())
+    std::cerr << "Score evalution finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
+    inter_time = clock();
+
+    size_t max_to_sel(0);
+    if (scorer)
     {
-        out_file.close();
+        max_to_sel = SelectAndPrint(scores, *scorer, sel_top, out_path, with_counts, after_merge,
+                                    idx_dir, with_path, count_mode, colname_vect, nb_smp, ira, idx_mat);
     }
+    for (size_t i_fold(0); i_fold < fold_scorer_vect.size(); ++i_fold) // one output per fold, named after the fold label
+    {
+        std::cerr << "Fold " << fold_label_vect[i_fold] << ": " << fold_train_vect[i_fold].size() << " training samples" << std::endl;
+        max_to_sel += SelectAndPrint(fold_scores[i_fold], fold_scorer_vect[i_fold], sel_top, out_path + "." + fold_label_vect[i_fold],
+                                     with_counts, after_merge, idx_dir, with_path, count_mode, colname_vect, nb_smp, ira, idx_mat);
+    }
+    idx_mat.close();
+
     std::cerr << max_to_sel << " features have been written." << std::endl;
     std::cerr << "Output finished, execution time: " << (float)(clock() - inter_time) / CLOCKS_PER_SEC << "s." << std::endl;
     std::cerr << "Executing time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
@@ -0,0 +1,211 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <ctime>
+#include <cstdio>      // FILE, getline
+#include <cstring>     // memset
+#include <cerrno>
+#include <csignal>     // SIGPIPE, SIGINT, SIGTERM
+#include <sys/socket.h>
+#include <sys/un.h>    // sockaddr_un
+#include <sys/stat.h>  // stat, S_ISSOCK
+#include <unistd.h>    // unlink, dup, close
+
+#include "serve_runinfo.hpp"
+#include "seq_coding.hpp"
+#include "mapped_index.hpp"
+#include "index_loading.hpp"
+#include "seq_reader.hpp"
+#include "kamratQuery.hpp"
+
+const std::string kEndOfBatch = "//";
+
+static std::string socket_path_to_remove; // for removing the socket file when the server is stopped
+
+void StopServer(int)
+{
+    unlink(socket_path_to_remove.c_str());
+    _exit(EXIT_SUCCESS);
+}
+
+/** Answer the batches of one client until the end of its input, returning the number of queried sequences.
+ * A batch is a list of fasta records ended by a line "//", or by the end of input;
+ * its response is the header line and the query rows as by kamrat query, ended by a line "//".
+ */
+template <typename kmerCode_t>
+const size_t ServeRequests(FILE *req_file, FILE *res_file, const std::string &query_mtd,
+                           const MappedIndex<kmerCode_t> &mapped_idx, const bool with_absent, const bool as_profile,
+                           const size_t nb_thread)
+{
+    std::ostringstream res_stream;
+    std::string line;
+    std::vector<std::string> name_batch, seq_batch; // records of the current batch
+    std::vector<SeqRecord> rec_batch;
+    bool in_batch(false);
+    size_t nb_seq(0);
+    char *line_buf(nullptr);
+    size_t buf_size(0);
+    ssize_t line_len;
+    while (true)
+    {
+        line_len = getline(&line_buf, &buf_size, req_file);
+        if (line_len < 0 && !in_batch)
+        {
+            break;
+        }
+        if (line_len >= 0)
+        {
+            while (line_len > 0 && (line_buf[line_len - 1] == '\n' || line_buf[line_len - 1] == '\r'))
+            {
+                --line_len;
+            }
+            line.assign(line_buf, line_len);
+            if (line.empty() && !in_batch) // blank lines between batches
+            {
+                continue;
+            }
+        }
+        if (!in_batch)
+        {
+            PrintQueryHeader(res_stream, mapped_idx.GetColNameVect(), as_profile);
+            name_batch.clear(), seq_batch.clear();
+            in_batch = true;
+        }
+        if (line_len >= 0 && !line.empty() && line[0] == '>') // a new record
+        {
+            name_batch.emplace_back(line, 1);
+            seq_batch.emplace_back();
+        }
+        else if (line_len >= 0 && line != kEndOfBatch && !seq_batch.empty())
+        {
+            seq_batch.back() += line;
+        }
+        if (line_len < 0 || line == kEndOfBatch) // end of a batch
+        {
+            rec_batch.clear();
+            for (size_t i(0); i < seq_batch.size(); ++i)
+            {
+                rec_batch.push_back({name_batch[i].data(), name_batch[i].size(), seq_batch[i].data(), seq_batch[i].size()});
+            }
+            QueryBatch(res_stream, rec_batch, query_mtd, mapped_idx, with_absent, as_profile, nb_thread);
+            nb_seq += rec_batch.size();
+            res_stream << kEndOfBatch << "\n";
+            const std::string res_str = res_stream.str();
+            if (fwrite(res_str.data(), 1, res_str.size(), res_file) != res_str.size() || fflush(res_file) != 0)
+            {
+                break; // client gone
+            }
+            res_stream.str("");
+            in_batch = false;
+            if (line_len < 0)
+            {
+                break;
+            }
+        }
+    }
+    free(line_buf);
+    return nb_seq;
+}
+
+const int OpenSocket(const std::string &socket_path)
+{
+    struct sockaddr_un addr;
+    if (socket_path.size() >= sizeof(addr.sun_path))
+    {
+        throw std::length_error("socket path too long: " + socket_path);
+    }
+    struct stat file_stat;
+    if (stat(socket_path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) // stale socket of a previous server
+    {
+        unlink(socket_path.c_str());
+    }
+    const int socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    socket_path.copy(addr.sun_path, socket_path.size());
+    if (socket_fd < 0 || bind(socket_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        listen(socket_fd, SOMAXCONN) != 0)
+    {
+        throw std::domain_error("cannot listen on socket: " + socket_path);
+    }
+    return socket_fd;
+}
+
+/** Serve the queries on stdin, or on the socket if a path is given, with k-mer codes of type kmerCode_t as in the index.
+ */
+template <typename kmerCode_t>
+int ServeIndex(const std::string &idx_dir, const std::string &query_mtd, const bool with_absent, const bool as_profile,
+               const std::string &socket_path, const size_t nb_thread, const std::clock_t begin_time)
+{
+    const MappedIndex<kmerCode_t> mapped_idx(idx_dir);
+    std::cerr << "Option parsing and index mapping finished, execution time: " << (float)(clock() - begin_time) / CLOCKS_PER_SEC << "s." << std::endl;
+
+    if (socket_path.empty())
+    {
+        const size_t nb_seq = ServeRequests(stdin, stdout, query_mtd, mapped_idx, with_absent, as_profile, nb_thread);
+        std::cerr << "Number of sequence for evaluation: " << nb_seq << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    const int socket_fd = OpenSocket(socket_path);
+    socket_path_to_remove = socket_path;
+    signal(SIGPIPE, SIG_IGN); // a client closing its connection early should not stop the server
+    signal(SIGINT, StopServer);
+    signal(SIGTERM, StopServer);
+    std::cerr << "Listening on " << socket_path << "..." << std::endl;
+#pragma omp parallel num_threads(nb_thread)
+    while (true) // each thread serves one connection at a time
+    {
+        const int conn_fd = accept(socket_fd, nullptr, nullptr);
+        if (conn_fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            break;
+        }
+        const int res_fd = dup(conn_fd);
+        FILE *req_file = fdopen(conn_fd, "r"), *res_file = (res_fd < 0 ? nullptr : fdopen(res_fd, "w")); // both close their own descriptor
+        if (req_file == nullptr || res_file == nullptr) // each end closed through its stream if opened, directly otherwise
+        {
+            std::cerr << "cannot open connection streams, connection dropped" << std::endl;
+            (req_file != nullptr ? fclose(req_file) : close(conn_fd));
+            if (res_file != nullptr)
+            {
+                fclose(res_file);
+            }
+            else if (res_fd >= 0)
+            {
+                close(res_fd);
+            }
+            continue;
+        }
+        ServeRequests(req_file, res_file, query_mtd, mapped_idx, with_absent, as_profile, 1); // one thread per connection
+        fclose(res_file);
+        fclose(req_file);
+    }
+    close(socket_fd);
+    unlink(socket_path.c_str());
+    return EXIT_FAILURE; // only reached if the socket fails
+}
+
+int ServeMain(int argc, char *argv[])
+{
+    ServeWelcome();
+
+    std::clock_t begin_time = clock();
+    std::string idx_dir, query_mtd, socket_path;
+    bool with_absent(false), as_profile(false);
+    size_t nb_thread(1);
+    ParseOptions(argc, argv, idx_dir, query_mtd, with_absent, as_profile, socket_path, nb_thread);
+    PrintRunInfo(idx_dir, query_mtd, with_absent, as_profile, socket_path, nb_thread);
+
+    size_t nb_smp, k_len;
+    bool stranded;
+    std::vector<std::string> colname_vect;
+    LoadIndexMeta(nb_smp, k_len, stranded, colname_vect, idx_dir + "/idx-meta.bin");
+    return (k_len > kMaxKLen64 ? ServeIndex<uint128_t>(idx_dir, query_mtd, with_absent, as_profile, socket_path, nb_thread, begin_time)
+                               : ServeIndex<uint64_t>(idx_dir, query_mtd, with_absent, as_profile, socket_path, nb_thread, begin_time));
+}
@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include "bucket_files.hpp"
+#include "contig_store.hpp"
+
+const size_t kBufferSize = 8192; // bytes buffered per bucket before being written
+
+BucketFiles::Buffer::Buffer(BucketFiles &bucket_files)
+    : bucket_files_(bucket_files), buffer_vect_(bucket_files.GetNbBucket())
+{
+}
+
+BucketFiles::Buffer::~Buffer()
+{
+    Flush();
+}
+
+void BucketFiles::Buffer::Append(const size_t i_bucket, const char *record, const size_t record_size)
+{
+    auto &buffer = buffer_vect_[i_bucket];
+    const uint32_t frame = record_size;
+    buffer.insert(buffer.end(), reinterpret_cast<const char *>(&frame), reinterpret_cast<const char *>(&frame) + sizeof(uint32_t));
+    buffer.insert(buffer.end(), record, record + record_size);
+    if (buffer.size() >= kBufferSize)
+    {
+        bucket_files_.Write(i_bucket, buffer);
+        buffer.clear();
+    }
+}
+
+void BucketFiles::Buffer::Flush()
+{
+    for (size_t i_bucket(0); i_bucket < buffer_vect_.size(); ++i_bucket)
+    {
+        if (!buffer_vect_[i_bucket].empty())
+        {
+            bucket_files_.Write(i_bucket, buffer_vect_[i_bucket]);
+            buffer_vect_[i_bucket].clear();
+        }
+    }
+}
+
+BucketFiles::BucketFiles(const std::string &path_prefix, const size_t nb_bucket)
+    : path_prefix_(path_prefix), size_vect_(nb_bucket, 0)
+{
+}
+
+BucketFiles::~BucketFiles()
+{
+    for (size_t i_bucket(0); i_bucket < size_vect_.size(); ++i_bucket)
+    {
+        std::remove(GetPath(i_bucket).c_str());
+    }
+}
+
+const size_t BucketFiles::GetNbBucket() const
+{
+    return size_vect_.size();
+}
+
+const std::string &BucketFiles::GetPathPrefix() const
+{
+    return path_prefix_;
+}
+
+const size_t BucketFiles::GetBucketSize(const size_t i_bucket) const
+{
+    return size_vect_[i_bucket];
+}
+
+void BucketFiles::Load(std::vector<char> &data, const size_t i_bucket)
+{
+    data.resize(size_vect_[i_bucket]);
+    if (!data.empty())
+    {
+        std::ifstream bucket_file(GetPath(i_bucket), std::ios::binary);
+        if (!bucket_file.read(data.data(), data.size()))
+        {
+            throw std::domain_error("truncated bucket file: " + GetPath(i_bucket));
+        }
+    }
+    std::remove(GetPath(i_bucket).c_str());
+}
+
+const std::string BucketFiles::GetPath(const size_t i_bucket) const
+{
+    return path_prefix_ + std::to_string(i_bucket) + ".bin";
+}
+
+void BucketFiles::Write(const size_t i_bucket, const std::vector<char> &data)
+{
+    bool is_written;
+#pragma omp critical(bucket_files_write) // buckets may be appended by several threads
+    {
+        std::ofstream bucket_file(GetPath(i_bucket), std::ios::binary | std::ios::app);
+        is_written = static_cast<bool>(bucket_file.write(data.data(), data.size()));
+        size_vect_[i_bucket] += data.size();
+    }
+    if (!is_written)
+    {
+        throw std::domain_error("cannot write file: " + GetPath(i_bucket));
+    }
+}
+
+ContigSpool::ContigSpool(const std::string &path_prefix)
+    : bucket_files_(path_prefix, 1), buffer_(bucket_files_), nb_ctg_(0)
+{
+}
+
+void ContigSpool::AddContig(const std::string &seq, const size_t pos, const float val)
+{
+    ContigStore::WriteInputContig(record_, seq, pos, val, nb_ctg_++);
+    buffer_.Append(0, record_.data(), record_.size());
+}
+
+const size_t ContigSpool::GetNbContig() const
+{
+    return nb_ctg_;
+}
+
+BucketFiles &ContigSpool::GetBucketFiles()
+{
+    buffer_.Flush();
+    return bucket_files_;
+}
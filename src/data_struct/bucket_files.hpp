@@ -0,0 +1,97 @@
+#ifndef KAMRAT_DATASTRUCT_BUCKETFILES_HPP
+#define KAMRAT_DATASTRUCT_BUCKETFILES_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstdio> // std::remove
+#include <stdexcept>
+
+/** Records spread into bucket files on disk, for merging out of core.
+ * Each record is framed by its size, so that a bucket is read back record by record.
+ * Threads append records through their own Buffer, buffers being written to the files by one thread at a time.
+ */
+class BucketFiles
+{
+public:
+    class Buffer
+    {
+    public:
+        explicit Buffer(BucketFiles &bucket_files);
+        ~Buffer(); // flushes the remaining records
+        void Append(size_t i_bucket, const char *record, size_t record_size);
+        void Flush();
+
+    private:
+        BucketFiles &bucket_files_;
+        std::vector<std::vector<char>> buffer_vect_;
+    };
+
+    BucketFiles(const std::string &path_prefix, size_t nb_bucket);
+    ~BucketFiles(); // remaining bucket files are removed
+    const size_t GetNbBucket() const;
+    const std::string &GetPathPrefix() const;
+    const size_t GetBucketSize(size_t i_bucket) const; // bytes written to the bucket
+    void Load(std::vector<char> &data, size_t i_bucket); // the whole bucket, whose file is removed
+    template <typename func_t>
+    void Stream(size_t i_bucket, func_t func); // func(record, record_size) on each record in file order, the file being removed then
+    template <typename func_t>
+    static void ForEachRecord(const std::vector<char> &data, func_t func); // on the records of a loaded bucket
+
+private:
+    const std::string GetPath(size_t i_bucket) const;
+    void Write(size_t i_bucket, const std::vector<char> &data);
+
+    const std::string path_prefix_;
+    std::vector<size_t> size_vect_;
+};
+
+template <typename func_t>
+void BucketFiles::Stream(const size_t i_bucket, func_t func)
+{
+    std::ifstream bucket_file(GetPath(i_bucket), std::ios::binary);
+    std::vector<char> record;
+    uint32_t record_size;
+    while (bucket_file.read(reinterpret_cast<char *>(&record_size), sizeof(uint32_t)))
+    {
+        record.resize(record_size);
+        if (!bucket_file.read(record.data(), record_size))
+        {
+            throw std::domain_error("truncated bucket file: " + GetPath(i_bucket));
+        }
+        func(record.data(), record.size());
+    }
+    bucket_file.close();
+    std::remove(GetPath(i_bucket).c_str());
+}
+
+template <typename func_t>
+void BucketFiles::ForEachRecord(const std::vector<char> &data, func_t func)
+{
+    uint32_t record_size;
+    for (size_t i(0); i < data.size(); i += sizeof(uint32_t) + record_size)
+    {
+        std::copy(data.data() + i, data.data() + i + sizeof(uint32_t), reinterpret_cast<char *>(&record_size));
+        func(data.data() + i + sizeof(uint32_t), static_cast<size_t>(record_size));
+    }
+}
+
+/** Sink of input sequences for merging out of core, written as contig records in a single bucket, ids following the input order.
+ */
+class ContigSpool
+{
+public:
+    explicit ContigSpool(const std::string &path_prefix);
+    void AddContig(const std::string &seq, size_t pos, float val);
+    const size_t GetNbContig() const;
+    BucketFiles &GetBucketFiles(); // once all contigs are added
+
+private:
+    BucketFiles bucket_files_;
+    BucketFiles::Buffer buffer_;
+    std::vector<char> record_;
+    size_t nb_ctg_;
+};
+
+#endif //KAMRAT_DATASTRUCT_BUCKETFILES_HPP
@@ -0,0 +1,502 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cstring> // std::memcpy
+
+#include "contig_store.hpp"
+#include "seq_coding.hpp" // uint128_t, GetRC
+
+#define NUC_PER_WORD 32
+
+inline const uint8_t Nuc2Code(const char nuc)
+{
+    switch (nuc)
+    {
+    case 'A':
+    case 'a':
+        return 0;
+    case 'C':
+    case 'c':
+        return 1;
+    case 'G':
+    case 'g':
+        return 2;
+    case 'T':
+    case 't':
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+inline const uint8_t GetSlabNuc(const std::vector<uint64_t> &nuc_slab, const size_t i_nuc)
+{
+    return (nuc_slab[i_nuc / NUC_PER_WORD] >> (62 - 2 * (i_nuc % NUC_PER_WORD))) & 3;
+}
+
+inline void SetSlabNuc(std::vector<uint64_t> &nuc_slab, const size_t i_nuc, const uint64_t code)
+{
+    uint64_t &word = nuc_slab[i_nuc / NUC_PER_WORD];
+    const unsigned int shift = 62 - 2 * (i_nuc % NUC_PER_WORD);
+    word = (word & ~(3ULL << shift)) | (code << shift);
+}
+
+/** Code of the nucleotides [i_nuc, i_nuc + n_nuc) of the slab, the covered bits of each word being taken at once by shifts.
+ */
+template <typename code_t>
+inline const code_t ExtractCode(const std::vector<uint64_t> &nuc_slab, size_t i_nuc, size_t n_nuc)
+{
+    code_t code(0);
+    while (n_nuc > 0)
+    {
+        const size_t i_word_nuc = i_nuc % NUC_PER_WORD, n_taken = std::min<size_t>(NUC_PER_WORD - i_word_nuc, n_nuc);
+        const uint64_t bits = (nuc_slab[i_nuc / NUC_PER_WORD] << (2 * i_word_nuc)) >> (64 - 2 * n_taken);
+        code = (2 * n_taken < 8 * sizeof(code_t) ? (code << (2 * n_taken)) : code_t(0)) | bits;
+        i_nuc += n_taken;
+        n_nuc -= n_taken;
+    }
+    return code;
+}
+
+const uint8_t ContigStore::SeqSpan::GetNuc(const size_t i) const
+{
+    if (is_rc)
+    {
+        return 3 - GetSlabNuc(*slab, nuc_start + seq_len - 1 - i); // A <=> T, C <=> G
+    }
+    return GetSlabNuc(*slab, nuc_start + i);
+}
+
+/** Head of a contig record, followed by the positions of members, the representative one first, then by the contig sequence.
+ */
+struct ContigRecordHead
+{
+    uint64_t id;
+    uint64_t nb_mem;
+    uint64_t head_mem; // rank of the head k-mer among members
+    uint64_t rear_mem; // rank of the rear k-mer among members
+    uint32_t seq_len;
+    float val;
+};
+
+ContigStore::ContigStore(const size_t seq_len) noexcept
+    : seq_len_(seq_len), slot_size_(std::max<size_t>(1, (seq_len + NUC_PER_WORD - 1) / NUC_PER_WORD)) // a slot holds a record index at least
+{
+}
+
+void ContigStore::ReserveSerials(const size_t nb_serial)
+{
+    pos_vect_.reserve(nb_serial);
+    parent_vect_.reserve(nb_serial);
+    next_mem_vect_.reserve(nb_serial);
+    has_record_vect_.reserve(nb_serial);
+    input_slab_.reserve(nb_serial * slot_size_);
+    ctg_list_.reserve(nb_serial);
+}
+
+void ContigStore::AddContig(const std::string &seq, const size_t pos, const float val)
+{
+    const size_t serial = pos_vect_.size();
+    if (serial >= SerialVect::kNoSerial)
+    {
+        throw std::length_error("number of sequences to merge exceeds the limit of 40-bit serials");
+    }
+    for (const char nuc : seq)
+    {
+        if (Nuc2Code(nuc) > 3)
+        {
+            throw std::domain_error("sequence to merge has non-ACGT nucleotide: " + seq);
+        }
+    }
+    pos_vect_.push_back(pos);
+    if (val != 0 && val_vect_.empty())
+    {
+        val_vect_.resize(serial, 0); // values were all 0 until this one
+    }
+    if (val != 0 || !val_vect_.empty())
+    {
+        val_vect_.push_back(val);
+    }
+    parent_vect_.push_back(serial);
+    next_mem_vect_.push_back(SerialVect::kNoSerial);
+    has_record_vect_.push_back(false);
+    ctg_list_.push_back(serial);
+    input_slab_.resize(input_slab_.size() + slot_size_, 0);
+    if (seq.size() == seq_len_)
+    {
+        for (size_t i(0); i < seq.size(); ++i)
+        {
+            SetSlabNuc(input_slab_, serial * slot_size_ * NUC_PER_WORD + i, Nuc2Code(seq[i]));
+        }
+    }
+    else // written at once in the extension slab
+    {
+        const size_t span_start = ext_slab_.size();
+        ext_slab_.resize(span_start + (seq.size() + NUC_PER_WORD - 1) / NUC_PER_WORD, 0);
+        for (size_t i(0); i < seq.size(); ++i)
+        {
+            SetSlabNuc(ext_slab_, span_start * NUC_PER_WORD + i, Nuc2Code(seq[i]));
+        }
+        AddRecord(serial, seq.size(), span_start);
+    }
+}
+
+const size_t ContigStore::GetNbSerial() const
+{
+    return pos_vect_.size();
+}
+
+const SerialVect &ContigStore::GetContigList() const
+{
+    return ctg_list_;
+}
+
+const bool ContigStore::IsAbsorbed(const size_t serial) const
+{
+    return (parent_vect_[serial] != serial);
+}
+
+const size_t ContigStore::GetContig(const size_t serial)
+{
+    size_t root = serial;
+    while (parent_vect_[root] != root)
+    {
+        root = parent_vect_[root];
+    }
+    for (size_t i = serial; i != root;) // path compression
+    {
+        const size_t next = parent_vect_[i];
+        parent_vect_.set(i, root);
+        i = next;
+    }
+    return root;
+}
+
+void ContigStore::Compact()
+{
+    size_t nb_ctg(0);
+    for (size_t i_list(0); i_list < ctg_list_.size(); ++i_list)
+    {
+        if (!IsAbsorbed(ctg_list_[i_list]))
+        {
+            ctg_list_.set(nb_ctg++, ctg_list_[i_list]);
+        }
+    }
+    ctg_list_.resize(nb_ctg);
+    std::vector<ExtRecord> new_record_vect;
+    std::vector<uint64_t> new_ext_slab;
+    for (const size_t i_ctg : ctg_list_)
+    {
+        if (!has_record_vect_[i_ctg])
+        {
+            continue;
+        }
+        ExtRecord record = record_vect_[input_slab_[i_ctg * slot_size_]];
+        const size_t span_start = new_ext_slab.size(), span_size = (record.seq_len + NUC_PER_WORD - 1) / NUC_PER_WORD;
+        new_ext_slab.resize(span_start + span_size, 0);
+        for (size_t i(0); i < record.seq_len; i += NUC_PER_WORD) // word by word, as the new room starts at a word
+        {
+            const size_t n_nuc = std::min<size_t>(NUC_PER_WORD, record.seq_len - i);
+            new_ext_slab[span_start + i / NUC_PER_WORD] = ExtractCode<uint64_t>(ext_slab_, record.nuc_start + i, n_nuc) << (64 - 2 * n_nuc);
+        }
+        record.nuc_start = span_start * NUC_PER_WORD;
+        record.span_start = span_start;
+        record.span_size = span_size;
+        input_slab_[i_ctg * slot_size_] = new_record_vect.size();
+        new_record_vect.push_back(record);
+    }
+    record_vect_.swap(new_record_vect); // records of absorbed contigs are dropped
+    ext_slab_.swap(new_ext_slab);
+}
+
+const ContigStore::ExtRecord *ContigStore::GetRecord(const size_t i_ctg) const
+{
+    return (has_record_vect_[i_ctg] ? &record_vect_[input_slab_[i_ctg * slot_size_]] : nullptr);
+}
+
+ContigStore::ExtRecord &ContigStore::MakeRecord(const size_t i_ctg)
+{
+    if (has_record_vect_[i_ctg])
+    {
+        return record_vect_[input_slab_[i_ctg * slot_size_]];
+    }
+    const size_t span_start = ext_slab_.size();
+    ext_slab_.insert(ext_slab_.end(), input_slab_.begin() + i_ctg * slot_size_, input_slab_.begin() + (i_ctg + 1) * slot_size_);
+    return AddRecord(i_ctg, seq_len_, span_start);
+}
+
+/** Record of a contig alone, whose nucleotides are already at the end of the extension slab from span_start.
+ */
+ContigStore::ExtRecord &ContigStore::AddRecord(const size_t i_ctg, const size_t seq_len, const size_t span_start)
+{
+    input_slab_[i_ctg * slot_size_] = record_vect_.size();
+    has_record_vect_[i_ctg] = true;
+    record_vect_.push_back(ExtRecord{span_start * NUC_PER_WORD, span_start, static_cast<uint32_t>(seq_len),
+                                     static_cast<uint32_t>(ext_slab_.size() - span_start), i_ctg, 1, i_ctg, i_ctg, false});
+    return record_vect_.back();
+}
+
+const ContigStore::SeqSpan ContigStore::GetSpan(const size_t i_ctg, const bool need_reverse) const
+{
+    const ExtRecord *record = GetRecord(i_ctg);
+    if (record == nullptr)
+    {
+        return SeqSpan{&input_slab_, i_ctg * slot_size_ * NUC_PER_WORD, seq_len_, need_reverse};
+    }
+    return SeqSpan{&ext_slab_, record->nuc_start, record->seq_len, record->is_rc != need_reverse};
+}
+
+const std::string ContigStore::GetSeq(const size_t i_ctg) const
+{
+    static const char kNucChar[4] = {'A', 'C', 'G', 'T'};
+    const SeqSpan span = GetSpan(i_ctg, false);
+    std::string seq(span.seq_len, 'N');
+    for (size_t i(0); i < seq.size(); ++i)
+    {
+        seq[i] = kNucChar[span.GetNuc(i)];
+    }
+    return seq;
+}
+
+const size_t ContigStore::GetSeqLen(const size_t i_ctg) const
+{
+    const ExtRecord *record = GetRecord(i_ctg);
+    return (record == nullptr ? seq_len_ : record->seq_len);
+}
+
+template <typename code_t>
+const code_t ContigStore::GetPrefixCode(const size_t i_ctg, const size_t n_nuc) const
+{
+    const SeqSpan span = GetSpan(i_ctg, false);
+    if (span.is_rc) // reverse complement of the stored suffix
+    {
+        return GetRC(ExtractCode<code_t>(*span.slab, span.nuc_start + span.seq_len - n_nuc, n_nuc), n_nuc);
+    }
+    return ExtractCode<code_t>(*span.slab, span.nuc_start, n_nuc);
+}
+
+template <typename code_t>
+const code_t ContigStore::GetSuffixCode(const size_t i_ctg, const size_t n_nuc) const
+{
+    const SeqSpan span = GetSpan(i_ctg, false);
+    if (span.is_rc) // reverse complement of the stored prefix
+    {
+        return GetRC(ExtractCode<code_t>(*span.slab, span.nuc_start, n_nuc), n_nuc);
+    }
+    return ExtractCode<code_t>(*span.slab, span.nuc_start + span.seq_len - n_nuc, n_nuc);
+}
+
+template const uint64_t ContigStore::GetPrefixCode<uint64_t>(size_t, size_t) const;
+template const uint128_t ContigStore::GetPrefixCode<uint128_t>(size_t, size_t) const;
+template const uint64_t ContigStore::GetSuffixCode<uint64_t>(size_t, size_t) const;
+template const uint128_t ContigStore::GetSuffixCode<uint128_t>(size_t, size_t) const;
+
+const size_t ContigStore::GetRepPos(const size_t i_ctg) const
+{
+    return pos_vect_[i_ctg];
+}
+
+const float ContigStore::GetRepVal(const size_t i_ctg) const
+{
+    return (val_vect_.empty() ? 0 : val_vect_[i_ctg]);
+}
+
+const size_t ContigStore::GetHeadSerial(const size_t i_ctg, const bool need_reverse) const
+{
+    const ExtRecord *record = GetRecord(i_ctg);
+    if (record == nullptr)
+    {
+        return i_ctg;
+    }
+    return (need_reverse ? record->rear : record->head);
+}
+
+const size_t ContigStore::GetHeadPos(const size_t i_ctg, const bool need_reverse) const
+{
+    return pos_vect_[GetHeadSerial(i_ctg, need_reverse)];
+}
+
+const size_t ContigStore::GetRearPos(const size_t i_ctg, const bool need_reverse) const
+{
+    return pos_vect_[GetHeadSerial(i_ctg, !need_reverse)];
+}
+
+const size_t ContigStore::GetNbMemKmer(const size_t i_ctg) const
+{
+    const ExtRecord *record = GetRecord(i_ctg);
+    return (record == nullptr ? 1 : record->nb_mem);
+}
+
+const std::vector<size_t> &ContigStore::GetMemPosVect(std::vector<size_t> &mem_pos_vect, const size_t i_ctg) const
+{
+    mem_pos_vect.clear();
+    for (size_t i_mem = i_ctg; i_mem != SerialVect::kNoSerial; i_mem = next_mem_vect_[i_mem])
+    {
+        mem_pos_vect.push_back(pos_vect_[i_mem]);
+    }
+    return mem_pos_vect;
+}
+
+void ContigStore::ReverseComplement(const size_t i_ctg)
+{
+    ExtRecord &record = MakeRecord(i_ctg);
+    record.is_rc = !record.is_rc; // stored nucleotides are left unchanged
+    std::swap(record.head, record.rear);
+}
+
+void ContigStore::ReserveRoom(ExtRecord &record, const size_t n_front, const size_t n_back)
+{
+    const size_t span_nuc_start = record.span_start * NUC_PER_WORD, span_nuc_end = span_nuc_start + record.span_size * NUC_PER_WORD,
+                 nuc_start = record.nuc_start, seq_len = record.seq_len,
+                 front_room = nuc_start - span_nuc_start, back_room = span_nuc_end - nuc_start - seq_len;
+    if (n_front <= front_room && n_back <= back_room)
+    {
+        return;
+    }
+    // room is doubled at the growing side, for extensions to cost amortized constant time per nucleotide
+    const size_t new_front_room = (n_front <= front_room ? front_room : n_front + seq_len),
+                 new_back_room = (n_back <= back_room ? back_room : n_back + seq_len),
+                 span_start = ext_slab_.size(), span_size = (new_front_room + seq_len + new_back_room + NUC_PER_WORD - 1) / NUC_PER_WORD;
+    ext_slab_.resize(span_start + span_size, 0); // the old room is left unused until Compact()
+    for (size_t i(0); i < seq_len; ++i)
+    {
+        SetSlabNuc(ext_slab_, span_start * NUC_PER_WORD + new_front_room + i, GetSlabNuc(ext_slab_, nuc_start + i));
+    }
+    record.nuc_start = span_start * NUC_PER_WORD + new_front_room;
+    record.span_start = span_start;
+    record.span_size = span_size;
+}
+
+/** Add to the contig sequence the nucleotides [i_start, i_end) of the other contig's sequence, at right or at left.
+ */
+void ContigStore::PushNucs(ExtRecord &record, const SeqSpan &other_span, const size_t i_start, const size_t i_end, const bool at_right)
+{
+    const size_t n_nuc = i_end - i_start;
+    const bool at_stored_back = (at_right != record.is_rc); // sides are swapped in the stored nucleotides if rc
+    ReserveRoom(record, at_stored_back ? 0 : n_nuc, at_stored_back ? n_nuc : 0);
+    for (size_t j(0); j < n_nuc; ++j)
+    {
+        // stored nucleotides grow outwards, from the one next to the current sequence
+        const size_t i = (at_right ? i_start + j : i_end - 1 - j);
+        const uint64_t code = (record.is_rc ? 3 - other_span.GetNuc(i) : other_span.GetNuc(i));
+        if (at_stored_back)
+        {
+            SetSlabNuc(ext_slab_, record.nuc_start + record.seq_len, code);
+        }
+        else
+        {
+            SetSlabNuc(ext_slab_, --record.nuc_start, code);
+        }
+        ++record.seq_len;
+    }
+}
+
+void ContigStore::Absorb(const size_t i_ctg, const size_t i_other_ctg)
+{
+    ExtRecord &record = record_vect_[input_slab_[i_ctg * slot_size_]];
+    const ExtRecord *other_record = GetRecord(i_other_ctg);
+    parent_vect_.set(i_other_ctg, i_ctg);
+    next_mem_vect_.set(record.last_mem, i_other_ctg); // the base contig keeps its representative k-mer as first member
+    record.last_mem = (other_record == nullptr ? i_other_ctg : other_record->last_mem);
+    record.nb_mem += (other_record == nullptr ? 1 : other_record->nb_mem);
+}
+
+void ContigStore::LeftExtend(const size_t i_ctg, const size_t i_left_ctg, const bool need_left_rc, unsigned int n_overlap)
+{
+    ExtRecord &record = MakeRecord(i_ctg);
+    const SeqSpan left_span = GetSpan(i_left_ctg, need_left_rc); // read reversed if needed, the absorbed contig being left as it is
+    PushNucs(record, left_span, 0, left_span.seq_len - n_overlap, false); // overlap already in this contig
+    record.head = GetHeadSerial(i_left_ctg, need_left_rc);
+    Absorb(i_ctg, i_left_ctg);
+}
+
+void ContigStore::RightExtend(const size_t i_ctg, const size_t i_right_ctg, const bool need_right_rc, unsigned int n_overlap)
+{
+    ExtRecord &record = MakeRecord(i_ctg);
+    const SeqSpan right_span = GetSpan(i_right_ctg, need_right_rc);
+    PushNucs(record, right_span, n_overlap, right_span.seq_len, true);
+    record.rear = GetHeadSerial(i_right_ctg, !need_right_rc);
+    Absorb(i_ctg, i_right_ctg);
+}
+
+void ContigStore::WriteContig(std::vector<char> &record, const size_t i_ctg, const size_t id) const
+{
+    const std::string seq = GetSeq(i_ctg);
+    const size_t head = GetHeadSerial(i_ctg, false), rear = GetHeadSerial(i_ctg, true);
+    ContigRecordHead record_head{id, GetNbMemKmer(i_ctg), 0, 0, static_cast<uint32_t>(seq.size()), GetRepVal(i_ctg)};
+    record.resize(sizeof(ContigRecordHead) + record_head.nb_mem * sizeof(uint64_t) + seq.size());
+    char *mem_ptr = record.data() + sizeof(ContigRecordHead);
+    size_t i_mem(0);
+    for (size_t serial = i_ctg; serial != SerialVect::kNoSerial; serial = next_mem_vect_[serial], ++i_mem)
+    {
+        record_head.head_mem = (serial == head ? i_mem : record_head.head_mem);
+        record_head.rear_mem = (serial == rear ? i_mem : record_head.rear_mem);
+        const uint64_t pos = pos_vect_[serial];
+        std::memcpy(mem_ptr + i_mem * sizeof(uint64_t), &pos, sizeof(uint64_t));
+    }
+    std::memcpy(record.data(), &record_head, sizeof(ContigRecordHead));
+    std::memcpy(mem_ptr + i_mem * sizeof(uint64_t), seq.data(), seq.size());
+}
+
+void ContigStore::WriteInputContig(std::vector<char> &record, const std::string &seq, const size_t pos, const float val, const size_t id)
+{
+    for (const char nuc : seq)
+    {
+        if (Nuc2Code(nuc) > 3)
+        {
+            throw std::domain_error("sequence to merge has non-ACGT nucleotide: " + seq);
+        }
+    }
+    const ContigRecordHead record_head{id, 1, 0, 0, static_cast<uint32_t>(seq.size()), val};
+    const uint64_t mem_pos = pos;
+    record.resize(sizeof(ContigRecordHead) + sizeof(uint64_t) + seq.size());
+    std::memcpy(record.data(), &record_head, sizeof(ContigRecordHead));
+    std::memcpy(record.data() + sizeof(ContigRecordHead), &mem_pos, sizeof(uint64_t));
+    std::memcpy(record.data() + sizeof(ContigRecordHead) + sizeof(uint64_t), seq.data(), seq.size());
+}
+
+const size_t ContigStore::ReadContig(const char *record)
+{
+    ContigRecordHead record_head;
+    std::memcpy(&record_head, record, sizeof(ContigRecordHead));
+    const char *mem_ptr = record + sizeof(ContigRecordHead);
+    uint64_t pos;
+    std::memcpy(&pos, mem_ptr, sizeof(uint64_t));
+    const size_t i_ctg = GetNbSerial();
+    AddContig(std::string(mem_ptr + record_head.nb_mem * sizeof(uint64_t), record_head.seq_len), pos, record_head.val);
+    if (record_head.nb_mem > 1)
+    {
+        ExtRecord &ext_record = MakeRecord(i_ctg);
+        for (size_t i_mem(1); i_mem < record_head.nb_mem; ++i_mem)
+        {
+            std::memcpy(&pos, mem_ptr + i_mem * sizeof(uint64_t), sizeof(uint64_t));
+            AddMember(ext_record, i_ctg, pos);
+        }
+        ext_record.head = i_ctg + record_head.head_mem; // members follow the contig serial in member order
+        ext_record.rear = i_ctg + record_head.rear_mem;
+    }
+    return i_ctg;
+}
+
+const size_t ContigStore::GetRecordId(const char *record)
+{
+    uint64_t id;
+    std::memcpy(&id, record, sizeof(uint64_t)); // first field of the record head
+    return id;
+}
+
+void ContigStore::AddMember(ExtRecord &record, const size_t i_ctg, const size_t pos)
+{
+    const size_t serial = pos_vect_.size();
+    pos_vect_.push_back(pos);
+    if (!val_vect_.empty())
+    {
+        val_vect_.push_back(0);
+    }
+    parent_vect_.push_back(i_ctg);
+    next_mem_vect_.push_back(SerialVect::kNoSerial);
+    has_record_vect_.push_back(false);
+    input_slab_.resize(input_slab_.size() + slot_size_, 0);
+    next_mem_vect_.set(record.last_mem, serial);
+    record.last_mem = serial;
+    ++record.nb_mem;
+}
@@ -0,0 +1,98 @@
+#ifndef KAMRAT_MERGE_CONTIGSTORE_HPP
+#define KAMRAT_MERGE_CONTIGSTORE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "serial_vect.hpp"
+
+/** Contigs under extension, stored column-wise instead of one heap object per contig.
+ * Each input sequence keeps its serial for the whole merging, a contig being known by the serial of its base sequence.
+ * Input sequences are 2-bit packed in a fixed-width slot of the input slab, a contig being described by its serial alone until it changes.
+ * An extension links the absorbed contig to the base one (union-find parent), chains their member lists, and gives the base contig
+ * an extension record, whose index takes the place of the nucleotides in the input slot.
+ * Extended sequences are packed in an extension slab with free room at both sides of a contig,
+ * a contig whose room is used up being moved to the slab end with doubled room.
+ */
+class ContigStore
+{
+public:
+    explicit ContigStore(size_t seq_len) noexcept; // usual input sequence length, others taking an extension record at once
+    void ReserveSerials(size_t nb_serial);
+    void AddContig(const std::string &seq, size_t pos, float val);
+    const size_t GetNbSerial() const;
+    const SerialVect &GetContigList() const; // serials of contigs, in input order, updated by Compact()
+    const bool IsAbsorbed(size_t serial) const;
+    const size_t GetContig(size_t serial); // contig containing the input sequence
+    void Compact();                        // drop absorbed contigs from the contig list, and their records from the extension slab
+
+    const std::string GetSeq(size_t i_ctg) const;
+    const size_t GetSeqLen(size_t i_ctg) const;
+    template <typename code_t = uint64_t>
+    const code_t GetPrefixCode(size_t i_ctg, size_t n_nuc) const; // code_t is uint64_t, or uint128_t for more than 32 nucleotides
+    template <typename code_t = uint64_t>
+    const code_t GetSuffixCode(size_t i_ctg, size_t n_nuc) const;
+    const size_t GetRepPos(size_t i_ctg) const;
+    const float GetRepVal(size_t i_ctg) const;
+    const size_t GetHeadPos(size_t i_ctg, bool need_reverse) const;
+    const size_t GetRearPos(size_t i_ctg, bool need_reverse) const;
+    const size_t GetNbMemKmer(size_t i_ctg) const;
+    const std::vector<size_t> &GetMemPosVect(std::vector<size_t> &mem_pos_vect, size_t i_ctg) const;
+    void LeftExtend(size_t i_ctg, size_t i_left_ctg, bool need_left_rc, unsigned int n_overlap);
+    void RightExtend(size_t i_ctg, size_t i_right_ctg, bool need_right_rc, unsigned int n_overlap);
+    void ReverseComplement(size_t i_ctg);
+
+    // contig records, for spooling contigs to disk with their id: the serial in the whole input, not in this store
+    void WriteContig(std::vector<char> &record, size_t i_ctg, size_t id) const;
+    static void WriteInputContig(std::vector<char> &record, const std::string &seq, size_t pos, float val, size_t id);
+    const size_t ReadContig(const char *record); // add the recorded contig, with its members, returning its serial
+    static const size_t GetRecordId(const char *record);
+
+private:
+    struct ExtRecord // contig whose sequence or members differ from its base input sequence
+    {
+        size_t nuc_start;   // first nucleotide in the extension slab
+        size_t span_start;  // first word of the room in the extension slab
+        uint32_t seq_len;   // number of nucleotides
+        uint32_t span_size; // number of words of the room in the extension slab
+        size_t last_mem;    // last member, the first being the base sequence itself
+        size_t nb_mem;      // number of member k-mers
+        size_t head;        // serial of the head k-mer
+        size_t rear;        // serial of the rear k-mer
+        bool is_rc;         // contig sequence is the reverse complement of the stored nucleotides
+    };
+    struct SeqSpan // where to read a contig sequence
+    {
+        const std::vector<uint64_t> *slab;
+        size_t nuc_start, seq_len;
+        bool is_rc;
+
+        const uint8_t GetNuc(size_t i) const; // i-th nucleotide of the contig sequence, as 2-bit code
+    };
+
+    const ExtRecord *GetRecord(size_t i_ctg) const; // nullptr if the contig is its input sequence alone
+    ExtRecord &MakeRecord(size_t i_ctg);           // the existing one, or one made from the input slot
+    ExtRecord &AddRecord(size_t i_ctg, size_t seq_len, size_t span_start);
+    const SeqSpan GetSpan(size_t i_ctg, bool need_reverse) const;
+    const size_t GetHeadSerial(size_t i_ctg, bool need_reverse) const;
+    void PushNucs(ExtRecord &record, const SeqSpan &other_span, size_t i_start, size_t i_end, bool at_right);
+    void ReserveRoom(ExtRecord &record, size_t n_front, size_t n_back);
+    void Absorb(size_t i_ctg, size_t i_other_ctg);
+    void AddMember(ExtRecord &record, size_t i_ctg, size_t pos); // member known by its position only, as a new absorbed serial
+
+    const size_t seq_len_, slot_size_; // usual input sequence length, and words of an input slot
+    // by serial: input sequence, a base sequence keeping its representative k-mer
+    std::vector<size_t> pos_vect_;    // position in index
+    std::vector<float> val_vect_;     // value for indicating representativeness, left empty while all values are 0
+    SerialVect parent_vect_;          // absorbing contig, the serial itself if not absorbed
+    SerialVect next_mem_vect_;        // next member in the list of contig members
+    std::vector<bool> has_record_vect_; // input slot holds the extension record index instead of the nucleotides
+    std::vector<uint64_t> input_slab_; // 2-bit packed nucleotides in fixed-width slots, 32 per word from the most significant bits
+
+    std::vector<ExtRecord> record_vect_;
+    std::vector<uint64_t> ext_slab_; // 2-bit packed nucleotides of extension records
+    SerialVect ctg_list_;            // serials of contigs
+};
+
+#endif //KAMRAT_MERGE_CONTIGSTORE_HPP
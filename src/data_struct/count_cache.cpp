@@ -0,0 +1,78 @@
+#include <algorithm>
+
+#include "count_cache.hpp"
+#include "vect_opera.hpp"
+
+CountCache::CountCache(std::ifstream &idx_mat, const size_t nb_smp, const size_t k_len, const size_t max_mem, const bool to_rank)
+    : idx_mat_(idx_mat), nb_smp_(nb_smp), row_size_(nb_smp * sizeof(float) + k_len + 1), max_mem_(max_mem), // count vector, k-mer, '\n'
+      to_rank_(to_rank)
+{
+}
+
+const bool CountCache::Load(std::vector<size_t> &pos_vect)
+{
+    row_vect_.clear();
+    count_arr_.clear();
+    std::sort(pos_vect.begin(), pos_vect.end());
+    pos_vect.erase(std::unique(pos_vect.begin(), pos_vect.end()), pos_vect.end());
+    if (pos_vect.size() * nb_smp_ * sizeof(float) > max_mem_)
+    {
+        return false;
+    }
+    row_vect_.reserve(pos_vect.size());
+    count_arr_.resize(pos_vect.size() * nb_smp_);
+    float *count_ptr = count_arr_.data();
+    idx_mat_.clear();
+    for (const size_t pos : pos_vect)
+    {
+        if (row_vect_.empty() || pos != (row_vect_.back() + 1) * row_size_) // rows are read in one go when contiguous
+        {
+            idx_mat_.seekg(pos);
+        }
+        idx_mat_.read(reinterpret_cast<char *>(count_ptr), nb_smp_ * sizeof(float));
+        idx_mat_.ignore(row_size_ - nb_smp_ * sizeof(float));
+        row_vect_.push_back(pos / row_size_);
+        count_ptr += nb_smp_;
+    }
+    if (to_rank_)
+    {
+        std::vector<float> count_vect, rank_vect;
+        for (size_t i_row(0); i_row < row_vect_.size(); ++i_row)
+        {
+            count_vect.assign(count_arr_.cbegin() + i_row * nb_smp_, count_arr_.cbegin() + (i_row + 1) * nb_smp_);
+            CalcRankVect(count_vect, rank_vect);
+            std::copy(rank_vect.cbegin(), rank_vect.cend(), count_arr_.begin() + i_row * nb_smp_);
+        }
+    }
+    return true;
+}
+
+const std::vector<float> &CountCache::GetCountVect(std::vector<float> &count_vect, const size_t pos) const
+{
+    const size_t row = pos / row_size_;
+    size_t i_row = row; // rows from the first one are all cached if the whole index is
+    if (i_row >= row_vect_.size() || row_vect_[i_row] != row)
+    {
+        i_row = std::lower_bound(row_vect_.cbegin(), row_vect_.cend(), row) - row_vect_.cbegin();
+    }
+    if (i_row < row_vect_.size() && row_vect_[i_row] == row)
+    {
+        count_vect.assign(count_arr_.cbegin() + i_row * nb_smp_, count_arr_.cbegin() + (i_row + 1) * nb_smp_);
+    }
+    else
+    {
+        count_vect.resize(nb_smp_);
+#pragma omp critical(count_cache_read) // the index file is shared by threads
+        {
+            idx_mat_.seekg(pos);
+            idx_mat_.read(reinterpret_cast<char *>(&count_vect[0]), nb_smp_ * sizeof(float));
+        }
+        if (to_rank_)
+        {
+            thread_local static std::vector<float> rank_vect;
+            CalcRankVect(count_vect, rank_vect);
+            count_vect.swap(rank_vect);
+        }
+    }
+    return count_vect;
+}
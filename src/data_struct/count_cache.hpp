@@ -0,0 +1,27 @@
+#ifndef KAMRAT_MERGE_COUNTCACHE_HPP
+#define KAMRAT_MERGE_COUNTCACHE_HPP
+
+#include <vector>
+#include <fstream>
+
+/** In-memory copy of the count vectors of selected k-mers in a k-mer index.
+ * Rows of idx-mat.bin have a fixed size in k-mer mode, so that a k-mer position gives its row directly.
+ * Count vectors not in the cache are read from the index, by one thread at a time.
+ * With to_rank, vectors are replaced by their ranks once at caching, for comparing the same k-mers by Spearman distance repeatedly.
+ */
+class CountCache
+{
+public:
+    CountCache(std::ifstream &idx_mat, size_t nb_smp, size_t k_len, size_t max_mem, bool to_rank);
+    const bool Load(std::vector<size_t> &pos_vect); // pos_vect is sorted, false if it exceeds the memory limit (nothing is cached then)
+    const std::vector<float> &GetCountVect(std::vector<float> &count_vect, size_t pos) const; // rank vector if to_rank
+
+private:
+    std::ifstream &idx_mat_;
+    const size_t nb_smp_, row_size_, max_mem_;
+    const bool to_rank_;
+    std::vector<size_t> row_vect_;  // cached rows, sorted
+    std::vector<float> count_arr_; // count vectors of cached rows, contiguously
+};
+
+#endif //KAMRAT_MERGE_COUNTCACHE_HPP
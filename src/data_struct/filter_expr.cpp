@@ -0,0 +1,450 @@
+#include <cctype>  // isspace, isalnum, toupper
+#include <cstdlib> // strtod
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+#include "filter_expr.hpp"
+
+const double kMedianCostFactor = 4; // cost of a median relative to a loop over the group samples
+
+const std::string kStatName[] = {"mean", "median", "min", "max", "sum", "nb", "frac"}; // in FilterStat order
+const std::string kCmpName[] = {">=", ">", "<=", "<", "==", "!="};                   // in FilterCmp order
+
+/** Number of masked samples counting cmp thres, Cmp being inlined so that the loop is vectorized.
+ */
+template <typename Cmp>
+static inline const uint32_t CountIf(const float *count_arr, const uint32_t *mask, const size_t nb_smp, const float thres, const Cmp cmp)
+{
+    uint32_t nb(0);
+    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+    {
+        nb += mask[i_smp] & static_cast<uint32_t>(cmp(count_arr[i_smp], thres));
+    }
+    return nb;
+}
+
+template <typename T>
+static inline const bool Compare(const T x, const FilterCmp cmp, const T thres)
+{
+    switch (cmp)
+    {
+    case FilterCmp::kGe:
+        return (x >= thres);
+    case FilterCmp::kGt:
+        return (x > thres);
+    case FilterCmp::kLe:
+        return (x <= thres);
+    case FilterCmp::kLt:
+        return (x < thres);
+    case FilterCmp::kEq:
+        return (x == thres);
+    default:
+        return (x != thres);
+    }
+}
+
+FilterExpr::FilterExpr(const std::string &expr_str, const std::map<std::string, std::vector<size_t>> &group_map, const size_t nb_smp)
+    : nb_smp_(nb_smp), group_map_(&group_map), expr_str_(expr_str), i_char_(0)
+{
+    i_root_ = ParseOr();
+    SkipSpace();
+    if (i_char_ < expr_str_.size())
+    {
+        throw std::invalid_argument("filter expression: unexpected character" + GetErrPos());
+    }
+    SortByCost(i_root_);
+    group_map_ = nullptr;
+}
+
+const bool FilterExpr::Eval(const float *count_arr) const
+{
+    return EvalNode(i_root_, count_arr);
+}
+
+const std::string FilterExpr::GetStr() const
+{
+    return GetNodeStr(i_root_);
+}
+
+const size_t FilterExpr::ParseOr()
+{
+    const size_t i_first = ParseAnd();
+    std::vector<size_t> child_vect{i_first};
+    while (ParseWord("OR") || ParseWord("||"))
+    {
+        child_vect.push_back(ParseAnd());
+    }
+    if (child_vect.size() == 1)
+    {
+        return i_first;
+    }
+    node_vect_.emplace_back();
+    node_vect_.back().type = NodeType::kOr;
+    node_vect_.back().child_vect = child_vect;
+    return (node_vect_.size() - 1);
+}
+
+const size_t FilterExpr::ParseAnd()
+{
+    const size_t i_first = ParseNot();
+    std::vector<size_t> child_vect{i_first};
+    while (ParseWord("AND") || ParseWord("&&"))
+    {
+        child_vect.push_back(ParseNot());
+    }
+    if (child_vect.size() == 1)
+    {
+        return i_first;
+    }
+    node_vect_.emplace_back();
+    node_vect_.back().type = NodeType::kAnd;
+    node_vect_.back().child_vect = child_vect;
+    return (node_vect_.size() - 1);
+}
+
+const size_t FilterExpr::ParseNot()
+{
+    SkipSpace();
+    bool is_not = ParseWord("NOT");
+    if (!is_not && i_char_ < expr_str_.size() && expr_str_[i_char_] == '!')
+    {
+        ++i_char_;
+        is_not = true;
+    }
+    if (is_not)
+    {
+        const size_t i_child = ParseNot();
+        node_vect_.emplace_back();
+        node_vect_.back().type = NodeType::kNot;
+        node_vect_.back().child_vect.push_back(i_child);
+        return (node_vect_.size() - 1);
+    }
+    if (i_char_ < expr_str_.size() && expr_str_[i_char_] == '(')
+    {
+        ++i_char_;
+        const size_t i_node = ParseOr();
+        SkipSpace();
+        if (i_char_ >= expr_str_.size() || expr_str_[i_char_] != ')')
+        {
+            throw std::invalid_argument("filter expression: ')' expected" + GetErrPos());
+        }
+        ++i_char_;
+        return i_node;
+    }
+    return ParsePred();
+}
+
+const size_t FilterExpr::ParsePred()
+{
+    Node node;
+    node.type = NodeType::kPred;
+    const std::string stat_name = ParseName();
+    const size_t i_stat = std::find(std::begin(kStatName), std::end(kStatName), stat_name) - std::begin(kStatName);
+    if (i_stat == sizeof(kStatName) / sizeof(kStatName[0]))
+    {
+        throw std::invalid_argument("filter expression: unknown statistic \"" + stat_name + "\", expected one of mean, median, min, max, sum, nb, frac" + GetErrPos());
+    }
+    node.stat = static_cast<FilterStat>(i_stat);
+    SkipSpace();
+    if (i_char_ >= expr_str_.size() || expr_str_[i_char_] != '(')
+    {
+        throw std::invalid_argument("filter expression: '(' expected after " + stat_name + GetErrPos());
+    }
+    ++i_char_;
+    node.i_group = GetGroup(ParseName());
+    if (node.stat == FilterStat::kNb || node.stat == FilterStat::kFrac)
+    {
+        node.stat_cmp = ParseCmp();
+        node.stat_thres = static_cast<float>(ParseNum()); // compared to float counts
+    }
+    SkipSpace();
+    if (i_char_ >= expr_str_.size() || expr_str_[i_char_] != ')')
+    {
+        throw std::invalid_argument("filter expression: ')' expected" + GetErrPos());
+    }
+    ++i_char_;
+    node.cmp = ParseCmp();
+    node.thres = ParseNum();
+    if (group_smp_vect_[node.i_group].empty() && node.stat != FilterStat::kNb && node.stat != FilterStat::kSum)
+    {
+        throw std::invalid_argument("filter expression: " + stat_name + " of sample group " + group_name_vect_[node.i_group] + " without any sample");
+    }
+    node_vect_.push_back(node);
+    return (node_vect_.size() - 1);
+}
+
+const size_t FilterExpr::GetGroup(const std::string &group_name)
+{
+    const auto it = std::find(group_name_vect_.cbegin(), group_name_vect_.cend(), group_name);
+    if (it != group_name_vect_.cend())
+    {
+        return (it - group_name_vect_.cbegin());
+    }
+    const auto map_it = group_map_->find(group_name);
+    std::vector<size_t> smp_vect;
+    if (map_it != group_map_->cend())
+    {
+        smp_vect = map_it->second;
+    }
+    else if (group_name == "all")
+    {
+        for (size_t i_smp(0); i_smp < nb_smp_; ++i_smp)
+        {
+            smp_vect.push_back(i_smp);
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("filter expression: unknown sample group \"" + group_name + "\", not in design file" + GetErrPos());
+    }
+    std::sort(smp_vect.begin(), smp_vect.end()); // a sample listed twice in the design file is counted once
+    smp_vect.erase(std::unique(smp_vect.begin(), smp_vect.end()), smp_vect.end());
+    std::vector<uint32_t> mask(nb_smp_, 0);
+    for (const size_t i_smp : smp_vect)
+    {
+        mask[i_smp] = 1;
+    }
+    group_name_vect_.push_back(group_name);
+    group_mask_vect_.push_back(mask);
+    group_smp_vect_.push_back(smp_vect);
+    return (group_name_vect_.size() - 1);
+}
+
+const FilterCmp FilterExpr::ParseCmp()
+{
+    SkipSpace();
+    for (size_t i_cmp(0); i_cmp < sizeof(kCmpName) / sizeof(kCmpName[0]); ++i_cmp) // ">=" is tried before ">", "<=" before "<"
+    {
+        if (expr_str_.compare(i_char_, kCmpName[i_cmp].size(), kCmpName[i_cmp]) == 0)
+        {
+            i_char_ += kCmpName[i_cmp].size();
+            return static_cast<FilterCmp>(i_cmp);
+        }
+    }
+    throw std::invalid_argument("filter expression: comparison operator expected, one of >=, >, <=, <, ==, !=" + GetErrPos());
+}
+
+const double FilterExpr::ParseNum()
+{
+    SkipSpace();
+    const char *num_start = expr_str_.c_str() + i_char_;
+    char *num_end;
+    const double num = strtod(num_start, &num_end);
+    if (num_end == num_start || std::isnan(num))
+    {
+        throw std::invalid_argument("filter expression: number expected" + GetErrPos());
+    }
+    i_char_ += (num_end - num_start);
+    return num;
+}
+
+const std::string FilterExpr::ParseName()
+{
+    SkipSpace();
+    const size_t name_start = i_char_;
+    while (i_char_ < expr_str_.size() && (isalnum(expr_str_[i_char_]) || expr_str_[i_char_] == '_' || expr_str_[i_char_] == '.' || expr_str_[i_char_] == '-'))
+    {
+        ++i_char_;
+    }
+    if (i_char_ == name_start)
+    {
+        throw std::invalid_argument("filter expression: name expected" + GetErrPos());
+    }
+    return expr_str_.substr(name_start, i_char_ - name_start);
+}
+
+const bool FilterExpr::ParseWord(const std::string &word)
+{
+    SkipSpace();
+    if (i_char_ + word.size() > expr_str_.size())
+    {
+        return false;
+    }
+    for (size_t i(0); i < word.size(); ++i)
+    {
+        if (toupper(expr_str_[i_char_ + i]) != word[i])
+        {
+            return false;
+        }
+    }
+    const size_t i_next = i_char_ + word.size();
+    if (isalpha(word[0]) && i_next < expr_str_.size() && (isalnum(expr_str_[i_next]) || expr_str_[i_next] == '_')) // a longer name
+    {
+        return false;
+    }
+    i_char_ = i_next;
+    return true;
+}
+
+void FilterExpr::SkipSpace()
+{
+    while (i_char_ < expr_str_.size() && isspace(expr_str_[i_char_]))
+    {
+        ++i_char_;
+    }
+}
+
+const std::string FilterExpr::GetErrPos() const
+{
+    return (" at position " + std::to_string(i_char_ + 1) + " of \"" + expr_str_ + "\"");
+}
+
+void FilterExpr::SortByCost(const size_t i_node)
+{
+    Node &node = node_vect_[i_node];
+    if (node.type == NodeType::kPred)
+    {
+        node.cost = 1 + group_smp_vect_[node.i_group].size() * (node.stat == FilterStat::kMedian ? kMedianCostFactor : 1);
+        return;
+    }
+    node.cost = 0;
+    for (const size_t i_child : node.child_vect)
+    {
+        SortByCost(i_child);
+        node.cost += node_vect_[i_child].cost;
+    }
+    std::stable_sort(node.child_vect.begin(), node.child_vect.end(), [this](const size_t i, const size_t j)
+                     { return node_vect_[i].cost < node_vect_[j].cost; });
+}
+
+const bool FilterExpr::EvalNode(const size_t i_node, const float *count_arr) const
+{
+    const Node &node = node_vect_[i_node];
+    switch (node.type)
+    {
+    case NodeType::kAnd:
+        for (const size_t i_child : node.child_vect)
+        {
+            if (!EvalNode(i_child, count_arr))
+            {
+                return false;
+            }
+        }
+        return true;
+    case NodeType::kOr:
+        for (const size_t i_child : node.child_vect)
+        {
+            if (EvalNode(i_child, count_arr))
+            {
+                return true;
+            }
+        }
+        return false;
+    case NodeType::kNot:
+        return !EvalNode(node.child_vect[0], count_arr);
+    default:
+        return Compare(CalcStat(node, count_arr), node.cmp, node.thres);
+    }
+}
+
+const double FilterExpr::CalcStat(const Node &node, const float *count_arr) const
+{
+    const uint32_t *mask = group_mask_vect_[node.i_group].data();
+    const std::vector<size_t> &smp_vect = group_smp_vect_[node.i_group];
+    switch (node.stat)
+    {
+    case FilterStat::kNb:
+    case FilterStat::kFrac:
+    {
+        uint32_t nb(0);
+        switch (node.stat_cmp)
+        {
+        case FilterCmp::kGe:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::greater_equal<float>());
+            break;
+        case FilterCmp::kGt:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::greater<float>());
+            break;
+        case FilterCmp::kLe:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::less_equal<float>());
+            break;
+        case FilterCmp::kLt:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::less<float>());
+            break;
+        case FilterCmp::kEq:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::equal_to<float>());
+            break;
+        default:
+            nb = CountIf(count_arr, mask, nb_smp_, node.stat_thres, std::not_equal_to<float>());
+        }
+        return (node.stat == FilterStat::kNb ? nb : static_cast<double>(nb) / smp_vect.size());
+    }
+    case FilterStat::kMin:
+    {
+        float x(std::numeric_limits<float>::infinity());
+        for (size_t i_smp(0); i_smp < nb_smp_; ++i_smp)
+        {
+            x = std::min(x, mask[i_smp] ? count_arr[i_smp] : std::numeric_limits<float>::infinity());
+        }
+        return x;
+    }
+    case FilterStat::kMax:
+    {
+        float x(-std::numeric_limits<float>::infinity());
+        for (size_t i_smp(0); i_smp < nb_smp_; ++i_smp)
+        {
+            x = std::max(x, mask[i_smp] ? count_arr[i_smp] : -std::numeric_limits<float>::infinity());
+        }
+        return x;
+    }
+    case FilterStat::kMedian:
+    {
+        thread_local std::vector<float> val_vect;
+        val_vect.clear();
+        for (const size_t i_smp : smp_vect)
+        {
+            val_vect.push_back(count_arr[i_smp]);
+        }
+        const size_t i_mid = val_vect.size() / 2;
+        std::nth_element(val_vect.begin(), val_vect.begin() + i_mid, val_vect.end());
+        if (val_vect.size() % 2 == 1)
+        {
+            return val_vect[i_mid];
+        }
+        return (static_cast<double>(*std::max_element(val_vect.cbegin(), val_vect.cbegin() + i_mid)) + val_vect[i_mid]) / 2;
+    }
+    default: // sum and mean
+    {
+        double sum(0);
+        for (size_t i_smp(0); i_smp < nb_smp_; ++i_smp)
+        {
+            sum += (mask[i_smp] ? count_arr[i_smp] : 0);
+        }
+        return (node.stat == FilterStat::kSum ? sum : sum / smp_vect.size());
+    }
+    }
+}
+
+const std::string FilterExpr::GetNodeStr(const size_t i_node) const
+{
+    const Node &node = node_vect_[i_node];
+    std::ostringstream node_str;
+    if (node.type == NodeType::kPred)
+    {
+        node_str << kStatName[static_cast<size_t>(node.stat)] << "(" << group_name_vect_[node.i_group];
+        if (node.stat == FilterStat::kNb || node.stat == FilterStat::kFrac)
+        {
+            node_str << " " << kCmpName[static_cast<size_t>(node.stat_cmp)] << " " << node.stat_thres;
+        }
+        node_str << ") " << kCmpName[static_cast<size_t>(node.cmp)] << " " << node.thres;
+    }
+    else if (node.type == NodeType::kNot)
+    {
+        const bool is_pred = (node_vect_[node.child_vect[0]].type == NodeType::kPred);
+        node_str << "NOT " << (is_pred ? "" : "(") << GetNodeStr(node.child_vect[0]) << (is_pred ? "" : ")");
+    }
+    else
+    {
+        for (size_t i(0); i < node.child_vect.size(); ++i)
+        {
+            const bool need_paren = (node_vect_[node.child_vect[i]].type == NodeType::kAnd || node_vect_[node.child_vect[i]].type == NodeType::kOr);
+            node_str << (i == 0 ? "" : (node.type == NodeType::kAnd ? " AND " : " OR "))
+                     << (need_paren ? "(" : "") << GetNodeStr(node.child_vect[i]) << (need_paren ? ")" : "");
+        }
+    }
+    return node_str.str();
+}
@@ -0,0 +1,101 @@
+#ifndef KAMRAT_DATASTRUCT_FILTEREXPR_HPP
+#define KAMRAT_DATASTRUCT_FILTEREXPR_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+
+/* =============================== Filter Expression ================================ *\
+ * expr     := and { (OR | ||) and }                                                    *
+ * and      := not { (AND | &&) not }                                                   *
+ * not      := (NOT | !) not | '(' expr ')' | stat cmp NUM                              *
+ * stat     := (mean | median | min | max | sum) '(' GROUP ')'                          *
+ *           | (nb | frac) '(' GROUP cmp NUM ')'     samples of GROUP with count cmp NUM *
+ * cmp      := >= | > | <= | < | == | !=                                                *
+ * ---------------------------------------------------------------------------------- *
+ * GROUP is a sample group of the design file, or all for all samples of the index     *
+ * e.g. nb(tumor >= 5) >= 3 AND mean(normal) < 2 AND frac(all > 0) >= 0.1             *
+\* ================================================================================== */
+
+enum class FilterStat
+{
+    kMean,
+    kMedian,
+    kMin,
+    kMax,
+    kSum,
+    kNb,
+    kFrac
+};
+
+enum class FilterCmp
+{
+    kGe,
+    kGt,
+    kLe,
+    kLt,
+    kEq,
+    kNe
+};
+
+/** Filter expression over sample groups, parsed once into a tree of predicates on group statistics.
+ * Operands of AND and OR are ordered by increasing cost, so that cheap predicates short-circuit the expensive ones;
+ * statistics loop over 0/1 masks of the group samples, without branches, so that the compiler can vectorize them.
+ */
+class FilterExpr
+{
+public:
+    FilterExpr(const std::string &expr_str, const std::map<std::string, std::vector<size_t>> &group_map, size_t nb_smp);
+    const bool Eval(const float *count_arr) const; // count vector of nb_smp samples, callable from concurrent threads
+    const std::string GetStr() const;              // compiled expression, in evaluation order
+
+private:
+    enum class NodeType
+    {
+        kAnd,
+        kOr,
+        kNot,
+        kPred
+    };
+    struct Node
+    {
+        NodeType type;
+        std::vector<size_t> child_vect; // operands of AND, OR and NOT
+        FilterStat stat = FilterStat::kNb; // predicate: stat(group [stat_cmp stat_thres]) cmp thres
+        size_t i_group = 0;
+        FilterCmp stat_cmp = FilterCmp::kGe, cmp = FilterCmp::kGe;
+        float stat_thres = 0;
+        double thres = 0;
+        double cost = 0;
+    };
+
+    const size_t ParseOr();
+    const size_t ParseAnd();
+    const size_t ParseNot();
+    const size_t ParsePred();
+    const size_t GetGroup(const std::string &group_name);
+    const FilterCmp ParseCmp();
+    const double ParseNum();
+    const std::string ParseName();
+    const bool ParseWord(const std::string &word); // skip the word if it is next, AND, OR and NOT in any case
+    void SkipSpace();
+    const std::string GetErrPos() const;
+    void SortByCost(size_t i_node);
+
+    const bool EvalNode(size_t i_node, const float *count_arr) const;
+    const double CalcStat(const Node &node, const float *count_arr) const;
+    const std::string GetNodeStr(size_t i_node) const;
+
+    std::vector<Node> node_vect_;
+    size_t i_root_;
+    size_t nb_smp_;
+    std::vector<std::string> group_name_vect_;
+    std::vector<std::vector<uint32_t>> group_mask_vect_; // by group: 0/1 over all samples
+    std::vector<std::vector<size_t>> group_smp_vect_;    // by group: sample indices, for the median
+    const std::map<std::string, std::vector<size_t>> *group_map_; // parsing state
+    std::string expr_str_;
+    size_t i_char_;
+};
+
+#endif //KAMRAT_DATASTRUCT_FILTEREXPR_HPP
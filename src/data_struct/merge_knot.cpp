@@ -1,87 +1,220 @@
+#include <algorithm>
+
 #include "merge_knot.hpp"
 
+#define SERIAL_MASK 0xFFFFFFFFFFULL // 40 bits
+#define HAS_END (1ULL << 40)
+#define END_RC (1ULL << 41)
+#define AMBIGUOUS_CODE (HAS_END | SERIAL_MASK)
+
+const size_t MergeKnot::kMaxNbContig = SERIAL_MASK;
+template <typename fixCode_t>
+const fixCode_t FixKnotMap<fixCode_t>::kEmptyFix;
+
 MergeKnot::MergeKnot() noexcept
-    : has_pred_(false), has_succ_(false), has_ambiguity_(false)
+    : end_code_{0, 0}
 {
 }
 
-void MergeKnot::AddContig(const size_t contig_serial, const bool is_rc, const std::string &&which_to_set) noexcept
+void MergeKnot::AddContig(const size_t contig_serial, const bool is_rc, const Role role) noexcept
 {
-    if (which_to_set == "pred" && !has_pred_)
+    if (HasAmbiguity())
     {
-        pred_serial_ = contig_serial;
-        is_pred_rc_ = is_rc;
-        has_pred_ = true;
+        return;
     }
-    else if (which_to_set == "succ" && !has_succ_)
+    if (!(end_code_[role] & HAS_END))
     {
-        succ_serial_ = contig_serial;
-        is_succ_rc_ = is_rc;
-        has_succ_ = true;
+        end_code_[role] = (contig_serial | HAS_END | (is_rc ? END_RC : 0));
     }
     else
     {
-        has_ambiguity_ = true;
+        end_code_[kPred] = end_code_[kSucc] = AMBIGUOUS_CODE;
     }
 }
 
-const size_t MergeKnot::GetSerial(const std::string &&which_to_get) const noexcept
+const size_t MergeKnot::GetSerial(const Role role) const noexcept
+{
+    return (end_code_[role] & SERIAL_MASK);
+}
+
+const bool MergeKnot::IsRC(const Role role) const noexcept
+{
+    return (end_code_[role] & END_RC);
+}
+
+const bool MergeKnot::IsMergeable() const noexcept
+{
+    if (!(end_code_[kPred] & HAS_END) || !(end_code_[kSucc] & HAS_END))
+    {
+        return false;
+    }
+    if ((end_code_[kPred] & SERIAL_MASK) == (end_code_[kSucc] & SERIAL_MASK)) // also the case of ambiguity
+    {
+        return false;
+    }
+    return true;
+}
+
+const bool MergeKnot::HasPred() const noexcept
+{
+    return (end_code_[kPred] & HAS_END);
+}
+
+const bool MergeKnot::HasSucc() const noexcept
+{
+    return (end_code_[kSucc] & HAS_END);
+}
+
+const bool MergeKnot::HasAmbiguity() const noexcept
+{
+    return (end_code_[kPred] == AMBIGUOUS_CODE && end_code_[kSucc] == AMBIGUOUS_CODE);
+}
+
+template <typename fixCode_t>
+FixKnotMap<fixCode_t>::FixKnotMap() noexcept
+    : nb_knot_(0), shift_(64)
+{
+}
+
+template <typename fixCode_t>
+const size_t FixKnotMap<fixCode_t>::GetHome(const fixCode_t fix) const noexcept
 {
-    if (which_to_get == "pred")
+    return ((FoldCode(fix) * 0x9E3779B97F4A7C15ULL) >> shift_); // Fibonacci hashing: spread neighbouring codes over the table
+}
+
+template <typename fixCode_t>
+void FixKnotMap<fixCode_t>::Rehash(const size_t nb_slot)
+{
+    std::vector<value_type> old_slot_vect(nb_slot, value_type(kEmptyFix, MergeKnot()));
+    old_slot_vect.swap(slot_vect_);
+    shift_ = 64;
+    for (size_t n(nb_slot); n > 1; n >>= 1)
     {
-        return pred_serial_;
+        --shift_;
     }
-    else if (which_to_get == "succ")
+    const size_t mask = nb_slot - 1;
+    for (const auto &slot : old_slot_vect)
+    {
+        if (slot.first != kEmptyFix)
+        {
+            size_t i = GetHome(slot.first);
+            while (slot_vect_[i].first != kEmptyFix)
+            {
+                i = (i + 1) & mask;
+            }
+            slot_vect_[i] = slot;
+        }
+    }
+}
+
+template <typename fixCode_t>
+void FixKnotMap<fixCode_t>::reserve(const size_t nb_knot)
+{
+    size_t nb_slot(16);
+    while (nb_slot / 4 * 3 < nb_knot) // load factor kept under 3/4
     {
-        return succ_serial_;
+        nb_slot <<= 1;
     }
-    else // should not happen
+    if (nb_slot > slot_vect_.size())
     {
-        return 0;
+        Rehash(nb_slot);
     }
-    
 }
 
-const bool MergeKnot::IsRC(const std::string &&which_to_get) const noexcept
+template <typename fixCode_t>
+MergeKnot &FixKnotMap<fixCode_t>::operator[](const fixCode_t fix)
 {
-    if (which_to_get == "pred")
+    if ((nb_knot_ + 1) > slot_vect_.size() / 4 * 3)
     {
-        return is_pred_rc_;
+        reserve(nb_knot_ + 1);
     }
-    else if (which_to_get == "succ")
+    const size_t mask = slot_vect_.size() - 1;
+    size_t i = GetHome(fix);
+    while (slot_vect_[i].first != kEmptyFix && slot_vect_[i].first != fix)
     {
-        return is_succ_rc_;
+        i = (i + 1) & mask;
     }
-    else // should not happen
+    if (slot_vect_[i].first == kEmptyFix)
     {
-        return 0;
+        slot_vect_[i].first = fix;
+        ++nb_knot_;
     }
-    
+    return slot_vect_[i].second;
 }
 
-const bool MergeKnot::IsMergeable() const noexcept
+template <typename fixCode_t>
+typename FixKnotMap<fixCode_t>::iterator FixKnotMap<fixCode_t>::find(const fixCode_t fix) noexcept
 {
-    if (has_ambiguity_)
+    if (nb_knot_ == 0)
     {
-        return false;
+        return end();
     }
-    if (!has_pred_ || !has_succ_)
+    const size_t mask = slot_vect_.size() - 1;
+    for (size_t i = GetHome(fix); slot_vect_[i].first != kEmptyFix; i = (i + 1) & mask)
     {
-        return false;
+        if (slot_vect_[i].first == fix)
+        {
+            return iterator(slot_vect_.data() + i, slot_vect_.data() + slot_vect_.size());
+        }
     }
-    if (pred_serial_ == succ_serial_)
+    return end();
+}
+
+template <typename fixCode_t>
+void FixKnotMap<fixCode_t>::erase(const iterator it) noexcept
+{
+    // backward-shift deletion: move up the following slots of the probe run which are allowed to fill the hole, no tombstone needed
+    const size_t mask = slot_vect_.size() - 1;
+    size_t hole = it.slot_ - slot_vect_.data();
+    for (size_t i = (hole + 1) & mask; slot_vect_[i].first != kEmptyFix; i = (i + 1) & mask)
     {
-        return false;
+        const size_t home = GetHome(slot_vect_[i].first);
+        if (((i - home) & mask) >= ((i - hole) & mask)) // home is not within (hole, i]
+        {
+            slot_vect_[hole] = slot_vect_[i];
+            hole = i;
+        }
     }
-    return true;
+    slot_vect_[hole] = value_type(kEmptyFix, MergeKnot());
+    --nb_knot_;
 }
 
-const bool MergeKnot::HasPred() const noexcept
+template <typename fixCode_t>
+void FixKnotMap<fixCode_t>::clear() noexcept
 {
-    return has_pred_;
+    std::fill(slot_vect_.begin(), slot_vect_.end(), value_type(kEmptyFix, MergeKnot()));
+    nb_knot_ = 0;
 }
 
-const bool MergeKnot::HasSucc() const noexcept
+template <typename fixCode_t>
+const size_t FixKnotMap<fixCode_t>::size() const noexcept
+{
+    return nb_knot_;
+}
+
+template <typename fixCode_t>
+typename FixKnotMap<fixCode_t>::iterator FixKnotMap<fixCode_t>::begin() noexcept
+{
+    return iterator(slot_vect_.data(), slot_vect_.data() + slot_vect_.size());
+}
+
+template <typename fixCode_t>
+typename FixKnotMap<fixCode_t>::iterator FixKnotMap<fixCode_t>::end() noexcept
 {
-    return has_succ_;
-}
\ No newline at end of file
+    return iterator(slot_vect_.data() + slot_vect_.size(), slot_vect_.data() + slot_vect_.size());
+}
+
+template <typename fixCode_t>
+typename FixKnotMap<fixCode_t>::const_iterator FixKnotMap<fixCode_t>::begin() const noexcept
+{
+    return const_iterator(slot_vect_.data(), slot_vect_.data() + slot_vect_.size());
+}
+
+template <typename fixCode_t>
+typename FixKnotMap<fixCode_t>::const_iterator FixKnotMap<fixCode_t>::end() const noexcept
+{
+    return const_iterator(slot_vect_.data() + slot_vect_.size(), slot_vect_.data() + slot_vect_.size());
+}
+
+template class FixKnotMap<uint64_t>;
+template class FixKnotMap<uint128_t>;
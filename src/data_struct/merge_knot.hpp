@@ -2,24 +2,88 @@
 #define KAMRAT_MERGE_MERGEKNOT_H
 
 #include <string>
-#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "seq_coding.hpp"
 
 class MergeKnot
 {
 public:
+    enum Role // of a contig end in the knot: the contig preceding the fix, or succeeding it
+    {
+        kPred = 0,
+        kSucc = 1
+    };
+
     MergeKnot() noexcept;
-    void AddContig(size_t contig_serial, bool is_rc, const std::string &&which_to_set) noexcept;
-    const size_t GetSerial(const std::string &&which_to_get) const noexcept;
-    const bool IsRC(const std::string &&which_to_get) const noexcept;
+    void AddContig(size_t contig_serial, bool is_rc, Role role) noexcept;
+    const size_t GetSerial(Role role) const noexcept;
+    const bool IsRC(Role role) const noexcept;
     const bool IsMergeable() const noexcept;
     const bool HasPred() const noexcept;
     const bool HasSucc() const noexcept;
+    const bool HasAmbiguity() const noexcept;
+
+    static const size_t kMaxNbContig; // serials are stored on 40 bits
+
+private:
+    uint64_t end_code_[2]; // by role: serial in bits 0-39, then has-end and is-rc flags
+                           // an ambiguous knot has both ends, with the reserved serial kMaxNbContig
+};
+
+/** Open-addressing hash table with linear probing, replacing std::unordered_map<fixCode_t, MergeKnot>:
+ * knots are stored inline as slots instead of one heap node each. Fixes are codes of at most 62 bits (126 bits for uint128_t),
+ * all-one is the empty key. Only the operations used by merging are provided, with std::unordered_map names.
+ */
+template <typename fixCode_t = uint64_t>
+class FixKnotMap
+{
+public:
+    using value_type = std::pair<fixCode_t, MergeKnot>;
+    template <typename V>
+    class Iterator
+    {
+    public:
+        Iterator(V *slot, V *slot_end) noexcept : slot_(slot), slot_end_(slot_end) { SkipEmpty(); }
+        V &operator*() const noexcept { return *slot_; }
+        V *operator->() const noexcept { return slot_; }
+        Iterator &operator++() noexcept { ++slot_, SkipEmpty(); return *this; }
+        bool operator==(const Iterator &other) const noexcept { return slot_ == other.slot_; }
+        bool operator!=(const Iterator &other) const noexcept { return slot_ != other.slot_; }
+
+    private:
+        friend class FixKnotMap;
+        void SkipEmpty() noexcept { while (slot_ != slot_end_ && slot_->first == kEmptyFix) ++slot_; }
+        V *slot_, *slot_end_;
+    };
+    using iterator = Iterator<value_type>;
+    using const_iterator = Iterator<const value_type>;
+
+    FixKnotMap() noexcept;
+    void reserve(size_t nb_knot);
+    MergeKnot &operator[](fixCode_t fix); // insert an empty knot if absent
+    iterator find(fixCode_t fix) noexcept;
+    void erase(iterator it) noexcept;
+    void clear() noexcept;
+    const size_t size() const noexcept;
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
 
 private:
-    size_t pred_serial_, succ_serial_;
-    bool is_pred_rc_, has_pred_, is_succ_rc_, has_succ_, has_ambiguity_;
+    static const fixCode_t kEmptyFix = ~static_cast<fixCode_t>(0);
+    const size_t GetHome(fixCode_t fix) const noexcept;
+    void Rehash(size_t nb_slot);
+
+    std::vector<value_type> slot_vect_; // size is zero or a power of two
+    size_t nb_knot_;
+    unsigned int shift_; // 64 - log2(number of slots)
 };
 
-using fix2knot_t = std::unordered_map<uint64_t, MergeKnot>; // map for making results not dependent to k-mers' input order, but their sequence order
+template <typename fixCode_t = uint64_t>
+using fix2knot_t = FixKnotMap<fixCode_t>; // map for making results not dependent to k-mers' input order, but their sequence order
 
 #endif //KAMRAT_MERGE_MERGEKNOT_H
\ No newline at end of file
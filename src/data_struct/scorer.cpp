@@ -1,5 +1,7 @@
 #include <map>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 #include <boost/math/distributions/students_t.hpp>
 #include <mlpack/core.hpp>
 #include <mlpack/methods/logistic_regression/logistic_regression.hpp>
@@ -20,6 +22,7 @@ using namespace std;
  * lr            accuracy of logistic regression               [categorical supervised] *
  * nbc           accuracy of naive Bayes classifier            [categorical supervised] *
  * svm           accuracy of support vector machine            [categorical supervised] *
+ * lm            t-stat of condition in covariate linear model [categorical supervised] *
  * ------------------------------------------------------------------------------------ *
  * pearson       pearson correlation                            [continuous supervised] *
  * spearman      spearman correlation                           [continuous supervised] *
@@ -61,6 +64,10 @@ const ScorerCode ParseScorerCode(const std::string &scorer_str)
     {
         return ScorerCode::kSVM;
     }
+    else if (scorer_str == "lm")
+    {
+        return ScorerCode::kLM;
+    }
     else if (scorer_str == "pearson")
     {
         return ScorerCode::kPearson;
@@ -128,14 +135,15 @@ void ParseContinuousVector(std::vector<float> &target_vect, const std::vector<st
     }
 }
 
-const double Scorer::LogTtestScore(const std::vector<float> &values) const
+template <typename T>
+const double Scorer::TtestScore(const std::vector<T> &log_values) const
 {
    // Mean and std dev serie 1
     double sum1(0), sq_sum1(0), nb1(0);
     double sum2(0), sq_sum2(0), nb2(0);
     uint idx = 0;
-    for (float fvalue : values) {
-        double value = log2(static_cast<double>(fvalue) + 1);
+    for (T tvalue : log_values) {
+        double value = static_cast<double>(tvalue);
         double sq = value * value;
         if (this->categ_target_vect_[idx++] == 0) {
             sum1 += value;
@@ -171,6 +179,22 @@ const double Scorer::LogTtestScore(const std::vector<float> &values) const
         return praw;
 }
 
+const double Scorer::LogTtestScore(const std::vector<float> &values) const
+{
+    thread_local static std::vector<double> log_values;
+    log2p1(values, log_values);
+    return this->TtestScore(log_values);
+}
+
+const double Scorer::EstimateScoreFromLog(const std::vector<float> &log_count_vect) const
+{
+    if (scorer_code_ != ScorerCode::kTtestPadj && scorer_code_ != ScorerCode::kTtestPi)
+    {
+        throw std::domain_error("only t-test scorers accept log-transformed counts");
+    }
+    return this->TtestScore(log_count_vect);
+}
+
 
 const double CalcTtestScore_old(const arma::Mat<double> &&arma_count_vect1, const arma::Mat<double> &&arma_count_vect2, const bool return_pi)
 {
@@ -232,31 +256,36 @@ const double CalcSNRScore_old(const arma::Mat<double> &&arma_count_vect1, const
 }
 
 
-const double Scorer::CalcDIDSScore(const std::vector<float> count_vect) const
+const double Scorer::CalcDIDSScore(const std::vector<float> &count_vect) const
 {
-    // uint cpt = 0;
-    // Compute maxs
-    std::vector<double> max_refs(this->nclass_, 0);
-    for (uint i=0 ; i<count_vect.size() ; i++) {
-        if (count_vect[i] > max_refs[this->categ_target_vect_[i]]) {
-            max_refs[this->categ_target_vect_[i]] = count_vect[i];
-        }
+    thread_local static std::vector<double> max_refs, sqrt_sums;
+    const size_t nb_smp = count_vect.size();
+
+    // Compute the max of each condition in one pass
+    max_refs.assign(this->nclass_, std::numeric_limits<double>::lowest());
+    for (size_t i(0); i < nb_smp; ++i)
+    {
+        const double val = static_cast<double>(count_vect[i]);
+        double &ref_max = max_refs[this->categ_target_vect_[i]];
+        ref_max = (val > ref_max ? val : ref_max);
     }
 
-    // Compute scores
-    std::vector<double> sqrt_sums(this->nclass_, 0);
-    for (uint i=0 ; i<count_vect.size() ; i++) {
-        double val = static_cast<double>(count_vect[i]);
-        for (size_t label=0 ; label<this->nclass_ ; label++) {
-            if (label != this->categ_target_vect_[i] and val > max_refs[label]) {
-                // cpt ++;
-                sqrt_sums[label] += sqrt(val - max_refs[label]);
-            }
+    // Compute scores, samples of the reference condition never exceed its max so they contribute 0,
+    // the loop over all samples is thus branch-free and vectorizable
+    sqrt_sums.assign(this->nclass_, 0);
+    for (size_t i_condi(0); i_condi < this->nclass_; ++i_condi)
+    {
+        const double ref_max = max_refs[i_condi];
+        double sqrt_sum(0);
+        for (size_t i(0); i < nb_smp; ++i)
+        {
+            const double diff = static_cast<double>(count_vect[i]) - ref_max;
+            sqrt_sum += sqrt(diff > 0 ? diff : 0);
         }
+        sqrt_sums[i_condi] = sqrt_sum;
     }
 
-    // std::cout << cpt << std::endl;
-    return *std::max_element(sqrt_sums.begin(), sqrt_sums.end());
+    return *std::max_element(sqrt_sums.cbegin(), sqrt_sums.cend());
 }
 
 
@@ -327,6 +356,108 @@ const double CalcSVMScore(const size_t nfold, const arma::Row<size_t> &arma_cate
     }
 }
 
+void Scorer::BuildLinearModel(const std::vector<std::vector<std::string>> &col_covar_vect)
+{
+    // Design matrix: intercept, condition indicator, then one column per numeric covariate
+    // or one dummy column per non-reference level of a categorical covariate
+    const size_t nb_smp = categ_target_vect_.size();
+    std::vector<arma::Col<double>> design_col_vect;
+    design_col_vect.emplace_back(arma::ones<arma::Col<double>>(nb_smp));
+    design_col_vect.emplace_back(nb_smp);
+    for (size_t i(0); i < nb_smp; ++i) // same sign convention as SNR: first condition against the second
+    {
+        design_col_vect.back()[i] = (categ_target_vect_[i] == 0 ? 1 : 0);
+    }
+    for (const auto &covar_vect : col_covar_vect)
+    {
+        arma::Col<double> covar_col(nb_smp);
+        bool is_numeric(true);
+        for (size_t i(0); i < nb_smp && is_numeric; ++i)
+        {
+            size_t end_pos(0);
+            try
+            {
+                covar_col[i] = std::stod(covar_vect[i], &end_pos);
+            }
+            catch (const std::logic_error &)
+            {
+                end_pos = 0;
+            }
+            is_numeric = (end_pos == covar_vect[i].size());
+        }
+        if (is_numeric)
+        {
+            design_col_vect.emplace_back(covar_col);
+            continue;
+        }
+        std::map<std::string, size_t> level2col;
+        for (size_t i(0); i < nb_smp; ++i) // the level of the first sample is taken as reference
+        {
+            if (level2col.insert({covar_vect[i], level2col.size()}).second && level2col.size() > 1)
+            {
+                design_col_vect.emplace_back(arma::zeros<arma::Col<double>>(nb_smp));
+            }
+        }
+        const size_t first_dummy = design_col_vect.size() - (level2col.size() - 1);
+        for (size_t i(0); i < nb_smp; ++i)
+        {
+            const size_t i_level = level2col[covar_vect[i]];
+            if (i_level > 0)
+            {
+                design_col_vect[first_dummy + i_level - 1][i] = 1;
+            }
+        }
+    }
+
+    const size_t nb_coef = design_col_vect.size();
+    if (nb_smp <= nb_coef)
+    {
+        throw std::domain_error("scoring by lm needs more samples than model coefficients: " +
+                                std::to_string(nb_smp) + "<=" + std::to_string(nb_coef));
+    }
+    arma::Mat<double> design_mat(nb_smp, nb_coef), q_mat, r_mat;
+    for (size_t j(0); j < nb_coef; ++j)
+    {
+        design_mat.col(j) = design_col_vect[j];
+    }
+    // Factor the design once, X = QR, then (X'X)^-1 X' = R^-1 Q' and diag((X'X)^-1) = rowwise ||R^-1||^2
+    if (!arma::qr_econ(q_mat, r_mat, design_mat))
+    {
+        throw std::domain_error("QR decomposition of the lm design matrix failed");
+    }
+    const arma::Col<double> r_diag = arma::abs(r_mat.diag());
+    if (r_diag.min() <= 1e-10 * r_diag.max())
+    {
+        throw std::domain_error("lm design matrix is rank deficient, please check condition and covariate columns");
+    }
+    const arma::Mat<double> r_inv = arma::inv(arma::trimatu(r_mat));
+    const arma::Row<double> coef_row = r_inv.row(1);
+    lm_proj_mat_ = arma::join_rows(q_mat * coef_row.t(), q_mat);
+    lm_coef_var_ = arma::accu(arma::square(coef_row));
+    lm_df_ = nb_smp - nb_coef;
+}
+
+void Scorer::EstimateScoreBlock(std::vector<double> &scores, const arma::Mat<double> &count_block) const
+{
+    if (scorer_code_ != ScorerCode::kLM)
+    {
+        throw std::domain_error("block estimation is not available for scoring method " + GetScorerName());
+    }
+    // Per-feature regressions as one GEMM: the first row holds the condition coefficients,
+    // the others the projections on the design space, the remainder giving the residual sum of squares
+    const arma::Mat<double> log_block = arma::log2(count_block + 1);
+    const arma::Mat<double> proj_block = lm_proj_mat_.t() * log_block;
+    const arma::Row<double> rss_row = arma::sum(arma::square(log_block), 0) -
+                                      arma::sum(arma::square(proj_block.rows(1, proj_block.n_rows - 1)), 0);
+    scores.reserve(scores.size() + count_block.n_cols);
+    for (size_t i_ft(0); i_ft < count_block.n_cols; ++i_ft)
+    {
+        const double rss = (rss_row[i_ft] > 0 ? rss_row[i_ft] : 0),
+                     std_err = sqrt(rss / lm_df_ * lm_coef_var_);
+        scores.push_back(std_err > 0 ? proj_block(0, i_ft) / std_err : 0);
+    }
+}
+
 const double Scorer::CalcPearsonScore(const std::vector<float> &count_vect) const
 {
     return CalcPearsonCorr(this->cntnu_target_vect_, count_vect);
@@ -445,12 +576,15 @@ const double CalcEntropyScore_old(const arma::Mat<double> &arma_count_vect)
     return (-entropy);
 }
 
-Scorer::Scorer(const std::string &scorer_str, size_t nfold, const std::vector<std::string> &col_target_vect)
-    : scorer_code_(ParseScorerCode(scorer_str)), nfold_((nfold == 0 ? col_target_vect.size() : nfold)), nclass_(0)
+Scorer::Scorer(const std::string &scorer_str, size_t nfold, const std::vector<std::string> &col_target_vect,
+               const std::vector<std::vector<std::string>> &col_covar_vect)
+    : scorer_code_(ParseScorerCode(scorer_str)), nfold_((nfold == 0 ? col_target_vect.size() : nfold)), nclass_(0),
+      lm_coef_var_(0), lm_df_(0)
 {
     if (scorer_code_ == ScorerCode::kTtestPadj || scorer_code_ == ScorerCode::kTtestPi ||
         scorer_code_ == ScorerCode::kSNR || scorer_code_ == ScorerCode::kDIDS ||
-        scorer_code_ == ScorerCode::kLR || scorer_code_ == ScorerCode::kBayes || scorer_code_ == ScorerCode::kSVM) // feature selection with categorical output
+        scorer_code_ == ScorerCode::kLR || scorer_code_ == ScorerCode::kBayes || scorer_code_ == ScorerCode::kSVM ||
+        scorer_code_ == ScorerCode::kLM) // feature selection with categorical output
     {
         nclass_ = ParseCategoricalVector(arma_categ_target_vect_, categ_target_vect_, col_target_vect);
     }
@@ -459,14 +593,18 @@ Scorer::Scorer(const std::string &scorer_str, size_t nfold, const std::vector<st
         ParseContinuousVector(cntnu_target_vect_, col_target_vect);
     }
     if (nclass_ != 2 && (scorer_code_ == ScorerCode::kTtestPadj || scorer_code_ == ScorerCode::kTtestPi ||
-                         scorer_code_ == ScorerCode::kSNR || scorer_code_ == ScorerCode::kLR))
+                         scorer_code_ == ScorerCode::kSNR || scorer_code_ == ScorerCode::kLR || scorer_code_ == ScorerCode::kLM))
     {
-        throw std::domain_error("scoring by t-test, SNR, and LR only accept binary sample condition: " + std::to_string(nclass_));
+        throw std::domain_error("scoring by t-test, SNR, LR, and lm only accept binary sample condition: " + std::to_string(nclass_));
     }
     if (nclass_ < 2 && (scorer_code_ == ScorerCode::kDIDS || scorer_code_ == ScorerCode::kBayes || scorer_code_ == ScorerCode::kSVM))
     {
         throw std::domain_error("scoring by DIDS, Bayes or SVM only accepts condition number >= 2");
     }
+    if (scorer_code_ == ScorerCode::kLM)
+    {
+        BuildLinearModel(col_covar_vect);
+    }
 }
 
 const ScorerCode Scorer::GetScorerCode() const
@@ -491,8 +629,8 @@ const double Scorer::EstimateScore(std::vector<float> &count_vect) const
         return this->LogTtestScore(count_vect);
     case ScorerCode::kSNR:
         return this->CalcSNRScore(count_vect);
-    // case ScorerCode::kDIDS:
-    //     return this->CalcDIDSScore(count_vect);
+    case ScorerCode::kDIDS:
+        return this->CalcDIDSScore(count_vect);
     case ScorerCode::kSD:
         return this->CalcSDScore(count_vect);
     case ScorerCode::kRSD1:
@@ -503,6 +641,13 @@ const double Scorer::EstimateScore(std::vector<float> &count_vect) const
         return this->CalcRSD3Score(count_vect);
     case ScorerCode::kEntropy:
         return this->CalcEntropyScore(count_vect);
+    case ScorerCode::kLM:
+    {
+        thread_local static std::vector<double> lm_score;
+        lm_score.clear();
+        this->EstimateScoreBlock(lm_score, arma::conv_to<arma::Col<double>>::from(count_vect));
+        return lm_score[0];
+    }
     case ScorerCode::kPearson:
         return CalcPearsonScore(count_vect);
     case ScorerCode::kSpearman:
@@ -515,7 +660,7 @@ const double Scorer::EstimateScore(std::vector<float> &count_vect) const
 
 const double Scorer::EstimateScore_old(const std::vector<float> &count_vect) const
 {
-    static arma::Mat<double> arma_count_vect;
+    thread_local static arma::Mat<double> arma_count_vect;
     arma_count_vect = arma::conv_to<arma::Row<double>>::from(count_vect);
     // arma_count_vect.print("Count vector before transformation: ");
     if (scorer_code_ == ScorerCode::kTtestPadj || scorer_code_ == ScorerCode::kTtestPi) // if t-test, apply log2(x + 1) transformation
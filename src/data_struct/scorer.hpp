@@ -15,6 +15,7 @@ enum ScorerCode
     kLR,
     kBayes,
     kSVM,
+    kLM,
     kPearson,
     kSpearman,
     kSD,
@@ -23,19 +24,26 @@ enum ScorerCode
     kRSD3,
     kEntropy
 };
-const std::vector<std::string> kScorerNameVect{"ttest.padj", "ttest.pi", "SNR", "DIDS.score", "LR.acc", "Bayes.acc", "SVM.acc",
+const std::vector<std::string> kScorerNameVect{"ttest.padj", "ttest.pi", "SNR", "DIDS.score", "LR.acc", "Bayes.acc", "SVM.acc", "LM.tstat",
                                                "pearson", "spearman",
                                                "sd", "rsd1", "rsd2", "rsd3", "entropy"};
 
 class Scorer
 {
 public:
-    Scorer(const std::string &scorer_str, size_t nfold, const std::vector<std::string> &col_target_vect);
+    Scorer(const std::string &scorer_str, size_t nfold, const std::vector<std::string> &col_target_vect,
+           const std::vector<std::vector<std::string>> &col_covar_vect = std::vector<std::vector<std::string>>());
 
     const ScorerCode GetScorerCode() const;
     const std::string &GetScorerName() const;
     const double EstimateScore(std::vector<float> &count_vect) const;
     const double EstimateScore_old(const std::vector<float> &count_vect) const;
+    /** Score a block of features at once, count_block holding one feature per column (nb_smp x nb_feature).
+     * Only batched scorers (lm) are accepted, scores are appended to the given vector. */
+    void EstimateScoreBlock(std::vector<double> &scores, const arma::Mat<double> &count_block) const;
+    /** Score from counts already transformed by log2(x + 1), e.g. loaded from idx-log.bin.
+     * Only t-test scorers are accepted. */
+    const double EstimateScoreFromLog(const std::vector<float> &log_count_vect) const;
 
 private:
     const ScorerCode scorer_code_;             // scoring method code
@@ -44,10 +52,17 @@ private:
     std::vector<size_t> categ_target_vect_;
     std::vector<float> cntnu_target_vect_;     // continuous target vector
     size_t nclass_;                            // classification fold number
+    arma::Mat<double> lm_proj_mat_;            // lm: coefficient row of (X'X)^-1 X' in the first column, Q of design QR in the others
+    double lm_coef_var_;                       // lm: diagonal term of (X'X)^-1 for the condition coefficient
+    size_t lm_df_;                             // lm: residual degree of freedom
+
+    void BuildLinearModel(const std::vector<std::vector<std::string>> &col_covar_vect);
 
     const double LogTtestScore(const std::vector<float> &values) const;
+    template <typename T>
+    const double TtestScore(const std::vector<T> &log_values) const;
     const double CalcSNRScore(const std::vector<float> & count_vect) const;
-    const double CalcDIDSScore(const std::vector<float> count_vect) const;
+    const double CalcDIDSScore(const std::vector<float> &count_vect) const;
     const double CalcPearsonScore(const std::vector<float> &count_vect) const;
     const double CalcSpearmanScore(const std::vector<float> &count_vect) const;
     const double CalcSDScore(const std::vector<float> & count_vect) const;
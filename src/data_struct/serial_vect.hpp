@@ -0,0 +1,75 @@
+#ifndef KAMRAT_DATASTRUCT_SERIALVECT_HPP
+#define KAMRAT_DATASTRUCT_SERIALVECT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/** Vector of serials on 40 bits, in 5 bytes each instead of 8: low 32 bits and high 8 bits are kept in two arrays.
+ * Serials go up to kNoSerial - 1, kNoSerial standing for no serial. Elements are distinct bytes, so that threads may set distinct elements.
+ * Only the operations used by merging are provided, with std::vector names.
+ */
+class SerialVect
+{
+public:
+    static const uint64_t kNoSerial = (1ULL << 40) - 1;
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const SerialVect *vect, size_t i) noexcept : vect_(vect), i_(i) {}
+        uint64_t operator*() const noexcept { return (*vect_)[i_]; }
+        const_iterator &operator++() noexcept { ++i_; return *this; }
+        bool operator==(const const_iterator &other) const noexcept { return i_ == other.i_; }
+        bool operator!=(const const_iterator &other) const noexcept { return i_ != other.i_; }
+
+    private:
+        const SerialVect *vect_;
+        size_t i_;
+    };
+
+    SerialVect() noexcept {}
+    explicit SerialVect(size_t nb_elem, uint64_t serial = kNoSerial)
+        : low_vect_(nb_elem, static_cast<uint32_t>(serial)), high_vect_(nb_elem, static_cast<uint8_t>(serial >> 32)) {}
+    uint64_t operator[](size_t i) const noexcept { return (low_vect_[i] | (static_cast<uint64_t>(high_vect_[i]) << 32)); }
+    void set(size_t i, uint64_t serial) noexcept
+    {
+        low_vect_[i] = static_cast<uint32_t>(serial);
+        high_vect_[i] = static_cast<uint8_t>(serial >> 32);
+    }
+    void push_back(uint64_t serial)
+    {
+        low_vect_.push_back(static_cast<uint32_t>(serial));
+        high_vect_.push_back(static_cast<uint8_t>(serial >> 32));
+    }
+    void resize(size_t nb_elem, uint64_t serial = kNoSerial)
+    {
+        low_vect_.resize(nb_elem, static_cast<uint32_t>(serial));
+        high_vect_.resize(nb_elem, static_cast<uint8_t>(serial >> 32));
+    }
+    void reserve(size_t nb_elem)
+    {
+        low_vect_.reserve(nb_elem);
+        high_vect_.reserve(nb_elem);
+    }
+    void clear() noexcept
+    {
+        low_vect_.clear();
+        high_vect_.clear();
+    }
+    void shrink_to_fit()
+    {
+        low_vect_.shrink_to_fit();
+        high_vect_.shrink_to_fit();
+    }
+    size_t size() const noexcept { return low_vect_.size(); }
+    bool empty() const noexcept { return low_vect_.empty(); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size()); }
+
+private:
+    std::vector<uint32_t> low_vect_;
+    std::vector<uint8_t> high_vect_;
+};
+
+#endif //KAMRAT_DATASTRUCT_SERIALVECT_HPP
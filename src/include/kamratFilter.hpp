@@ -1,2 +1,14 @@
+#ifndef KAMRAT_KAMRATFILTER_HPP
+#define KAMRAT_KAMRATFILTER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
 
 int FilterMain(int argc, char *argv[]);
+
+/** Sample groups of the design file for a filter expression, shared by kamrat filter and kamrat pipeline. */
+void ParseGroups(std::map<std::string, std::vector<size_t>> &group_map, const std::string &dsgn_path,
+                 const std::vector<std::string> &colname_vect, const size_t nb_smp);
+
+#endif //KAMRAT_KAMRATFILTER_HPP
@@ -1 +1,17 @@
-int MaskMain(int argc, char *argv[]);
\ No newline at end of file
+#ifndef KAMRAT_KAMRATMASK_HPP
+#define KAMRAT_KAMRATMASK_HPP
+
+#include <string>
+#include <vector>
+
+int MaskMain(int argc, char *argv[]);
+int MaskBuildMain(int argc, char *argv[]);
+
+/** Sorted array of the distinct k-mer codes of the mask sequences, shared by kamrat mask and kamrat pipeline.
+ * Instantiated for uint64_t and uint128_t k-mer codes.
+ */
+template <typename kmerCode_t>
+void MakeMask(std::vector<kmerCode_t> &kmer_mask, const std::string &mask_file_path, const size_t k_len, const bool stranded,
+              const size_t nb_thread);
+
+#endif //KAMRAT_KAMRATMASK_HPP
@@ -1,2 +1,28 @@
+#ifndef KAMRAT_KAMRATMERGE_HPP
+#define KAMRAT_KAMRATMERGE_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+class ContigStore; // in data_struct/contig_store.hpp
+class ContigSpool; // in data_struct/bucket_files.hpp
 
 int MergeMain(int argc, char *argv[]);
+
+/** Merge the contigs of the store from overlap max_ovlp down to min_ovlp, then print them, shared by kamrat merge and kamrat pipeline. */
+void MergeAndPrint(ContigStore &ctg_store, const bool has_value, std::ifstream &idx_mat, const std::vector<std::string> &colname_vect,
+                   const size_t nb_smp, const size_t k_len, const bool stranded, const size_t max_ovlp, const size_t min_ovlp,
+                   const std::string &rep_mode, const std::string &itv_mthd, const float itv_thres, const size_t min_nbkmer,
+                   const size_t nb_thread, const size_t cache_mem, const std::string &out_path, const std::string &out_mode);
+
+/** The same out of core, in nb_bucket disk buckets under tmp_dir with at most max_mem MB of buckets in memory, for the same output. */
+void MergeAndPrint(ContigSpool &ctg_spool, const bool has_value, std::ifstream &idx_mat, const std::vector<std::string> &colname_vect,
+                   const size_t nb_smp, const size_t k_len, const bool stranded, const size_t max_ovlp, const size_t min_ovlp,
+                   const std::string &rep_mode, const std::string &itv_mthd, const float itv_thres, const size_t min_nbkmer,
+                   const size_t nb_thread, const size_t max_mem, const size_t nb_bucket, const std::string &tmp_dir,
+                   const std::string &out_path, const std::string &out_mode);
+
+const std::string GetMergeTmpPrefix(const std::string &tmp_dir); // path prefix of the bucket files of this run
+
+#endif //KAMRAT_KAMRATMERGE_HPP
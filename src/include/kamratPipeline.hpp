@@ -0,0 +1 @@
+int PipelineMain(int argc, char *argv[]);
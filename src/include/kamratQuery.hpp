@@ -1 +1,23 @@
-int QueryMain(int argc, char *argv[]);
\ No newline at end of file
+#ifndef KAMRAT_KAMRATQUERY_HPP
+#define KAMRAT_KAMRATQUERY_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct SeqRecord;                                    // in utils/seq_reader.hpp
+template <typename kmerCode_t> class MappedIndex;    // in utils/mapped_index.hpp
+
+int QueryMain(int argc, char *argv[]);
+
+/** Header line of query results: the index column names, after the read statistics for a per-read profile. */
+void PrintQueryHeader(std::ostream &res_out, const std::vector<std::string> &colname_vect, const bool as_profile);
+
+/** Query a batch of sequences and write their rows in input order, shared by kamrat query and kamrat serve.
+ * Instantiated for uint64_t and uint128_t k-mer codes.
+ */
+template <typename kmerCode_t>
+void QueryBatch(std::ostream &res_out, const std::vector<SeqRecord> &seq_batch, const std::string &query_mthd,
+                const MappedIndex<kmerCode_t> &mapped_idx, const bool with_absent, const bool as_profile, const size_t nb_thread);
+
+#endif //KAMRAT_KAMRATQUERY_HPP
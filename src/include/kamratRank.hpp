@@ -1 +1,28 @@
-int RankMain(int argc, char *argv[]);
\ No newline at end of file
+#ifndef KAMRAT_KAMRATRANK_HPP
+#define KAMRAT_KAMRATRANK_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Scorer; // in data_struct/scorer.hpp
+
+int RankMain(int argc, char *argv[]);
+
+/** Read sample conditions (and covariates) from the design file, in the order of the index columns. */
+void ParseDesign(std::vector<std::string> &col_target_vect, std::vector<std::vector<std::string>> &col_covar_vect,
+                 const std::string &dsgn_path, const std::vector<std::string> &colname_vect);
+
+/** Number of features selected by -seltop: all if not positive, a ratio of features if below 1, a number otherwise. */
+const size_t CountTopSelect(const float sel_top, const size_t nb_features);
+
+/** Adjust p-values sorted increasingly by BH procedure, in place. */
+void AdjustPValueBH(std::vector<double> &pval_vect);
+
+/** Sort feature indexes from the best score to the worst, adjusting p-values in place for ttest.padj,
+ * shared by kamrat score and kamrat pipeline.
+ * @return Number of top features to select following -seltop
+ */
+const size_t RankTopFeatures(std::vector<double> &scores, std::vector<uint64_t> &features, const Scorer &scorer, const float sel_top);
+
+#endif //KAMRAT_KAMRATRANK_HPP
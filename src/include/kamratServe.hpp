@@ -0,0 +1 @@
+int ServeMain(int argc, char *argv[]);
\ No newline at end of file
@@ -9,7 +9,7 @@ void FilterWelcome()
 
 void PrintFilterHelper()
 {
-    std::cerr << "[USAGE]    kamrat filter -idxdir STR -design STR [-upmin INT1:INT2 -downmax INT1:INT2 -reverse -outpath STR -withcounts]" << std::endl
+    std::cerr << "[USAGE]    kamrat filter -idxdir STR -design STR [-upmin INT1:INT2 -downmax INT1:INT2 | -expr STR] [-reverse -nthread INT -outpath STR -withcounts]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]    -h,-help              Print the helper" << std::endl;
     std::cerr << "            -idxdir STR           Indexing folder by KaMRaT index, mandatory" << std::endl;
@@ -19,12 +19,22 @@ void PrintFilterHelper()
               << "                                          samples with UP will be considered as up-regulated samples" << std::endl
               << "                                          samples with DOWN will be considered as down-regulated samples" << std::endl
               << "                                          samples not given will be neutral (not considered for filter)" << std::endl
-              << "                                          samples can also be all UP or all DOWN" << std::endl;
+              << "                                          samples can also be all UP or all DOWN" << std::endl
+              << "                                      with -expr, the second column is a sample group of any name, and the file is optional" << std::endl;
     std::cerr << "            -upmin INT1:INT2      Up feature lower bound, [1:1, meaning no filter]" << std::endl
               << "                                      output features counting >= INT1 in >= INT2 UP-samples" << std::endl;
     std::cerr << "            -downmax INT1:INT2    Down feature upper bound [inf:1, meaning no filter]" << std::endl
               << "                                      output features counting <= INT1 in >= INT2 DOWN-samples" << std::endl;
+    std::cerr << "            -expr STR             Filter expression over sample groups, instead of -upmin and -downmax" << std::endl
+              << "                                      predicates STAT(GROUP) CMP NUM, joined by AND, OR, NOT and parentheses" << std::endl
+              << "                                      STAT can be one of mean, median, min, max, sum" << std::endl
+              << "                                          or nb, frac of samples in the group, as nb(GROUP CMP NUM)" << std::endl
+              << "                                      CMP can be one of >=, >, <=, <, ==, !=" << std::endl
+              << "                                      GROUP can be a group in design file, or all for all samples" << std::endl
+              << "                                      e.g. \"nb(tumor >= 5) >= 3 AND mean(normal) < 2 AND frac(all > 0) >= 0.1\"" << std::endl;
     std::cerr << "            -reverse              Reverse filter, to remove eligible features [false]" << std::endl;
+    std::cerr << "            -nthread INT          Number of threads for filtering features [1]" << std::endl
+              << "                                      results do not depend on the number of threads" << std::endl;
     std::cerr << "            -outpath STR          Path to results after filter" << std::endl
               << "                                      if not provided, output to screen" << std::endl;
     std::cerr << "            -withcounts           Output sample count vectors [false]" << std::endl
@@ -32,21 +42,29 @@ void PrintFilterHelper()
 }
 
 void PrintRunInfo(const std::string &idx_dir,
-                  const std::string &dsgn_path,
+                  const std::string &dsgn_path, const std::string &expr_str,
                   const size_t up_min_abd, const size_t up_min_rec,
                   const size_t down_max_abd, const size_t down_min_rec,
-                  const bool reverse_filter,
+                  const bool reverse_filter, const size_t nb_thread,
                   const std::string &out_path, const bool with_counts)
 {
     std::cerr << std::endl;
     std::cerr << "KaMRaT index:                  " << idx_dir << std::endl;
-    std::cerr << "Path to filter design file:    " << dsgn_path << std::endl;
-    std::cerr << "Up-regulated lower bound:      " << std::endl
-              << "\tfeatures counting >= " << up_min_abd << " in >= " << up_min_rec << " up-regulated samples" << std::endl;
-    std::cerr << "Down-regulated upper bound:    " << std::endl
-              << "\tfeatures counting <= " << (down_max_abd == std::numeric_limits<size_t>::max() ? "inf" : std::to_string(down_max_abd))
-              << " in >= " << down_min_rec << " down-regulated samples" << std::endl;
+    std::cerr << "Path to filter design file:    " << (dsgn_path.empty() ? "none" : dsgn_path) << std::endl;
+    if (!expr_str.empty())
+    {
+        std::cerr << "Filter expression:             " << expr_str << std::endl;
+    }
+    else
+    {
+        std::cerr << "Up-regulated lower bound:      " << std::endl
+                  << "\tfeatures counting >= " << up_min_abd << " in >= " << up_min_rec << " up-regulated samples" << std::endl;
+        std::cerr << "Down-regulated upper bound:    " << std::endl
+                  << "\tfeatures counting <= " << (down_max_abd == std::numeric_limits<size_t>::max() ? "inf" : std::to_string(down_max_abd))
+                  << " in >= " << down_min_rec << " down-regulated samples" << std::endl;
+    }
     std::cerr << "Remove eligible features:      " << (reverse_filter ? "True" : "False") << std::endl;
+    std::cerr << "Number of threads:             " << nb_thread << std::endl;
     std::cerr << "Output:                        " << (out_path.empty() ? "to screen" : out_path) << ", ";
     std::cerr << (with_counts ? "with" : "without") << " count vectors" << std::endl
               << std::endl;
@@ -54,10 +72,10 @@ void PrintRunInfo(const std::string &idx_dir,
 
 void ParseOptions(int argc, char *argv[],
                   std::string &idx_dir,
-                  std::string &dsgn_path,
+                  std::string &dsgn_path, std::string &expr_str,
                   size_t &up_min_abd, size_t &up_min_rec,
                   size_t &down_max_abd, size_t &down_min_rec,
-                  bool &reverse_filter,
+                  bool &reverse_filter, size_t &nb_thread,
                   std::string &out_path, bool &with_counts)
 {
     int i_opt(1);
@@ -67,6 +85,7 @@ void ParseOptions(int argc, char *argv[],
         exit(EXIT_SUCCESS);
     }
     size_t split_pos;
+    bool with_threshold(false);
     std::string arg;
     while (i_opt < argc && argv[i_opt][0] == '-')
     {
@@ -92,6 +111,7 @@ void ParseOptions(int argc, char *argv[],
             {
                 up_min_abd = std::stoul(arg.substr(0, split_pos));
                 up_min_rec = std::stoul(arg.substr(split_pos + 1));
+                with_threshold = true;
             }
             else
             {
@@ -106,16 +126,25 @@ void ParseOptions(int argc, char *argv[],
             {
                 down_max_abd = std::stoul(arg.substr(0, split_pos));
                 down_min_rec = std::stoul(arg.substr(split_pos + 1));
+                with_threshold = true;
             }
             else
             {
                 throw std::invalid_argument("unable to parse -downmax argument: " + arg);
             }
         }
+        else if (arg == "-expr" && i_opt + 1 < argc)
+        {
+            expr_str = argv[++i_opt];
+        }
         else if (arg == "-reverse")
         {
             reverse_filter = true;
         }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
         else if (arg == "-outpath" && i_opt + 1 < argc)
         {
             out_path = argv[++i_opt];
@@ -141,11 +170,21 @@ void ParseOptions(int argc, char *argv[],
         PrintFilterHelper();
         throw std::invalid_argument("-idxdir STR is mandatory");
     }
-    if (dsgn_path.empty())
+    if (dsgn_path.empty() && expr_str.empty())
     {
         PrintFilterHelper();
         throw std::domain_error("-design STR is mandatory");
     }
+    if (!expr_str.empty() && with_threshold)
+    {
+        PrintFilterHelper();
+        throw std::invalid_argument("-expr cannot be given together with -upmin or -downmax");
+    }
+    if (nb_thread == 0)
+    {
+        PrintFilterHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
 }
 
 #endif //KAMRAT_RUNINFOFILES_FILTERRUNINFO_HPP
@@ -9,12 +9,12 @@ void IndexWelcome()
 
 void PrintIndexHelper()
 {
-    std::cerr << "[USAGE]    kamrat index -intab STR -outdir STR [-klen INT -unstrand -nfbase INT]" << std::endl
+    std::cerr << "[USAGE]    kamrat index -intab STR -outdir STR [-klen INT -unstrand -nfbase INT -logcache]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]   -h, -help      Print the helper" << std::endl;
     std::cerr << "           -intab STR     Input table for index, mandatory" << std::endl;
     std::cerr << "           -outdir STR    Output index directory, mandatory" << std::endl;
-    std::cerr << "           -klen          k-mer length, mandatory if features are k-mer" << std::endl
+    std::cerr << "           -klen          k-mer length, mandatory if features are k-mer, at most 64" << std::endl
               << "                              if present, indexation will be switched to k-mer mode" << std::endl;
     std::cerr << "           -unstrand      Unstranded mode, indexation with canonical k-mers" << std::endl
               << "                              if present, indexation will be switched to k-mer mode" << std::endl;
@@ -22,13 +22,14 @@ void PrintIndexHelper()
               << "                              normCount_ij <- INT * rawCount_ij / sum_i{rawCount_ij}" << std::endl
               << "                              if not provided, input counts will not be normalized" << std::endl
               << "           -nffile STR    File for loading normalization factor, not compatible with -nfbase INT" << std::endl
-              << "                              a tab-separated row of normalization factors, same order as table header" << std::endl
+              << "                              a tab-separated row of normalization factors, same order as table header" << std::endl;
+    std::cerr << "           -logcache      Also store log2(count + 1) transformed counts, used by t-test scoring" << std::endl
               << std::endl;
 }
 
 void PrintRunInfo(const std::string &count_tab_path, const std::string &out_dir,
                   const size_t k_len, const bool stranded,
-                  const size_t nf_base, const std::string &nf_file_path)
+                  const size_t nf_base, const std::string &nf_file_path, const bool log_cache)
 {
     std::cerr << "Count table path:             " << count_tab_path << std::endl;
     std::cerr << "Output index directory:       " << out_dir << std::endl;
@@ -49,11 +50,15 @@ void PrintRunInfo(const std::string &count_tab_path, const std::string &out_dir,
     {
         std::cerr << "Normalization factor from:    " << nf_file_path << std::endl;
     }
+    if (log_cache)
+    {
+        std::cerr << "Log-transformed count cache:  " << out_dir << "/idx-log.bin" << std::endl;
+    }
     std::cerr << std::endl;
 }
 
 void ParseOptions(int argc, char *argv[], std::string &count_tab_path, std::string &out_dir,
-                  size_t &k_len, bool &stranded, size_t &nf_base, std::string &nf_file_path)
+                  size_t &k_len, bool &stranded, size_t &nf_base, std::string &nf_file_path, bool &log_cache)
 {
     int i_opt(1);
     if (argc == 1)
@@ -104,6 +109,10 @@ void ParseOptions(int argc, char *argv[], std::string &count_tab_path, std::stri
             }
             nf_file_path = argv[++i_opt];
         }
+        else if (arg == "-logcache")
+        {
+            log_cache = true;
+        }
         else
         {
             PrintIndexHelper();
@@ -131,6 +140,11 @@ void ParseOptions(int argc, char *argv[], std::string &count_tab_path, std::stri
         PrintIndexHelper();
         throw std::invalid_argument("k-mer length in mandatory if indexing in k-mer mode");
     }
+    if (k_len > 64)
+    {
+        PrintIndexHelper();
+        throw std::invalid_argument("k-mer length should not exceed 64");
+    }
 }
 
 #endif //KAMRAT_RUNINFOFILES_INDEXRUNINFO_HPP
\ No newline at end of file
@@ -9,12 +9,15 @@ void MaskWelcome()
 
 inline void PrintMaskHelper()
 {
-    std::cerr << "[USAGE]    kamrat mask -idxdir STR -fasta STR [-reverse -outpath STR -withcounts]" << std::endl
+    std::cerr << "[USAGE]    kamrat mask -idxdir STR -fasta STR|-maskidx STR [-reverse -nthread INT -outpath STR -withcounts]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]    -h,-help         Print the helper" << std::endl;
     std::cerr << "            -idxdir STR      Indexing folder by KaMRaT index, mandatory" << std::endl;
-    std::cerr << "            -fasta STR       Sequence fasta file as the mask, mandatory" << std::endl;
+    std::cerr << "            -fasta STR       Sequence fasta file as the mask, mandatory unless -maskidx is given" << std::endl
+              << "                                 fasta or fastq, gzipped if the file name ends with gz" << std::endl;
+    std::cerr << "            -maskidx STR     Mask index by KaMRaT mask-build, instead of -fasta" << std::endl;
     std::cerr << "            -reverse         Reverse mask, to select the k-mers in sequence fasta file [false]" << std::endl;
+    std::cerr << "            -nthread INT     Number of threads for extracting mask k-mers [1]" << std::endl;
     std::cerr << "            -outpath STR     Path to extension results" << std::endl
               << "                                 if not provided, output to screen" << std::endl;
     std::cerr << "            -withcounts      Output sample count vectors [false]" << std::endl
@@ -22,15 +25,23 @@ inline void PrintMaskHelper()
 }
 
 inline void PrintRunInfo(const std::string &idx_dir, const size_t k_len, const bool stranded,
-                         const std::string &mask_file_path, const bool reverse_mask,
+                         const std::string &mask_file_path, const std::string &mask_idx_path, const bool reverse_mask, const size_t nb_thread,
                          const std::string &out_path, const bool with_counts)
 {
     std::cerr << std::endl;
     std::cerr << "KaMRaT index:                  " << idx_dir << std::endl;
     std::cerr << "k-mer length:                  " << k_len << std::endl;
     std::cerr << "Stranded mode:                 " << (stranded ? "On" : "Off") << std::endl;
-    std::cerr << "Path to mask sequence file:    " << mask_file_path << std::endl;
+    if (mask_idx_path.empty())
+    {
+        std::cerr << "Path to mask sequence file:    " << mask_file_path << std::endl;
+    }
+    else
+    {
+        std::cerr << "Path to mask index:            " << mask_idx_path << std::endl;
+    }
     std::cerr << "Select k-mer in mask:          " << (reverse_mask ? "True" : "False") << std::endl;
+    std::cerr << "Number of threads:             " << nb_thread << std::endl;
     std::cerr << "Output:                        " << (out_path.empty() ? "to screen" : out_path) << ", ";
     std::cerr << (with_counts ? "with" : "without") << " count vectors" << std::endl
               << std::endl;
@@ -38,7 +49,7 @@ inline void PrintRunInfo(const std::string &idx_dir, const size_t k_len, const b
 
 inline void ParseOptions(int argc, char *argv[],
                          std::string &idx_dir,
-                         std::string &mask_file_path, bool &reverse_mask,
+                         std::string &mask_file_path, std::string &mask_idx_path, bool &reverse_mask, size_t &nb_thread,
                          std::string &out_path, bool &with_counts)
 {
     int i_opt(1);
@@ -64,10 +75,18 @@ inline void ParseOptions(int argc, char *argv[],
         {
             mask_file_path = argv[++i_opt];
         }
+        else if (arg == "-maskidx" && i_opt + 1 < argc)
+        {
+            mask_idx_path = argv[++i_opt];
+        }
         else if (arg == "-reverse")
         {
             reverse_mask = true;
         }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
         else if (arg == "-outpath" && i_opt + 1 < argc)
         {
             out_path = argv[++i_opt];
@@ -93,10 +112,15 @@ inline void ParseOptions(int argc, char *argv[],
         PrintMaskHelper();
         throw std::invalid_argument("-idxdir STR is mandatory");
     }
-    if (mask_file_path.empty())
+    if (mask_file_path.empty() == mask_idx_path.empty())
+    {
+        PrintMaskHelper();
+        throw std::invalid_argument("one of -fasta STR and -maskidx STR is mandatory");
+    }
+    if (nb_thread == 0)
     {
         PrintMaskHelper();
-        throw std::invalid_argument("-fasta STR is mandatory");
+        throw std::invalid_argument("-nthread should be a positive integer");
     }
 }
 
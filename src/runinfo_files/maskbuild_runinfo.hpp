@@ -0,0 +1,109 @@
+#ifndef KAMRAT_RUNINFOFILES_MASKBUILDRUNINFO_HPP
+#define KAMRAT_RUNINFOFILES_MASKBUILDRUNINFO_HPP
+
+void MaskBuildWelcome()
+{
+    std::cerr << "KaMRaT mask-build: build a mask index for repeated masking" << std::endl
+              << "----------------------------------------------------------------------------------------------" << std::endl;
+}
+
+inline void PrintMaskBuildHelper()
+{
+    std::cerr << "[USAGE]    kamrat mask-build -fasta STR -klen INT -outpath STR [-unstrand -nthread INT]" << std::endl
+              << std::endl;
+    std::cerr << "[OPTION]    -h,-help         Print the helper" << std::endl;
+    std::cerr << "            -fasta STR       Sequence fasta file as the mask, mandatory" << std::endl
+              << "                                 fasta or fastq, gzipped if the file name ends with gz" << std::endl;
+    std::cerr << "            -klen INT        k-mer length, mandatory, the same as the index to mask, at most 64" << std::endl;
+    std::cerr << "            -outpath STR     Path to the mask index, mandatory" << std::endl;
+    std::cerr << "            -unstrand        Unstranded mode, for masking an index with canonical k-mers [false]" << std::endl;
+    std::cerr << "            -nthread INT     Number of threads for extracting mask k-mers [1]" << std::endl
+              << std::endl;
+}
+
+inline void PrintRunInfo(const std::string &mask_file_path, const size_t k_len, const bool stranded,
+                         const size_t nb_thread, const std::string &out_path)
+{
+    std::cerr << std::endl;
+    std::cerr << "Path to mask sequence file:    " << mask_file_path << std::endl;
+    std::cerr << "k-mer length:                  " << k_len << std::endl;
+    std::cerr << "Stranded mode:                 " << (stranded ? "On" : "Off") << std::endl;
+    std::cerr << "Number of threads:             " << nb_thread << std::endl;
+    std::cerr << "Output mask index:             " << out_path << std::endl
+              << std::endl;
+}
+
+inline void ParseOptions(int argc, char *argv[],
+                         std::string &mask_file_path, size_t &k_len, bool &stranded,
+                         size_t &nb_thread, std::string &out_path)
+{
+    int i_opt(1);
+    if (argc == 1)
+    {
+        PrintMaskBuildHelper();
+        exit(EXIT_SUCCESS);
+    }
+    std::string arg;
+    while (i_opt < argc && argv[i_opt][0] == '-')
+    {
+        arg = argv[i_opt];
+        if (arg == "-h" || arg == "-help")
+        {
+            PrintMaskBuildHelper();
+            exit(EXIT_SUCCESS);
+        }
+        else if (arg == "-fasta" && i_opt + 1 < argc)
+        {
+            mask_file_path = argv[++i_opt];
+        }
+        else if (arg == "-klen" && i_opt + 1 < argc)
+        {
+            k_len = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-outpath" && i_opt + 1 < argc)
+        {
+            out_path = argv[++i_opt];
+        }
+        else if (arg == "-unstrand")
+        {
+            stranded = false;
+        }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
+        else
+        {
+            PrintMaskBuildHelper();
+            throw std::invalid_argument("unknown option: " + arg);
+        }
+        ++i_opt;
+    }
+    if (i_opt < argc)
+    {
+        PrintMaskBuildHelper();
+        throw std::invalid_argument("cannot parse arguments after " + std::string(argv[i_opt]));
+    }
+    if (mask_file_path.empty())
+    {
+        PrintMaskBuildHelper();
+        throw std::invalid_argument("-fasta STR is mandatory");
+    }
+    if (k_len == 0 || k_len > 64)
+    {
+        PrintMaskBuildHelper();
+        throw std::invalid_argument("-klen INT is mandatory, between 1 and 64");
+    }
+    if (out_path.empty())
+    {
+        PrintMaskBuildHelper();
+        throw std::invalid_argument("-outpath STR is mandatory");
+    }
+    if (nb_thread == 0)
+    {
+        PrintMaskBuildHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
+}
+
+#endif //KAMRAT_RUNINFOFILES_MASKBUILDRUNINFO_HPP
@@ -15,7 +15,7 @@ void MergeWelcome()
 
 void PrintMergeHelper()
 {
-    std::cerr << "[USAGE]    kamrat merge -idxdir STR -overlap MAX-MIN [-with STR1[:STR2] -interv STR[:FLOAT] -min-nbkmer INT -outpath STR -withcounts STR]" << std::endl
+    std::cerr << "[USAGE]    kamrat merge -idxdir STR -overlap MAX-MIN [-with STR1[:STR2] -interv STR[:FLOAT] -min-nbkmer INT -nthread INT -cachemem INT -nbucket INT -maxmem INT -tmpdir STR -outpath STR -withcounts STR]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]    -h,-help               Print the helper" << std::endl;
     std::cerr << "            -idxdir STR            Indexing folder by KaMRaT index, mandatory" << std::endl;
@@ -29,6 +29,17 @@ void PrintMergeHelper()
               << "                                       can be one of {none, pearson, spearman, mac}" << std::endl
               << "                                       the threshold may follow a ':' symbol" << std::endl;
     std::cerr << "            -min-nbkmer INT        Minimal length of extended contigs [0]" << std::endl;
+    std::cerr << "            -nthread INT           Number of threads for making and linking overlap knots, merging buckets, and output [1]" << std::endl
+              << "                                       walks along linked contigs in memory are done in one thread" << std::endl
+              << "                                       results do not depend on the number of threads" << std::endl;
+    std::cerr << "            -cachemem INT          Memory (MB) for caching count vectors checked by intervention, when merging in memory [4096]" << std::endl
+              << "                                       if input k-mers do not fit, only contig ends are cached" << std::endl;
+    std::cerr << "            -nbucket INT           Number of disk buckets for merging out of core, 0 for merging in memory [0]" << std::endl
+              << "                                       contigs are split by minimizer, then stitched across buckets" << std::endl
+              << "                                       results do not depend on the number of buckets" << std::endl;
+    std::cerr << "            -maxmem INT            Memory (MB) for the buckets processed at once, shared by threads [4096]" << std::endl
+              << "                                       larger buckets are processed by parts" << std::endl;
+    std::cerr << "            -tmpdir STR            Folder for bucket files [index folder]" << std::endl;
     std::cerr << "            -outpath STR           Path to extension results" << std::endl
               << "                                       if not provided, output to screen" << std::endl;
     std::cerr << "            -withcounts STR        Output sample count vectors, STR can be one of [mean, median]" << std::endl
@@ -40,7 +51,8 @@ void PrintRunInfo(const std::string &idx_dir, const size_t k_len, const bool str
                   const size_t max_ovlp, const size_t min_ovlp,
                   const std::string &with_path, const std::string &rep_mode,
                   const std::string &itv_mthd, const float itv_thres,
-                  const size_t min_nbkmer, const std::string &out_path, const std::string &out_mode)
+                  const size_t min_nbkmer, const size_t nb_thread, const size_t cache_mem,
+                  const size_t nb_bucket, const size_t max_mem, const std::string &tmp_dir, const std::string &out_path, const std::string &out_mode)
 {
     std::cerr << std::endl;
     std::cerr << "KaMRaT index:                      " << idx_dir << std::endl;
@@ -52,6 +64,11 @@ void PrintRunInfo(const std::string &idx_dir, const size_t k_len, const bool str
     std::cerr << "Intervention method:               " << itv_mthd
               << (itv_mthd != "none" ? (", threshold = " + std::to_string(itv_thres)) : "") << std::endl;
     std::cerr << "Minimal component k-mer number:    " + std::to_string(min_nbkmer) << std::endl;
+    std::cerr << "Number of threads:                 " << nb_thread << std::endl;
+    std::cerr << "Count cache memory:                " << cache_mem << " MB" << std::endl;
+    std::cerr << "Bucket number:                     " << (nb_bucket == 0 ? "in memory"
+                                                              : std::to_string(nb_bucket) + ", in " + tmp_dir + ", " + std::to_string(max_mem) + " MB at once")
+              << std::endl;
     std::cerr << "Output:                            " << (out_path.empty() ? "to screen" : out_path) << ", "
               << (out_mode.empty() ? "without" : out_mode) + " count vectors" << std::endl
               << std::endl;
@@ -61,7 +78,8 @@ void ParseOptions(int argc, char *argv[],
                   std::string &idx_dir, size_t &max_ovlp, size_t &min_ovlp,
                   std::string &with_path, std::string &rep_mode,
                   std::string &itv_mthd, float &itv_thres,
-                  size_t &min_nbkmer, std::string &out_path, std::string &out_mode)
+                  size_t &min_nbkmer, size_t &nb_thread, size_t &cache_mem,
+                  size_t &nb_bucket, size_t &max_mem, std::string &tmp_dir, std::string &out_path, std::string &out_mode)
 {
     int i_opt(1);
     if (argc == 1)
@@ -100,9 +118,9 @@ void ParseOptions(int argc, char *argv[],
             {
                 throw std::invalid_argument("invalid overlap range, MAX should come first: " + arg);
             }
-            if (min_ovlp > 31 || max_ovlp > 31)
+            if (min_ovlp > 63 || max_ovlp > 63) // k-mer length is at most 64
             {
-                throw std::invalid_argument("overlap range should not exceed 31");
+                throw std::invalid_argument("overlap range should not exceed 63");
             }
         }
         else if (arg == "-with" && i_opt + 1 < argc)
@@ -129,6 +147,26 @@ void ParseOptions(int argc, char *argv[],
         {
             min_nbkmer = std::stoul(argv[++i_opt]);
         }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-cachemem" && i_opt + 1 < argc)
+        {
+            cache_mem = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-nbucket" && i_opt + 1 < argc)
+        {
+            nb_bucket = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-maxmem" && i_opt + 1 < argc)
+        {
+            max_mem = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-tmpdir" && i_opt + 1 < argc)
+        {
+            tmp_dir = argv[++i_opt];
+        }
         else if (arg == "-outpath" && i_opt + 1 < argc)
         {
             out_path = argv[++i_opt];
@@ -154,11 +192,25 @@ void ParseOptions(int argc, char *argv[],
         PrintMergeHelper();
         throw std::invalid_argument("-idxdir STR is mandatory");
     }
+    if (tmp_dir.empty())
+    {
+        tmp_dir = idx_dir;
+    }
     // if (max_ovlp == 0 || min_ovlp == 0)
     // {
     //     PrintMergeHelper();
     //     throw std::invalid_argument("-overlap MAX-MIN is mandatory");
     // }
+    if (nb_thread == 0)
+    {
+        PrintMergeHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
+    if (max_mem == 0)
+    {
+        PrintMergeHelper();
+        throw std::invalid_argument("-maxmem should be a positive integer");
+    }
     if (kIntervMethodUniv.find(itv_mthd) == kIntervMethodUniv.cend())
     {
         PrintMergeHelper();
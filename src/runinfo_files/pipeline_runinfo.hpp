@@ -0,0 +1,320 @@
+#ifndef KAMRAT_RUNINFOFILES_PIPELINERUNINFO_HPP
+#define KAMRAT_RUNINFOFILES_PIPELINERUNINFO_HPP
+
+#include <unordered_set>
+
+const std::unordered_set<std::string> kPipeIntervMethodUniv{"none", "pearson", "spearman", "mac"};
+const std::unordered_set<std::string> kPipeRepModeUniv{"min", "minabs", "max", "maxabs"};
+const std::unordered_set<std::string> kPipeOutModeUniv{"rep", "mean", "median"};
+
+void PipelineWelcome()
+{
+    std::cerr << "KaMRaT pipeline: mask, filter, score and merge k-mers in a single run, without intermediate files" << std::endl
+              << "------------------------------------------------------------------------------------------------------------" << std::endl;
+}
+
+void PrintPipelineHelper()
+{
+    std::cerr << "[USAGE]    kamrat pipeline -idxdir STR [-fasta STR|-maskidx STR -reverse-mask -design STR -expr STR -reverse-filter -scoreby STR -seltop NUM" << std::endl
+              << "                                      -overlap MAX-MIN -repmode STR -interv STR[:FLOAT] -min-nbkmer INT -nthread INT -cachemem INT -nbucket INT -maxmem INT -tmpdir STR" << std::endl
+              << "                                      -outpath STR -withcounts STR]" << std::endl
+              << std::endl;
+    std::cerr << "[OPTION]    -h,-help               Print the helper" << std::endl;
+    std::cerr << "            -idxdir STR            Indexing folder by KaMRaT index in k-mer mode, mandatory" << std::endl;
+    std::cerr << "   mask     -fasta STR             Sequence fasta file as the mask, k-mers in the mask are removed" << std::endl
+              << "                                       fasta or fastq, gzipped if the file name ends with gz" << std::endl;
+    std::cerr << "            -maskidx STR           Mask index by KaMRaT mask-build, instead of -fasta" << std::endl;
+    std::cerr << "            -reverse-mask          Reverse mask, to select the k-mers in the mask [false]" << std::endl;
+    std::cerr << "   filter   -design STR            Path to sample design file, without header line, each row: sample name, sample condition" << std::endl
+              << "                                       conditions are the sample groups of -expr and the sample conditions of -scoreby" << std::endl;
+    std::cerr << "            -expr STR              Filter expression over sample groups, as for KaMRaT filter" << std::endl
+              << "                                       e.g. \"nb(tumor >= 5) >= 3 AND mean(normal) < 2 AND frac(all > 0) >= 0.1\"" << std::endl;
+    std::cerr << "            -reverse-filter        Reverse filter, to remove eligible k-mers [false]" << std::endl;
+    std::cerr << "   score    -scoreby STR           Scoring method, as for KaMRaT score, -withcounts STR is then mandatory" << std::endl;
+    std::cerr << "            -seltop NUM            Select top scored k-mers before merging" << std::endl
+              << "                                       if NUM > 1, number of top k-mers to select (should be integer)" << std::endl
+              << "                                       if 0 < NUM <= 1, ratio of top k-mers to select" << std::endl
+              << "                                       if absent or NUM <= 0, merge all scored k-mers" << std::endl;
+    std::cerr << "   merge    -overlap MAX-MIN       Overlap range for extension, by default: from (k-1) to \u230Ak/2\u230B" << std::endl;
+    std::cerr << "            -repmode STR           Representative mode of scored k-mers, can be one of {min, minabs, max, maxabs} [min]" << std::endl;
+    std::cerr << "            -interv STR[:FLOAT]    Intervention method for extension [pearson:0.20]" << std::endl
+              << "                                       can be one of {none, pearson, spearman, mac}" << std::endl;
+    std::cerr << "            -min-nbkmer INT        Minimal length of extended contigs [0]" << std::endl;
+    std::cerr << "            -cachemem INT          Memory (MB) for caching count vectors checked by intervention, when merging in memory [4096]" << std::endl;
+    std::cerr << "            -nbucket INT           Number of disk buckets for merging out of core, 0 for merging in memory [0]" << std::endl;
+    std::cerr << "            -maxmem INT            Memory (MB) for the buckets processed at once, shared by threads [4096]" << std::endl;
+    std::cerr << "            -tmpdir STR            Folder for bucket files [index folder]" << std::endl;
+    std::cerr << "            -nthread INT           Number of threads for all stages [1]" << std::endl
+              << "                                       results do not depend on the number of threads" << std::endl;
+    std::cerr << "            -outpath STR           Path to merging results" << std::endl
+              << "                                       if not provided, output to screen" << std::endl;
+    std::cerr << "            -withcounts STR        Output sample count vectors, STR can be one of [rep, mean, median]" << std::endl
+              << "                                       if not provided, output as intermediate without count vector" << std::endl
+              << std::endl;
+    std::cerr << "[NOTE]      Stages run in the order mask, filter, score, merge, each of them skipped if its options are not given" << std::endl
+              << "            Mask, filter and score are applied in one pass over the index, only retained k-mers being passed on" << std::endl
+              << "            Results are the same as chaining kamrat mask, filter, score and merge through intermediate files," << std::endl
+              << "                except for rep-values, not rounded as scores written in intermediate files" << std::endl
+              << std::endl;
+}
+
+void PrintRunInfo(const std::string &idx_dir, const size_t k_len, const bool stranded,
+                  const std::string &mask_file_path, const std::string &mask_idx_path, const bool reverse_mask,
+                  const std::string &dsgn_path, const std::string &expr_str, const bool reverse_filter,
+                  const std::string &rk_mthd, const size_t nfold, const float sel_top,
+                  const size_t max_ovlp, const size_t min_ovlp, const std::string &rep_mode,
+                  const std::string &itv_mthd, const float itv_thres, const size_t min_nbkmer,
+                  const size_t nb_thread, const size_t cache_mem, const size_t nb_bucket, const size_t max_mem, const std::string &tmp_dir,
+                  const std::string &out_path, const std::string &out_mode)
+{
+    std::cerr << std::endl;
+    std::cerr << "KaMRaT index:                      " << idx_dir << std::endl;
+    std::cerr << "k-mer length:                      " << k_len << std::endl;
+    std::cerr << "Stranded mode:                     " << (stranded ? "On" : "Off") << std::endl;
+    if (!mask_file_path.empty() || !mask_idx_path.empty())
+    {
+        std::cerr << "Mask:                              " << (mask_idx_path.empty() ? mask_file_path : mask_idx_path)
+                  << (reverse_mask ? ", k-mers in mask selected" : ", k-mers in mask removed") << std::endl;
+    }
+    else
+    {
+        std::cerr << "Mask:                              none" << std::endl;
+    }
+    std::cerr << "Sample design:                     " << (dsgn_path.empty() ? "none" : dsgn_path) << std::endl;
+    std::cerr << "Filter expression:                 " << (expr_str.empty() ? "none" : expr_str)
+              << (!expr_str.empty() && reverse_filter ? ", reversed" : "") << std::endl;
+    std::cerr << "Scoring method:                    " << (rk_mthd.empty() ? "none" : rk_mthd);
+    if (!rk_mthd.empty() && (rk_mthd == "lr" || rk_mthd == "bayes" || rk_mthd == "svm"))
+    {
+        std::cerr << ", " << (nfold == 0 ? "leave-one-out" : std::to_string(nfold) + "-fold") << " cross-validation";
+    }
+    std::cerr << std::endl;
+    if (!rk_mthd.empty())
+    {
+        std::cerr << "Select top scored k-mers:          " << (sel_top > 0 ? std::to_string(sel_top) : "all") << std::endl;
+    }
+    std::cerr << "Overlap range:                     from " << max_ovlp << " to " << min_ovlp << std::endl;
+    std::cerr << "Representative mode:               " << rep_mode << std::endl;
+    std::cerr << "Intervention method:               " << itv_mthd
+              << (itv_mthd != "none" ? (", threshold = " + std::to_string(itv_thres)) : "") << std::endl;
+    std::cerr << "Minimal component k-mer number:    " + std::to_string(min_nbkmer) << std::endl;
+    std::cerr << "Number of threads:                 " << nb_thread << std::endl;
+    std::cerr << "Count cache memory:                " << cache_mem << " MB" << std::endl;
+    std::cerr << "Bucket number:                     " << (nb_bucket == 0 ? "in memory"
+                                                              : std::to_string(nb_bucket) + ", in " + tmp_dir + ", " + std::to_string(max_mem) + " MB at once")
+              << std::endl;
+    std::cerr << "Output:                            " << (out_path.empty() ? "to screen" : out_path) << ", "
+              << (out_mode.empty() ? "without" : out_mode) + " count vectors" << std::endl
+              << std::endl;
+}
+
+void ParseOptions(int argc, char *argv[],
+                  std::string &idx_dir, std::string &mask_file_path, std::string &mask_idx_path, bool &reverse_mask,
+                  std::string &dsgn_path, std::string &expr_str, bool &reverse_filter,
+                  std::string &rk_mthd, size_t &nfold, float &sel_top,
+                  size_t &max_ovlp, size_t &min_ovlp, std::string &rep_mode, std::string &itv_mthd, float &itv_thres,
+                  size_t &min_nbkmer, size_t &nb_thread, size_t &cache_mem, size_t &nb_bucket, size_t &max_mem, std::string &tmp_dir,
+                  std::string &out_path, std::string &out_mode)
+{
+    int i_opt(1);
+    if (argc == 1)
+    {
+        PrintPipelineHelper();
+        exit(EXIT_SUCCESS);
+    }
+    size_t split_pos;
+    std::string arg;
+    while (i_opt < argc && argv[i_opt][0] == '-')
+    {
+        arg = argv[i_opt];
+        if (arg == "-help" || arg == "-h")
+        {
+            PrintPipelineHelper();
+            exit(EXIT_SUCCESS);
+        }
+        else if (arg == "-idxdir" && i_opt + 1 < argc)
+        {
+            idx_dir = argv[++i_opt];
+        }
+        else if (arg == "-fasta" && i_opt + 1 < argc)
+        {
+            mask_file_path = argv[++i_opt];
+        }
+        else if (arg == "-maskidx" && i_opt + 1 < argc)
+        {
+            mask_idx_path = argv[++i_opt];
+        }
+        else if (arg == "-reverse-mask")
+        {
+            reverse_mask = true;
+        }
+        else if (arg == "-design" && i_opt + 1 < argc)
+        {
+            dsgn_path = argv[++i_opt];
+        }
+        else if (arg == "-expr" && i_opt + 1 < argc)
+        {
+            expr_str = argv[++i_opt];
+        }
+        else if (arg == "-reverse-filter")
+        {
+            reverse_filter = true;
+        }
+        else if (arg == "-scoreby" && i_opt + 1 < argc)
+        {
+            arg = argv[++i_opt];
+            split_pos = arg.find(":");
+            if (split_pos != std::string::npos)
+            {
+                nfold = std::stoi(arg.substr(split_pos + 1));
+            }
+            else
+            {
+                nfold = 1; // by default, without cross-validation
+            }
+            rk_mthd = arg.substr(0, split_pos);
+        }
+        else if (arg == "-seltop" && i_opt + 1 < argc)
+        {
+            sel_top = std::stof(argv[++i_opt]);
+        }
+        else if (arg == "-overlap" && i_opt + 1 < argc)
+        {
+            arg = argv[++i_opt];
+            split_pos = arg.find("-");
+            if (split_pos == std::string::npos)
+            {
+                throw std::invalid_argument("invalid overlap range: " + arg);
+            }
+            min_ovlp = std::stoi(arg.substr(split_pos + 1));
+            max_ovlp = std::stoi(arg.substr(0, split_pos));
+            if (min_ovlp > max_ovlp)
+            {
+                throw std::invalid_argument("invalid overlap range, MAX should come first: " + arg);
+            }
+        }
+        else if (arg == "-repmode" && i_opt + 1 < argc)
+        {
+            rep_mode = argv[++i_opt];
+        }
+        else if (arg == "-interv" && i_opt + 1 < argc)
+        {
+            arg = argv[++i_opt];
+            split_pos = arg.find(":");
+            if (split_pos != std::string::npos)
+            {
+                itv_thres = std::stof(arg.substr(split_pos + 1));
+            }
+            itv_mthd = arg.substr(0, split_pos);
+        }
+        else if (arg == "-min-nbkmer" && i_opt + 1 < argc)
+        {
+            min_nbkmer = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-cachemem" && i_opt + 1 < argc)
+        {
+            cache_mem = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-nbucket" && i_opt + 1 < argc)
+        {
+            nb_bucket = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-maxmem" && i_opt + 1 < argc)
+        {
+            max_mem = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-tmpdir" && i_opt + 1 < argc)
+        {
+            tmp_dir = argv[++i_opt];
+        }
+        else if (arg == "-outpath" && i_opt + 1 < argc)
+        {
+            out_path = argv[++i_opt];
+        }
+        else if (arg == "-withcounts" && i_opt + 1 < argc)
+        {
+            out_mode = argv[++i_opt];
+        }
+        else
+        {
+            PrintPipelineHelper();
+            throw std::invalid_argument("unknown option " + arg);
+        }
+        ++i_opt;
+    }
+    if (i_opt < argc)
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("cannot parse arguments after " + std::string(argv[i_opt]));
+    }
+    if (idx_dir.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-idxdir STR is mandatory");
+    }
+    if (tmp_dir.empty())
+    {
+        tmp_dir = idx_dir;
+    }
+    if (!mask_file_path.empty() && !mask_idx_path.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-fasta and -maskidx cannot be given together");
+    }
+    if (reverse_mask && mask_file_path.empty() && mask_idx_path.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-reverse-mask needs -fasta STR or -maskidx STR");
+    }
+    if (reverse_filter && expr_str.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-reverse-filter needs -expr STR");
+    }
+    if (!rk_mthd.empty() && rk_mthd != "sd" && rk_mthd != "rsd1" && rk_mthd != "rsd2" && rk_mthd != "rsd3" && rk_mthd != "entropy" && dsgn_path.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-design STR is mandatory for scoring by " + rk_mthd);
+    }
+    if (!rk_mthd.empty() && out_mode.empty())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-withcounts STR is mandatory with -scoreby, scored contigs cannot be output as intermediate");
+    }
+    if (rk_mthd.empty() && sel_top > 0)
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-seltop NUM needs -scoreby STR");
+    }
+    if (nb_thread == 0)
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
+    if (max_mem == 0)
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("-maxmem should be a positive integer");
+    }
+    if (kPipeIntervMethodUniv.find(itv_mthd) == kPipeIntervMethodUniv.cend())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("unknown intervention method: " + itv_mthd);
+    }
+    if (kPipeRepModeUniv.find(rep_mode) == kPipeRepModeUniv.cend())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("unknown representative mode: " + rep_mode);
+    }
+    if (!out_mode.empty() && kPipeOutModeUniv.find(out_mode) == kPipeOutModeUniv.cend())
+    {
+        PrintPipelineHelper();
+        throw std::invalid_argument("unknown output mode: " + out_mode);
+    }
+}
+
+#endif //KAMRAT_RUNINFOFILES_PIPELINERUNINFO_HPP
@@ -13,34 +13,42 @@ void QueryWelcome()
 
 void PrintQueryHelper()
 {
-    std::cerr << "[USAGE]    kamrat query -idxdir STR -fasta STR -toquery STR [-withabsent -outpath STR]" << std::endl
+    std::cerr << "[USAGE]    kamrat query -idxdir STR -fasta STR -toquery STR [-withabsent -profile -nthread INT -outpath STR]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]    -h,-help         Print the helper" << std::endl;
     std::cerr << "            -idxdir STR      Indexing folder by KaMRaT index, mandatory" << std::endl;
-    std::cerr << "            -fasta STR       Sequence fasta file, mandatory" << std::endl;
+    std::cerr << "            -fasta STR       Sequence file, mandatory" << std::endl
+              << "                                 fasta or fastq, gzipped if the file name ends with gz" << std::endl;
     std::cerr << "            -toquery STR     Query method, mandatory, can be one of:" << std::endl
               << "                                 mean        mean count among all composite k-mers for each sample" << std::endl
               << "                                 median      median count among all composite k-mers for each sample" << std::endl;
     std::cerr << "            -withabsent      Output also absent queries (count vector all 0) [default: false]" << std::endl;
+    std::cerr << "            -profile         Output per-read profiles instead of sequences [default: false]" << std::endl
+              << "                                 read name, number of k-mers, number of k-mers found in index," << std::endl
+              << "                                 fraction of read bases covered by found k-mers, then the counts" << std::endl;
+    std::cerr << "            -nthread INT     Number of threads for querying sequences [1]" << std::endl;
     std::cerr << "            -outpath STR     Path to extension results" << std::endl
               << "                                 if not provided, output to screen" << std::endl
               << std::endl;
 }
 
 void PrintRunInfo(const std::string &idx_dir, const std::string &seq_file_path,
-                  const std::string &query_mtd, const bool with_absent, const std::string &out_path)
+                  const std::string &query_mtd, const bool with_absent, const bool as_profile, const size_t nb_thread,
+                  const std::string &out_path)
 {
     std::cerr << std::endl;
     std::cerr << "KaMRaT index:             " << idx_dir << std::endl;
     std::cerr << "Path to sequence file:    " << seq_file_path << std::endl;
     std::cerr << "Query method:             " << query_mtd << std::endl;
     std::cout << "Output absent query:      " << (with_absent ? "True" : "False") << std::endl;
+    std::cerr << "Output per-read profile:  " << (as_profile ? "True" : "False") << std::endl;
+    std::cerr << "Number of threads:        " << nb_thread << std::endl;
     std::cerr << "Output:                   " << (out_path.empty() ? "to screen" : out_path) << std::endl
               << std::endl;
 }
 
 void ParseOptions(int argc, char *argv[], std::string &idx_dir, std::string &seq_file_path,
-                  std::string &query_mtd, bool &with_absent, std::string &out_path)
+                  std::string &query_mtd, bool &with_absent, bool &as_profile, size_t &nb_thread, std::string &out_path)
 {
     int i_opt(1);
     if (argc == 1)
@@ -72,6 +80,14 @@ void ParseOptions(int argc, char *argv[], std::string &idx_dir, std::string &seq
         {
             with_absent = true;
         }
+        else if (arg == "-profile")
+        {
+            as_profile = true;
+        }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
         else if (arg == "-outpath" && i_opt + 1 < argc)
         {
             out_path = argv[++i_opt];
@@ -103,6 +119,11 @@ void ParseOptions(int argc, char *argv[], std::string &idx_dir, std::string &seq
         PrintQueryHelper();
         throw std::invalid_argument("unknown query method: " + query_mtd);
     }
+    if (nb_thread == 0)
+    {
+        PrintQueryHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
 }
 
 #endif //KAMRAT_RUNINFOFILES_QUERY_HPP
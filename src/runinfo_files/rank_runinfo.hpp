@@ -9,16 +9,24 @@ void RankWelcome()
 
 void PrintRankHelper()
 {
-    std::cerr << "[USAGE]    kamrat score -idxdir STR -count-mode STR -scoreby STR -design STR [-with STR1[:STR2] -seltop NUM -outpath STR -withcounts]" << std::endl
+    std::cerr << "[USAGE]    kamrat score -idxdir STR -count-mode STR -scoreby STR -design STR [-with STR1[:STR2] -cvfold STR -seltop NUM -outpath STR -withcounts]" << std::endl
+              << "           kamrat score -intab STR -scoreby STR -design STR [-nfbase INT -seltop NUM -outpath STR]" << std::endl
               << std::endl;
     std::cerr << "[OPTION]    -h,-help             Print the helper" << std::endl;
-    std::cerr << "            -idxdir STR          Indexing folder by KaMRaT index, mandatory" << std::endl;
+    std::cerr << "            -idxdir STR          Indexing folder by KaMRaT index, mandatory unless -intab STR is given" << std::endl;
+    std::cerr << "            -intab STR           Count table to score directly without index, not compatible with -idxdir, -with, -cvfold" << std::endl
+              << "                                     output always with sample count vectors" << std::endl
+              << "                                     only scores are kept in memory, selected rows are read again from the table" << std::endl;
+    std::cerr << "            -nfbase INT          Base for normalizing -intab counts on the fly, not compatible with -nffile STR" << std::endl
+              << "                                     normCount_ij <- INT * rawCount_ij / sum_i{rawCount_ij}, the table will be scanned once more" << std::endl
+              << "            -nffile STR          File for loading normalization factor of -intab counts, not compatible with -nfbase INT" << std::endl;
     std::cerr << "            -scoreby STR         Scoring method, mandatory, can be one of: " << std::endl
               << "                                     classification (binary sample labels given by design file)" << std::endl
               << "                                         ttest.padj      adjusted p-value of t-test between conditions" << std::endl
               << "                                         ttest.pi        \u03C0-value of t-test between conditions" << std::endl
               << "                                         snr             signal-to-noise ratio between conditions" << std::endl
               << "                                         lr:nfold        accuracy by logistic regression classifier" << std::endl
+              << "                                         lm              t-statistic of condition in a linear model adjusted by design covariates" << std::endl
               << "                                     classification (binary or multiple sample labels given by design file)" << std::endl
               << "                                         dids            DIDS score" << std::endl
               << "                                         bayes:nfold     accuracy by naive Bayes classifier" << std::endl
@@ -34,10 +42,15 @@ void PrintRankHelper()
     std::cerr << "            -design STR          Path to file indicating sample-condition design, mandatory unless using sd, rsd1, rsd2, rsd3, entropy" << std::endl
               << "                                     without header line, each row can be either: " << std::endl
               << "                                         sample name, sample condition" << std::endl
-              << "                                         sample name, sample condition, sample batch (only for lrc, nbc, and svm)" << std::endl;
+              << "                                         sample name, sample condition, covariate columns (only for lm, e.g. batch, sex, age)" << std::endl;
     std::cerr << "            -with STR1[:STR2]    File indicating features to score (STR1) and counting mode (STR2)" << std::endl
               << "                                     if not provided, all indexed features are used for scoring" << std::endl
               << "                                     STR2 can be one of [rep, mean, median]" << std::endl;
+    std::cerr << "            -cvfold STR          Path to file assigning samples to cross-validation folds" << std::endl
+              << "                                     without header line, each row: sample name, fold label" << std::endl
+              << "                                     every sample of the matrix must be assigned to a fold" << std::endl
+              << "                                     features are scored once per fold on the samples out of the fold" << std::endl
+              << "                                     results are output to <outpath>.<fold label>, -outpath is mandatory" << std::endl;
     std::cerr << "            -seltop NUM          Select top scored features" << std::endl
               << "                                     if NUM > 1, number of top features to select (should be integer)" << std::endl
               << "                                     if 0 < NUM <= 1, ratio of top features to select" << std::endl
@@ -50,20 +63,38 @@ void PrintRankHelper()
               << "                if nfold = 0, leave-one-out cross-validation" << std::endl
               << "                if nfold = 1, without cross-validation, training and testing on the whole datset" << std::endl
               << "                if nfold > 1, n-fold cross-validation" << std::endl
-              << "            For t-test scoring methods, a transformation log2(x + 1) is applied to sample counts" << std::endl
+              << "            For t-test and lm scoring methods, a transformation log2(x + 1) is applied to sample counts" << std::endl
+              << "                for t-test, the transformed counts stored by kamrat index -logcache are used if present (except mean/median counting of merged features)" << std::endl
+              << "            For lm scoring, numeric covariates are used as such, others as categorical (first sample's level as reference)" << std::endl
               << "            For SVM scoring, sample counts standardization is applied feature by feature" << std::endl
               << std::endl;
 }
 
 void PrintRunInfo(const std::string &idx_dir,
+                  const std::string &count_tab_path, const size_t nf_base, const std::string &nf_file_path,
                   const std::string &rk_mthd, const size_t nfold,
                   const std::string &with_path, const std::string &count_mode,
-                  const std::string &dsgn_path,
+                  const std::string &dsgn_path, const std::string &fold_path,
                   const float sel_top,
                   const std::string &out_path, const bool with_counts)
 {
     std::cerr << std::endl;
-    std::cerr << "KaMRaT index:                 " << idx_dir << std::endl;
+    if (!count_tab_path.empty())
+    {
+        std::cerr << "Count table:                  " << count_tab_path << std::endl;
+        if (nf_base > 0)
+        {
+            std::cerr << "Normalization base:           " << nf_base << std::endl;
+        }
+        else if (!nf_file_path.empty())
+        {
+            std::cerr << "Normalization factor from:    " << nf_file_path << std::endl;
+        }
+    }
+    else
+    {
+        std::cerr << "KaMRaT index:                 " << idx_dir << std::endl;
+    }
     std::cerr << "Scoring method:               " << rk_mthd;
     if (rk_mthd == "lr" || rk_mthd == "nbc" || rk_mthd == "svm")
     {
@@ -87,12 +118,19 @@ void PrintRunInfo(const std::string &idx_dir,
         std::cerr << std::endl;
     }
 
-    std::cerr << "Scoring with:                 " << (with_path.empty() ? "features in index" : "features in " + with_path) << std::endl;
-    std::cerr << "Feature counting mode:        " + count_mode << std::endl;
+    if (count_tab_path.empty())
+    {
+        std::cerr << "Scoring with:                 " << (with_path.empty() ? "features in index" : "features in " + with_path) << std::endl;
+        std::cerr << "Feature counting mode:        " + count_mode << std::endl;
+    }
     if (!dsgn_path.empty())
     {
         std::cerr << "Sample design:                " << dsgn_path << std::endl;
     }
+    if (!fold_path.empty())
+    {
+        std::cerr << "Cross-validation folds:       " << fold_path << std::endl;
+    }
     std::cerr << "Selection of top features:    ";
     if (sel_top <= 0)
     {
@@ -113,9 +151,10 @@ void PrintRunInfo(const std::string &idx_dir,
 
 void ParseOptions(int argc, char *argv[],
                   std::string &idx_dir,
+                  std::string &count_tab_path, size_t &nf_base, std::string &nf_file_path,
                   std::string &rk_mthd, size_t &nfold,
                   std::string &with_path, std::string &count_mode,
-                  std::string &dsgn_path,
+                  std::string &dsgn_path, std::string &fold_path,
                   float &sel_top,
                   std::string &out_path, bool &with_counts)
 {
@@ -139,6 +178,26 @@ void ParseOptions(int argc, char *argv[],
         {
             idx_dir = argv[++i_opt];
         }
+        else if (arg == "-intab" && i_opt + 1 < argc)
+        {
+            count_tab_path = argv[++i_opt];
+        }
+        else if (arg == "-nfbase" && i_opt + 1 < argc)
+        {
+            if (!nf_file_path.empty()) {
+                PrintRankHelper();
+                throw std::invalid_argument("-nfbase and -nffile cannot be given together");
+            }
+            nf_base = std::stoul(argv[++i_opt]);
+        }
+        else if (arg == "-nffile" && i_opt + 1 < argc)
+        {
+            if (nf_base > 0) {
+                PrintRankHelper();
+                throw std::invalid_argument("-nfbase and -nffile cannot be given together");
+            }
+            nf_file_path = argv[++i_opt];
+        }
         else if (arg == "-scoreby" && i_opt + 1 < argc)
         {
             arg = argv[++i_opt];
@@ -167,6 +226,10 @@ void ParseOptions(int argc, char *argv[],
         {
             dsgn_path = argv[++i_opt];
         }
+        else if (arg == "-cvfold" && i_opt + 1 < argc)
+        {
+            fold_path = argv[++i_opt];
+        }
         else if (arg == "-seltop" && i_opt + 1 < argc)
         {
             sel_top = std::stof(argv[++i_opt]);
@@ -191,11 +254,25 @@ void ParseOptions(int argc, char *argv[],
         PrintRankHelper();
         throw std::invalid_argument("cannot parse arguments after " + std::string(argv[i_opt]));
     }
-    if (idx_dir.empty())
+    if (idx_dir.empty() && count_tab_path.empty())
     {
         PrintRankHelper();
         throw std::invalid_argument("-idxdir STR is mandatory");
     }
+    if (!count_tab_path.empty())
+    {
+        if (!idx_dir.empty() || !with_path.empty() || !fold_path.empty())
+        {
+            PrintRankHelper();
+            throw std::invalid_argument("-intab STR cannot be given together with -idxdir, -with, or -cvfold");
+        }
+        with_counts = true; // no index to refer to, the count vectors are always output
+    }
+    else if (nf_base > 0 || !nf_file_path.empty())
+    {
+        PrintRankHelper();
+        throw std::invalid_argument("-nfbase and -nffile are only for scoring with -intab STR");
+    }
     if (rk_mthd.empty())
     {
         PrintRankHelper();
@@ -206,6 +283,11 @@ void ParseOptions(int argc, char *argv[],
         PrintRankHelper();
         throw std::invalid_argument("-design STR is mandatory");
     }
+    if (!fold_path.empty() && out_path.empty())
+    {
+        PrintRankHelper();
+        throw std::invalid_argument("-outpath STR is mandatory when -cvfold STR is given");
+    }
 }
 
 #endif //KAMRAT_RUNINFOFILES_RANKRUNINFO_HPP
@@ -0,0 +1,118 @@
+#ifndef KAMRAT_RUNINFOFILES_SERVE_HPP
+#define KAMRAT_RUNINFOFILES_SERVE_HPP
+
+#include <unordered_set>
+
+const std::unordered_set<std::string> kServeMethodUniv{"mean", "median"};
+
+void ServeWelcome()
+{
+    std::cerr << "KaMRaT serve: query sequences counts with the index loaded once" << std::endl
+              << "-------------------------------------------------------------------------------------------------------" << std::endl;
+}
+
+void PrintServeHelper()
+{
+    std::cerr << "[USAGE]    kamrat serve -idxdir STR -toquery STR [-withabsent -profile -socket STR -nthread INT]" << std::endl
+              << std::endl;
+    std::cerr << "[OPTION]    -h,-help         Print the helper" << std::endl;
+    std::cerr << "            -idxdir STR      Indexing folder by KaMRaT index, mandatory" << std::endl;
+    std::cerr << "            -toquery STR     Query method, mandatory, can be one of:" << std::endl
+              << "                                 mean        mean count among all composite k-mers for each sample" << std::endl
+              << "                                 median      median count among all composite k-mers for each sample" << std::endl;
+    std::cerr << "            -withabsent      Output also absent queries (count vector all 0) [default: false]" << std::endl;
+    std::cerr << "            -profile         Output per-read profiles instead of sequences [default: false]" << std::endl;
+    std::cerr << "            -socket STR      Path to a UNIX socket to listen on" << std::endl
+              << "                                 if not provided, serve requests from standard input" << std::endl;
+    std::cerr << "            -nthread INT     Number of threads for serving socket connections [1]" << std::endl
+              << "                                 or for querying each batch from standard input" << std::endl
+              << std::endl;
+    std::cerr << "[PROTOCOL]  A request is a batch of fasta records ended by a line \"//\" (or by the end of input)" << std::endl
+              << "            The response is the header line and one row per queried sequence, as by kamrat query, ended by a line \"//\"" << std::endl
+              << std::endl;
+}
+
+void PrintRunInfo(const std::string &idx_dir, const std::string &query_mtd, const bool with_absent, const bool as_profile,
+                  const std::string &socket_path, const size_t nb_thread)
+{
+    std::cerr << std::endl;
+    std::cerr << "KaMRaT index:             " << idx_dir << std::endl;
+    std::cerr << "Query method:             " << query_mtd << std::endl;
+    std::cerr << "Output absent query:      " << (with_absent ? "True" : "False") << std::endl;
+    std::cerr << "Output per-read profile:  " << (as_profile ? "True" : "False") << std::endl;
+    std::cerr << "Requests from:            " << (socket_path.empty() ? "standard input" : socket_path) << std::endl;
+    std::cerr << "Number of threads:        " << nb_thread << std::endl
+              << std::endl;
+}
+
+void ParseOptions(int argc, char *argv[], std::string &idx_dir, std::string &query_mtd, bool &with_absent, bool &as_profile,
+                  std::string &socket_path, size_t &nb_thread)
+{
+    int i_opt(1);
+    if (argc == 1)
+    {
+        PrintServeHelper();
+        exit(EXIT_SUCCESS);
+    }
+    while (i_opt < argc && argv[i_opt][0] == '-')
+    {
+        std::string arg(argv[i_opt]);
+        if (arg == "-help" || arg == "-h")
+        {
+            PrintServeHelper();
+            exit(EXIT_SUCCESS);
+        }
+        else if (arg == "-idxdir" && i_opt + 1 < argc)
+        {
+            idx_dir = argv[++i_opt];
+        }
+        else if (arg == "-toquery" && i_opt + 1 < argc)
+        {
+            query_mtd = argv[++i_opt];
+        }
+        else if (arg == "-withabsent")
+        {
+            with_absent = true;
+        }
+        else if (arg == "-profile")
+        {
+            as_profile = true;
+        }
+        else if (arg == "-socket" && i_opt + 1 < argc)
+        {
+            socket_path = argv[++i_opt];
+        }
+        else if (arg == "-nthread" && i_opt + 1 < argc)
+        {
+            nb_thread = std::stoul(argv[++i_opt]);
+        }
+        else
+        {
+            PrintServeHelper();
+            throw std::invalid_argument("unknown option " + std::string(argv[i_opt]));
+        }
+        ++i_opt;
+    }
+    if (idx_dir.empty())
+    {
+        PrintServeHelper();
+        throw std::invalid_argument("-idxdir STR is mandatory");
+    }
+    if (query_mtd.empty())
+    {
+        PrintServeHelper();
+        throw std::invalid_argument("-toquery STR is mandatory");
+    }
+    else if (kServeMethodUniv.find(query_mtd) == kServeMethodUniv.cend())
+    {
+        PrintServeHelper();
+        throw std::invalid_argument("unknown query method: " + query_mtd);
+    }
+    if (nb_thread == 0)
+    {
+        PrintServeHelper();
+        throw std::invalid_argument("-nthread should be a positive integer");
+    }
+}
+
+#endif //KAMRAT_RUNINFOFILES_SERVE_HPP
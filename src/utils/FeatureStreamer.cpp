@@ -1,6 +1,7 @@
 #include <iostream>
 #include <feature_elem.hpp>
 #include "FeatureStreamer.hpp"
+#include "index_loading.hpp"
 
 
 using namespace std;
@@ -94,12 +95,8 @@ bool FeatureStreamer::hasNext_matrix() {
     if (this->already_loaded)
         // Already in read
         return true;
-    else if (this->pos_file.read(reinterpret_cast<char *>(&(this->feature_pos[0])), sizeof(uint64_t))) {
-        // Increment the file position
-        if (this->k_len > 0) {
-            if (! this->pos_file.read(reinterpret_cast<char *>(&(this->feature_pos[0])), sizeof(size_t)))
-                return false;
-        }
+    else if (this->pos_file.ignore(GetCodeSize(this->k_len)) && this->pos_file.read(reinterpret_cast<char *>(&(this->feature_pos[0])), sizeof(size_t))) {
+        // Skip the k-mer code if any, then read the file position
         this->already_loaded = true;
         return true;
     }
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "IndexRandomAccess.hpp"
+#include "index_loading.hpp"
 
 
 using namespace std;
@@ -41,7 +42,7 @@ IndexRandomAccess::IndexRandomAccess(const std::string pos_path, const std::stri
 	// Define usefull variables
 	this->nb_smp = this->matrix_header.size();
 	this->matrix_line_size = this->matrix_header.size() * sizeof(float) + this->k + 1;
-	this->pos_line_size = sizeof(size_t) + (this->k == 0 ? 0 : sizeof(uint64_t));
+	this->pos_line_size = sizeof(size_t) + GetCodeSize(this->k);
 	
 	this->mat_file.seekg (0, this->mat_file.end);
     this->mat_length = this->mat_file.tellg();
@@ -112,14 +113,11 @@ uint64_t IndexRandomAccess::feature_to_position(const uint64_t feature_idx) {
 		this->pos_position = go_position;
 	}
 
-	uint64_t kmer_code;
-	if (this->k > 0) {
-		this->pos_file.read(reinterpret_cast<char *>(&kmer_code), sizeof(uint64_t));
-	}
+	this->pos_file.ignore(this->pos_line_size - sizeof(size_t)); // k-mer code if any
 	size_t matrix_index;
 	this->pos_file.read(reinterpret_cast<char *>(&matrix_index), sizeof(size_t));
 	
-	this->pos_position += sizeof(size_t) + (this->k == 0 ? 0 : sizeof(uint64_t));
+	this->pos_position += this->pos_line_size;
 
 	return matrix_index;
 }
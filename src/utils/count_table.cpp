@@ -0,0 +1,88 @@
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "count_table.hpp"
+
+/* ------------------------------------------------------------------ *\
+ * Parsing of feature count tables, shared by indexing and by scoring *
+ * directly from a table:                                             *
+ *   - first row: header with feature column name and sample names    *
+ *   - other rows: feature name followed by sample counts             *
+\* ------------------------------------------------------------------ */
+
+const size_t CountColumn(const std::string &line_str)
+{
+    size_t nb_smp(0);
+    std::istringstream conv(line_str);
+    std::string term;
+    // count sample number, skipping the first column
+    for (conv >> term; conv >> term; ++nb_smp){}
+    if (nb_smp == 0)
+    {
+        throw std::domain_error("input table parsing failed: sample number equals to 0");
+    }
+    return nb_smp;
+}
+
+const std::vector<float> &ParseCountRow(std::string &ft_name, std::vector<float> &count_vect, const std::string &line_str)
+{
+    thread_local static std::istringstream conv;
+    thread_local static std::string term;
+
+    conv.clear();
+    conv.str(line_str);
+    count_vect.clear();
+    for (conv >> ft_name; conv >> term; count_vect.push_back(std::stof(term))) // parse feature name and following count columns
+    {
+    }
+    return count_vect;
+}
+
+void ComputeNF(std::vector<double> &nf_vect, std::istream &kmer_count_instream, const size_t nf_base)
+{
+    std::string line_str, ft_name;
+    std::vector<float> count_vect;
+
+    std::getline(kmer_count_instream, line_str);
+    size_t nb_smp = CountColumn(line_str);
+    nf_vect.resize(nb_smp, 0);
+    while (std::getline(kmer_count_instream, line_str))
+    {
+        ParseCountRow(ft_name, count_vect, line_str);
+        // check if all rows have same number of columns as the header row
+        if (count_vect.size() != nb_smp) 
+        {
+            throw std::length_error("sample numbers are not consistent: " + std::to_string(nb_smp) + " vs " + std::to_string(count_vect.size()));
+        }
+        for (size_t i_smp(0); i_smp < nb_smp; ++i_smp) // add count vectors together for eventual normalization
+        {
+            nf_vect[i_smp] += count_vect[i_smp];
+        }
+    }
+    for (size_t i_smp(0); i_smp < nb_smp; ++i_smp)
+    {
+        nf_vect[i_smp] = nf_base / nf_vect[i_smp];
+        if (nf_vect[i_smp] < 0.1)
+        {
+            throw std::invalid_argument("normalization factor too small (" + std::to_string(nf_vect[i_smp]) + "), please try larger base");
+        }
+        else if (nf_vect[i_smp] > 1000)
+        {
+            throw std::invalid_argument("normalization factor too large (" + std::to_string(nf_vect[i_smp]) + "), please try smaller base");
+        }
+    }
+}
+
+void LoadNF(std::vector<double> &nf_vect, const std::string &nf_file_path)
+{
+    std::ifstream nf_file(nf_file_path);
+    if (!nf_file.is_open())
+    {
+        throw std::invalid_argument("cannot open count NF file: " + nf_file_path);
+    }
+    for (double x(0); nf_file >> x; nf_vect.push_back(x))
+    {
+    }
+    nf_file.close();
+}
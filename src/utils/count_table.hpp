@@ -0,0 +1,13 @@
+#include <string>
+#include <vector>
+#include <istream>
+
+#ifndef CTAB_H
+#define CTAB_H
+
+const size_t CountColumn(const std::string &line_str);
+const std::vector<float> &ParseCountRow(std::string &ft_name, std::vector<float> &count_vect, const std::string &line_str);
+void ComputeNF(std::vector<double> &nf_vect, std::istream &kmer_count_instream, const size_t nf_base);
+void LoadNF(std::vector<double> &nf_vect, const std::string &nf_file_path);
+
+#endif
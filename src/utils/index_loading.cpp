@@ -6,6 +6,7 @@
 #include <armadillo>
 
 #include "index_loading.hpp"
+#include "seq_coding.hpp"
 
 
 // using code2kmer_t = std::map<uint64_t, std::pair<std::string, size_t>>;
@@ -50,37 +51,26 @@ void LoadIndexMeta(size_t &nb_smp_all, size_t &k_len, bool &stranded, std::vecto
     idx_meta.close();
 }
 
-void LoadPosVect(std::vector<size_t> &pos_vect, const std::string &idx_pos_path, const bool need_skip_code)
+const size_t GetCodeSize(const size_t k_len)
 {
-    std::ifstream idx_pos(idx_pos_path);
-    if (!idx_pos.is_open())
+    if (k_len == 0)
     {
-        throw std::invalid_argument("loading index-pos failed, KaMRaT index folder not found or may be corrupted");
+        return 0;
     }
-    size_t pos;
-    while (idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
-    {
-        if (need_skip_code)
-        {
-            idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t));
-        }
-        pos_vect.emplace_back(pos);
-    }
-    idx_pos.close();
+    return (k_len > kMaxKLen64 ? sizeof(uint128_t) : sizeof(uint64_t));
 }
 
-void LoadCodePosMap(std::map<uint64_t, size_t> &code_pos_map, const std::string &idx_pos_path)
+void LoadPosVect(std::vector<size_t> &pos_vect, const std::string &idx_pos_path, const size_t code_size)
 {
     std::ifstream idx_pos(idx_pos_path);
     if (!idx_pos.is_open())
     {
         throw std::invalid_argument("loading index-pos failed, KaMRaT index folder not found or may be corrupted");
     }
-    uint64_t code;
     size_t pos;
-    while (idx_pos.read(reinterpret_cast<char *>(&code), sizeof(uint64_t)) && idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
+    while (idx_pos.ignore(code_size) && idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
     {
-        code_pos_map.insert({code, pos});
+        pos_vect.emplace_back(pos);
     }
     idx_pos.close();
 }
@@ -118,7 +108,7 @@ void LoadCodePosValMap(std::map<uint64_t, std::pair<size_t, float>> &code_posval
 }
 
 void LoadFeaturePosMap(std::unordered_map<std::string, size_t> &ft_pos_map, std::ifstream &idx_mat, const std::string &idx_pos_path,
-                       const bool need_skip_code, const size_t nb_smp)
+                       const size_t code_size, const size_t nb_smp)
 {
     std::ifstream idx_pos(idx_pos_path);
     if (!idx_pos.is_open())
@@ -127,12 +117,8 @@ void LoadFeaturePosMap(std::unordered_map<std::string, size_t> &ft_pos_map, std:
     }
     size_t pos;
     std::string feature;
-    while (idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
+    while (idx_pos.ignore(code_size) && idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t)))
     {
-        if (need_skip_code)
-        {
-            idx_pos.read(reinterpret_cast<char *>(&pos), sizeof(size_t));
-        }
         idx_mat.seekg(pos + nb_smp * sizeof(float));
         idx_mat >> feature;
         ft_pos_map.insert({feature, pos});
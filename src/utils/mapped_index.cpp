@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#include "mapped_index.hpp"
+#include "index_loading.hpp"
+
+const char kMaskTag[8] = {'K', 'M', 'R', 'T', 'M', 'A', 'S', 'K'}; // first bytes of a mask index
+const size_t kMaskHeaderSize = 32;                                  // tag, k-mer length, strandedness, number of codes
+
+const char *MapFile(size_t &file_size, const std::string &file_path)
+{
+    const int fd = open(file_path.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) != 0)
+    {
+        throw std::invalid_argument("cannot open index file: " + file_path + ", KaMRaT index folder not found or may be corrupted");
+    }
+    file_size = file_stat.st_size;
+    void *addr = (file_size == 0 ? nullptr : mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0));
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        throw std::domain_error("cannot map index file in memory: " + file_path);
+    }
+    return static_cast<const char *>(addr);
+}
+
+void UnmapFile(const char *addr, const size_t file_size)
+{
+    if (addr != nullptr)
+    {
+        munmap(const_cast<char *>(addr), file_size);
+    }
+}
+
+template <typename kmerCode_t>
+MappedIndex<kmerCode_t>::MappedIndex(const std::string &idx_dir)
+    : stranded_(true), pos_map_(nullptr), mat_map_(nullptr), pos_size_(0), mat_size_(0)
+{
+    LoadIndexMeta(nb_smp_, k_len_, stranded_, colname_vect_, idx_dir + "/idx-meta.bin");
+    if (k_len_ == 0)
+    {
+        throw std::invalid_argument("mapping an index relies on the index in k-mer mode, please rerun KaMRaT-index with -klen option");
+    }
+    if (GetCodeSize(k_len_) != sizeof(kmerCode_t))
+    {
+        throw std::domain_error("k-mer code width does not match the k-mer length of the index");
+    }
+    pos_map_ = MapFile(pos_size_, idx_dir + "/idx-pos.bin");
+    mat_map_ = MapFile(mat_size_, idx_dir + "/idx-mat.bin");
+    code_pos_arr_ = reinterpret_cast<const CodePos *>(pos_map_);
+    nb_kmer_ = pos_size_ / sizeof(CodePos);
+    if (!std::is_sorted(code_pos_arr_, code_pos_arr_ + nb_kmer_, [](const CodePos &a, const CodePos &b)
+                        { return a.code < b.code; }))
+    {
+        sorted_code_pos_.assign(code_pos_arr_, code_pos_arr_ + nb_kmer_);
+        std::sort(sorted_code_pos_.begin(), sorted_code_pos_.end(), [](const CodePos &a, const CodePos &b)
+                  { return a.code < b.code; });
+        code_pos_arr_ = sorted_code_pos_.data();
+    }
+}
+
+template <typename kmerCode_t>
+MappedIndex<kmerCode_t>::~MappedIndex()
+{
+    if (pos_map_ != nullptr)
+    {
+        munmap(const_cast<char *>(pos_map_), pos_size_);
+    }
+    if (mat_map_ != nullptr)
+    {
+        munmap(const_cast<char *>(mat_map_), mat_size_);
+    }
+}
+
+template <typename kmerCode_t>
+const size_t MappedIndex<kmerCode_t>::GetNbSmp() const
+{
+    return nb_smp_;
+}
+
+template <typename kmerCode_t>
+const size_t MappedIndex<kmerCode_t>::GetKLen() const
+{
+    return k_len_;
+}
+
+template <typename kmerCode_t>
+const bool MappedIndex<kmerCode_t>::IsStranded() const
+{
+    return stranded_;
+}
+
+template <typename kmerCode_t>
+const std::vector<std::string> &MappedIndex<kmerCode_t>::GetColNameVect() const
+{
+    return colname_vect_;
+}
+
+template <typename kmerCode_t>
+const bool MappedIndex<kmerCode_t>::FindPos(size_t &pos, const kmerCode_t code) const
+{
+    const CodePos *it = std::lower_bound(code_pos_arr_, code_pos_arr_ + nb_kmer_, code, [](const CodePos &a, const kmerCode_t c)
+                                         { return a.code < c; });
+    if (it == code_pos_arr_ + nb_kmer_ || it->code != code)
+    {
+        return false;
+    }
+    pos = it->pos;
+    return true;
+}
+
+template <typename kmerCode_t>
+const std::vector<float> &MappedIndex<kmerCode_t>::GetCountVect(std::vector<float> &count_vect, const size_t pos) const
+{
+    count_vect.resize(nb_smp_);
+    CopyCountVect(count_vect.data(), pos);
+    return count_vect;
+}
+
+template <typename kmerCode_t>
+void MappedIndex<kmerCode_t>::CopyCountVect(float *count_arr, const size_t pos) const
+{
+    std::memcpy(count_arr, mat_map_ + pos, nb_smp_ * sizeof(float)); // rows are not aligned on float
+}
+
+template class MappedIndex<uint64_t>;
+template class MappedIndex<uint128_t>;
+
+void LoadMaskMeta(size_t &k_len, bool &stranded, size_t &nb_code, const std::string &mask_path)
+{
+    std::ifstream mask_file(mask_path, std::ios::binary);
+    if (!mask_file.is_open())
+    {
+        throw std::invalid_argument("cannot open mask index: " + mask_path);
+    }
+    char tag[sizeof(kMaskTag)];
+    uint64_t header[3];
+    if (!mask_file.read(tag, sizeof(kMaskTag)) || !mask_file.read(reinterpret_cast<char *>(header), sizeof(header)) ||
+        std::memcmp(tag, kMaskTag, sizeof(kMaskTag)) != 0)
+    {
+        throw std::domain_error("not a mask index built by KaMRaT mask-build: " + mask_path);
+    }
+    k_len = header[0];
+    stranded = (header[1] != 0);
+    nb_code = header[2];
+}
+
+template <typename kmerCode_t>
+void WriteMaskIndex(const std::string &mask_path, const std::vector<kmerCode_t> &kmer_mask, const size_t k_len, const bool stranded)
+{
+    std::ofstream mask_file(mask_path, std::ios::binary);
+    if (!mask_file.is_open())
+    {
+        throw std::domain_error("cannot open file: " + mask_path);
+    }
+    const uint64_t header[3] = {k_len, stranded, kmer_mask.size()};
+    mask_file.write(kMaskTag, sizeof(kMaskTag));
+    mask_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    mask_file.write(reinterpret_cast<const char *>(kmer_mask.data()), kmer_mask.size() * sizeof(kmerCode_t));
+    if (!mask_file.flush())
+    {
+        throw std::domain_error("writing mask index failed: " + mask_path);
+    }
+}
+
+template <typename kmerCode_t>
+MappedMask<kmerCode_t>::MappedMask(const std::string &mask_path)
+    : mask_map_(nullptr), mask_size_(0)
+{
+    LoadMaskMeta(k_len_, stranded_, nb_code_, mask_path);
+    if (GetCodeSize(k_len_) != sizeof(kmerCode_t))
+    {
+        throw std::domain_error("k-mer code width does not match the k-mer length of the mask index");
+    }
+    mask_map_ = MapFile(mask_size_, mask_path);
+    if (mask_size_ != kMaskHeaderSize + nb_code_ * sizeof(kmerCode_t))
+    {
+        munmap(const_cast<char *>(mask_map_), mask_size_);
+        throw std::domain_error("mask index truncated or corrupted: " + mask_path);
+    }
+}
+
+template <typename kmerCode_t>
+MappedMask<kmerCode_t>::~MappedMask()
+{
+    munmap(const_cast<char *>(mask_map_), mask_size_);
+}
+
+template <typename kmerCode_t>
+const size_t MappedMask<kmerCode_t>::GetKLen() const
+{
+    return k_len_;
+}
+
+template <typename kmerCode_t>
+const bool MappedMask<kmerCode_t>::IsStranded() const
+{
+    return stranded_;
+}
+
+template <typename kmerCode_t>
+const size_t MappedMask<kmerCode_t>::GetNbCode() const
+{
+    return nb_code_;
+}
+
+template <typename kmerCode_t>
+const kmerCode_t *MappedMask<kmerCode_t>::GetCodeArr() const
+{
+    return reinterpret_cast<const kmerCode_t *>(mask_map_ + kMaskHeaderSize); // mapping is page-aligned, the header keeps codes aligned
+}
+
+template class MappedMask<uint64_t>;
+template class MappedMask<uint128_t>;
+
+template <typename kmerCode_t>
+MaskLookup<kmerCode_t>::MaskLookup(const kmerCode_t *mask_begin, const kmerCode_t *mask_end)
+    : mask_begin_(mask_begin), mask_end_(mask_end), mask_it_(mask_begin), last_code_(0)
+{
+}
+
+template <typename kmerCode_t>
+const bool MaskLookup<kmerCode_t>::IsInMask(const kmerCode_t code)
+{
+    if (code < last_code_)
+    {
+        mask_it_ = std::lower_bound(mask_begin_, mask_it_, code);
+    }
+    else
+    {
+        auto gallop_end = mask_it_;
+        for (size_t step(1); gallop_end != mask_end_ && *gallop_end < code; step <<= 1)
+        {
+            mask_it_ = gallop_end + 1;
+            gallop_end = (static_cast<size_t>(mask_end_ - gallop_end) > step ? gallop_end + step : mask_end_);
+        }
+        mask_it_ = std::lower_bound(mask_it_, gallop_end, code);
+    }
+    last_code_ = code;
+    return (mask_it_ != mask_end_ && *mask_it_ == code);
+}
+
+template class MaskLookup<uint64_t>;
+template class MaskLookup<uint128_t>;
+
+MappedMat::MappedMat(const std::string &mat_path, const size_t nb_smp)
+    : nb_smp_(nb_smp), last_pos_(0), is_seq_(true)
+{
+    mat_map_ = MapFile(mat_size_, mat_path);
+    if (mat_map_ != nullptr)
+    {
+        madvise(const_cast<char *>(mat_map_), mat_size_, MADV_SEQUENTIAL); // read-ahead, unless rows are visited out of file order
+    }
+}
+
+MappedMat::~MappedMat()
+{
+    UnmapFile(mat_map_, mat_size_);
+}
+
+const size_t MappedMat::GetSize() const
+{
+    return mat_size_;
+}
+
+void MappedMat::VisitRow(const size_t pos)
+{
+    if (pos + nb_smp_ * sizeof(float) > mat_size_)
+    {
+        throw std::domain_error("feature position out of index-mat, KaMRaT index folder may be corrupted");
+    }
+    if (is_seq_ && pos < last_pos_)
+    {
+        madvise(const_cast<char *>(mat_map_), mat_size_, MADV_NORMAL);
+        is_seq_ = false;
+    }
+    last_pos_ = pos;
+}
+
+void MappedMat::CopyCountVect(float *count_arr, const size_t pos) const
+{
+    std::memcpy(count_arr, mat_map_ + pos, nb_smp_ * sizeof(float)); // rows are not aligned on float
+}
+
+const size_t MappedMat::GetName(const char *&name_start, const size_t pos) const
+{
+    const char *mat_end = mat_map_ + mat_size_;
+    name_start = mat_map_ + pos + nb_smp_ * sizeof(float);
+    while (name_start < mat_end && isspace(*name_start))
+    {
+        ++name_start;
+    }
+    const char *name_end = name_start;
+    while (name_end < mat_end && !isspace(*name_end))
+    {
+        ++name_end;
+    }
+    return (name_end - name_start);
+}
+template void WriteMaskIndex(const std::string &mask_path, const std::vector<uint64_t> &kmer_mask, size_t k_len, bool stranded);
+template void WriteMaskIndex(const std::string &mask_path, const std::vector<uint128_t> &kmer_mask, size_t k_len, bool stranded);
@@ -0,0 +1,124 @@
+#ifndef KAMRAT_UTILS_MAPPEDINDEX_HPP
+#define KAMRAT_UTILS_MAPPEDINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "seq_coding.hpp"
+
+const char *MapFile(size_t &file_size, const std::string &file_path); // whole file mapped read-only, nullptr if empty
+void UnmapFile(const char *addr, size_t file_size);
+
+/** Read-only view of a KaMRaT index in k-mer mode, with idx-pos.bin and idx-mat.bin mapped in memory.
+ * Nothing is loaded at opening: k-mer codes are looked up by binary search in idx-pos.bin, ordered by code,
+ * and count vectors are copied from idx-mat.bin, so that lookups are possible from concurrent threads.
+ * kmerCode_t is the width of the codes in idx-pos.bin: uint64_t for k <= 32, uint128_t for k <= 64.
+ */
+template <typename kmerCode_t = uint64_t>
+class MappedIndex
+{
+public:
+    MappedIndex(const std::string &idx_dir);
+    ~MappedIndex();
+    MappedIndex(const MappedIndex &) = delete;
+    MappedIndex &operator=(const MappedIndex &) = delete;
+
+    const size_t GetNbSmp() const;
+    const size_t GetKLen() const;
+    const bool IsStranded() const;
+    const std::vector<std::string> &GetColNameVect() const;
+    const bool FindPos(size_t &pos, kmerCode_t code) const; // position in idx-mat.bin of the k-mer code
+    const std::vector<float> &GetCountVect(std::vector<float> &count_vect, size_t pos) const;
+    void CopyCountVect(float *count_arr, size_t pos) const; // to a buffer of nb_smp floats
+
+private:
+#pragma pack(push, 1)
+    struct CodePos // one record of idx-pos.bin, 128-bit codes are not aligned
+    {
+        kmerCode_t code;
+        uint64_t pos;
+    };
+#pragma pack(pop)
+
+    size_t nb_smp_, k_len_;
+    bool stranded_;
+    std::vector<std::string> colname_vect_;
+    const char *pos_map_, *mat_map_;       // mapped idx-pos.bin and idx-mat.bin
+    size_t pos_size_, mat_size_;           // sizes of the mapped files
+    const CodePos *code_pos_arr_;          // (code, pos) records ordered by code
+    size_t nb_kmer_;
+    std::vector<CodePos> sorted_code_pos_; // copy of idx-pos.bin sorted by code, if it is not
+};
+
+/** Read-only view of a mask index written by kamrat mask-build, mapped in memory: a 32-byte header, holding a tag, the k-mer length,
+ * the strandedness and the number of codes, followed by the sorted distinct k-mer codes (canonical if unstranded) of the mask sequences.
+ */
+template <typename kmerCode_t = uint64_t>
+class MappedMask
+{
+public:
+    MappedMask(const std::string &mask_path);
+    ~MappedMask();
+    MappedMask(const MappedMask &) = delete;
+    MappedMask &operator=(const MappedMask &) = delete;
+
+    const size_t GetKLen() const;
+    const bool IsStranded() const;
+    const size_t GetNbCode() const;
+    const kmerCode_t *GetCodeArr() const; // sorted codes
+
+private:
+    size_t k_len_, nb_code_;
+    bool stranded_;
+    const char *mask_map_; // mapped mask index file
+    size_t mask_size_;
+};
+
+/** Membership of k-mer codes in the sorted codes of a mask, codes being given in idx-pos.bin order, shared by kamrat mask and kamrat pipeline.
+ * Each code is searched by galloping forward from the previous match, which makes a linear merge-join when idx-pos is ordered by code,
+ * and by binary search behind the previous match otherwise.
+ */
+template <typename kmerCode_t = uint64_t>
+class MaskLookup
+{
+public:
+    MaskLookup(const kmerCode_t *mask_begin, const kmerCode_t *mask_end);
+
+    const bool IsInMask(kmerCode_t code);
+
+private:
+    const kmerCode_t *mask_begin_, *mask_end_;
+    const kmerCode_t *mask_it_; // previous match
+    kmerCode_t last_code_;
+};
+
+/** Read-only view of idx-mat.bin mapped in memory, rows being visited in idx-pos.bin order, shared by kamrat filter and kamrat pipeline.
+ * Read-ahead is asked while rows come in file order, as for a k-mer table indexed as given, and dropped at the first row behind the previous one.
+ */
+class MappedMat
+{
+public:
+    MappedMat(const std::string &mat_path, size_t nb_smp);
+    ~MappedMat();
+    MappedMat(const MappedMat &) = delete;
+    MappedMat &operator=(const MappedMat &) = delete;
+
+    const size_t GetSize() const;
+    void VisitRow(size_t pos);                                   // check the whole count row is in the file, rows being given in visiting order
+    void CopyCountVect(float *count_arr, size_t pos) const;      // to a buffer of nb_smp floats
+    const size_t GetName(const char *&name_start, size_t pos) const; // feature name after the count row, returning its length
+
+private:
+    size_t nb_smp_;
+    const char *mat_map_; // mapped idx-mat.bin
+    size_t mat_size_;
+    size_t last_pos_;
+    bool is_seq_; // whether rows are visited in file order until now
+};
+
+void LoadMaskMeta(size_t &k_len, bool &stranded, size_t &nb_code, const std::string &mask_path); // header of a mask index
+template <typename kmerCode_t>
+void WriteMaskIndex(const std::string &mask_path, const std::vector<kmerCode_t> &kmer_mask, size_t k_len, bool stranded);
+
+#endif //KAMRAT_UTILS_MAPPEDINDEX_HPP
@@ -1,6 +1,8 @@
 #include <string>
 #include <limits>
 
+#include "seq_coding.hpp"
+
 inline uint8_t Nuc2Num(const char nuc)
 {
     if (nuc == 'a' || nuc == 'A')
@@ -51,52 +53,45 @@ inline char Num2Nuc(const uint8_t c)
 
 uint64_t GetRC(const uint64_t code, size_t k_length)
 {
-    uint64_t mask, tmp_code(code);
-    if (k_length == 32)
-        mask = ~0;
-    else
-        mask = ((uint64_t)1 << (2 * k_length)) - 1;
-
-    tmp_code ^= mask;
-
-    uint64_t mask_lsb;
-    mask_lsb = 3; // corresponds to the rightmost nucleotide //
-    uint64_t shift = 0;
-    uint64_t result = 0;
-    for (size_t j = 0; j < k_length; ++j)
-    {
-        result <<= 2;
-        result |= (tmp_code & mask_lsb) >> shift; // get the leftmost nucleotide and put it at the end //
-        mask_lsb <<= 2;
-        shift += 2;
-    }
+    uint64_t result = ~code; // complement: A <-> T, C <-> G
+    result = ((result >> 2) & 0x3333333333333333) | ((result & 0x3333333333333333) << 2); // reverse nucleotides in each byte
+    result = ((result >> 4) & 0x0F0F0F0F0F0F0F0F) | ((result & 0x0F0F0F0F0F0F0F0F) << 4);
+    result = __builtin_bswap64(result); // reverse bytes
+    return result >> (64 - 2 * k_length);
+}
 
-    return result;
+uint128_t GetRC(const uint128_t code, size_t k_length)
+{
+    // reverse-complement each half as a full word, then swap the halves
+    const uint128_t result = (static_cast<uint128_t>(GetRC(static_cast<uint64_t>(code), kMaxKLen64)) << 64) |
+                             GetRC(static_cast<uint64_t>(code >> 64), kMaxKLen64);
+    return result >> (128 - 2 * k_length);
 }
 
-void Int2Seq(std::string &seq, const uint64_t code, const size_t k_length)
+template <typename kmerCode_t>
+void Int2Seq(std::string &seq, const kmerCode_t code, const size_t k_length)
 {
-    uint64_t tmp_code(code);
+    kmerCode_t tmp_code(code);
     seq.resize(k_length);
-    uint64_t mask = 3;
     for (size_t i = 0; i < k_length; ++i)
     {
-        seq[k_length - i - 1] = Num2Nuc(tmp_code & mask);
+        seq[k_length - i - 1] = Num2Nuc(static_cast<uint8_t>(tmp_code & 3));
         tmp_code >>= 2;
     }
 }
 
-uint64_t Seq2Int(const std::string &seq, const size_t k_length, const bool stranded)
+template <typename kmerCode_t>
+const kmerCode_t Seq2Int(const std::string &seq, const size_t k_length, const bool stranded)
 {
-    uint64_t code = 0;
+    kmerCode_t code = 0;
     for (size_t i = 0; i < k_length; ++i)
     {
         code <<= 2;
-        code |= Nuc2Num(seq[i]);
+        code |= (Nuc2Num(seq[i]) & 3); // a non-ACGT base would otherwise overwrite its neighbours
     }
     if (!stranded)
     {
-        uint64_t code_rc = GetRC(code, k_length);
+        kmerCode_t code_rc = GetRC(code, k_length);
         if (code_rc < code)
         {
             code = code_rc;
@@ -105,41 +100,17 @@ uint64_t Seq2Int(const std::string &seq, const size_t k_length, const bool stran
     return code;
 }
 
-inline uint64_t MutIntAtPos(uint64_t code, const size_t k_length, const int pos, const char n)
-{
-    uint64_t x = (k_length - pos - 1) * 2;
-    uint64_t up = 1;
-    if (n == 'A')
-    {
-        code &= ~(up << x);
-        code &= ~(up << (x + 1));
-    }
-    else if (n == 'C')
-    {
-        code |= up << x;
-        code &= ~(up << (x + 1));
-    }
-    else if (n == 'G')
-    {
-        code &= ~(up << x);
-        code |= up << (x + 1);
-    }
-    else
-    {
-        code |= up << x;
-        code |= up << (x + 1);
-    }
-    return code;
-}
+template void Int2Seq<uint64_t>(std::string &seq, const uint64_t code, const size_t k_length);
+template void Int2Seq<uint128_t>(std::string &seq, const uint128_t code, const size_t k_length);
+template const uint64_t Seq2Int<uint64_t>(const std::string &seq, const size_t k_length, const bool stranded);
+template const uint128_t Seq2Int<uint128_t>(const std::string &seq, const size_t k_length, const bool stranded);
 
-uint64_t NextCode(uint64_t code, const size_t k_length, const char new_nuc)
-// Attention: should not return the RC code if unstranded !
-//            returning of RC code would disturb the calculation of downstreaming k-mers.
-{
-    uint64_t x = (k_length - 1) * 2, up = 3;
-    // Unset the first nucleotide
-    code &= ~(up << x); // TO TEST: is this necessary ?
-    code <<= 2;
-    code = MutIntAtPos(code, k_length, k_length - 1, new_nuc);
-    return code;
-}
+const uint8_t kNucNum[256] = {
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, // 'A', 'C', 'G', 'T'
+    4, 0, 4, 1, 4, 4, 4, 2, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, // 'a', 'c', 'g', 't'
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
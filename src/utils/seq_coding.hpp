@@ -1,10 +1,94 @@
+#include <string>
+#include <cstdint>
+#include <functional>
 
 #ifndef SEQ_H
 #define SEQ_H
 
-const uint64_t Seq2Int(const std::string &seq, const size_t k_len, const bool stranded);
+using uint128_t = unsigned __int128; // k-mer code for k in (32, 64]
+
+const size_t kMaxKLen64 = 32, kMaxKLen128 = 64; // longest k-mers coded by uint64_t and uint128_t
+
+extern const uint8_t kNucNum[256]; // 0-3 for ACGT (either case), 4 for other bases
+
+template <typename kmerCode_t = uint64_t>
+const kmerCode_t Seq2Int(const std::string &seq, const size_t k_len, const bool stranded);
+template <typename kmerCode_t>
+void Int2Seq(std::string &seq, const kmerCode_t code, const size_t k_length);
 uint64_t GetRC(const uint64_t code, size_t k_length);
-uint64_t NextCode(uint64_t code, const size_t k_length, const char new_nuc);
+uint128_t GetRC(const uint128_t code, size_t k_length);
+
+/** 64-bit word standing for a k-mer code in hashing: the code itself if it fits.
+ */
+inline uint64_t FoldCode(const uint64_t code)
+{
+    return code;
+}
+
+inline uint64_t FoldCode(const uint128_t code)
+{
+    return (static_cast<uint64_t>(code) ^ (static_cast<uint64_t>(code >> 64) * 0x9E3779B97F4A7C15ULL));
+}
+
+struct KmerCodeHash // std::hash is not provided for 128-bit integers in strict ISO mode
+{
+    template <typename kmerCode_t>
+    size_t operator()(const kmerCode_t code) const
+    {
+        return std::hash<uint64_t>()(FoldCode(code));
+    }
+};
+
+/** Rolling encoder of the k-mers along a sequence, advancing the forward and reverse-complement codes in O(1) per base.
+ * A non-ACGT base resets the window, so that no k-mer overlapping it is produced.
+ */
+template <typename kmerCode_t = uint64_t>
+class KmerRoller
+{
+public:
+    KmerRoller(size_t k_len)
+        : k_len_(k_len), rc_shift_(2 * (k_len - 1)),
+          mask_(2 * k_len == 8 * sizeof(kmerCode_t) ? ~static_cast<kmerCode_t>(0) : (static_cast<kmerCode_t>(1) << (2 * k_len)) - 1)
+    {
+        Reset();
+    }
+    void Reset() // for a new sequence
+    {
+        fw_code_ = 0;
+        rc_code_ = 0;
+        nb_valid_ = 0;
+    }
+    const bool Roll(const char nuc) // push a base at right, true if the window holds a valid k-mer
+    {
+        const uint8_t num = kNucNum[static_cast<unsigned char>(nuc)];
+        if (num > 3)
+        {
+            Reset();
+            return false;
+        }
+        fw_code_ = ((fw_code_ << 2) | num) & mask_;
+        rc_code_ = (rc_code_ >> 2) | (static_cast<kmerCode_t>(3 - num) << rc_shift_);
+        return (++nb_valid_ >= k_len_);
+    }
+    const kmerCode_t GetCode(const bool stranded) const // forward code if stranded, canonical code if not
+    {
+        return ((stranded || fw_code_ <= rc_code_) ? fw_code_ : rc_code_);
+    }
+    const kmerCode_t GetFwCode() const
+    {
+        return fw_code_;
+    }
+    const kmerCode_t GetRCCode() const
+    {
+        return rc_code_;
+    }
 
+private:
+    const size_t k_len_;
+    const unsigned int rc_shift_;
+    const kmerCode_t mask_;
+    kmerCode_t fw_code_, rc_code_;
+    size_t nb_valid_; // number of valid bases at the end of the window
+};
 
 #endif
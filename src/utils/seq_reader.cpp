@@ -0,0 +1,163 @@
+#include <cstring> // memchr, memmove
+#include <cctype>  // isspace
+#include <stdexcept>
+#include <boost/iostreams/filtering_streambuf.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#include "seq_reader.hpp"
+
+const size_t kReadBlockSize = 16 << 20; // initial buffer size, doubled for a record not fitting in it
+
+SeqReader::SeqReader(const std::string &file_path)
+    : seq_file_(file_path, std::ios::binary), buffer_(kReadBlockSize), data_start_(0), data_end_(0), is_eof_(false), is_fastq_(false)
+{
+    if (!seq_file_.is_open())
+    {
+        throw std::invalid_argument("cannot open file: " + file_path);
+    }
+    auto inbuf = new boost::iostreams::filtering_streambuf<boost::iostreams::input>();
+    inbuf_.reset(inbuf);
+    if (file_path.size() >= 2 && file_path.substr(file_path.size() - 2) == "gz")
+    {
+        inbuf->push(boost::iostreams::gzip_decompressor());
+    }
+    inbuf->push(seq_file_);
+    FillBuffer();
+    while (data_start_ < data_end_ && isspace(buffer_[data_start_]))
+    {
+        ++data_start_;
+    }
+    if (data_start_ < data_end_ && buffer_[data_start_] != '>' && buffer_[data_start_] != '@')
+    {
+        throw std::domain_error("unknown sequence format, fasta or fastq expected: " + file_path);
+    }
+    is_fastq_ = (data_start_ < data_end_ && buffer_[data_start_] == '@');
+}
+
+const bool SeqReader::IsFastq() const
+{
+    return is_fastq_;
+}
+
+void SeqReader::FillBuffer()
+{
+    if (data_start_ > 0)
+    {
+        std::memmove(buffer_.data(), buffer_.data() + data_start_, data_end_ - data_start_);
+        data_end_ -= data_start_;
+        data_start_ = 0;
+    }
+    while (!is_eof_ && data_end_ < buffer_.size())
+    {
+        const std::streamsize nb_read = inbuf_->sgetn(buffer_.data() + data_end_, buffer_.size() - data_end_);
+        if (nb_read <= 0)
+        {
+            is_eof_ = true;
+        }
+        else
+        {
+            data_end_ += nb_read;
+        }
+    }
+}
+
+const size_t SeqReader::FindRecordEnd(const size_t rec_start) const
+{
+    const char *data_end = buffer_.data() + data_end_, *p = buffer_.data() + rec_start + 1;
+    if (is_fastq_) // header, sequence, '+' and quality lines
+    {
+        size_t nb_line(0);
+        while ((p = static_cast<const char *>(std::memchr(p, '\n', data_end - p))) != nullptr)
+        {
+            if (++nb_line == 4)
+            {
+                return (p + 1 - buffer_.data());
+            }
+            ++p;
+        }
+    }
+    else // up to the next line starting with '>'
+    {
+        while ((p = static_cast<const char *>(std::memchr(p, '\n', data_end - p))) != nullptr && p + 1 < data_end)
+        {
+            if (p[1] == '>')
+            {
+                return (p + 1 - buffer_.data());
+            }
+            ++p;
+        }
+    }
+    return (is_eof_ ? data_end_ : 0); // the last record may lack its final line break
+}
+
+void SeqReader::ParseRecord(SeqRecord &rec, const size_t rec_start, const size_t rec_end)
+{
+    char *const rec_end_ptr = buffer_.data() + rec_end;
+    char *line_start = buffer_.data() + rec_start + 1, *line_end;
+    line_end = static_cast<char *>(std::memchr(line_start, '\n', rec_end_ptr - line_start));
+    line_end = (line_end == nullptr ? rec_end_ptr : line_end);
+    rec.name = line_start;
+    rec.name_len = line_end - line_start - (line_end > line_start && line_end[-1] == '\r');
+    line_start = (line_end == rec_end_ptr ? rec_end_ptr : line_end + 1);
+    if (is_fastq_)
+    {
+        line_end = static_cast<char *>(std::memchr(line_start, '\n', rec_end_ptr - line_start));
+        line_end = (line_end == nullptr ? rec_end_ptr : line_end);
+        rec.seq = line_start;
+        rec.seq_len = line_end - line_start - (line_end > line_start && line_end[-1] == '\r');
+        if (line_end + 1 >= rec_end_ptr || line_end[1] != '+')
+        {
+            throw std::domain_error("invalid fastq record: " + std::string(rec.name, rec.name_len));
+        }
+    }
+    else // join the sequence lines in place
+    {
+        char *w = line_start;
+        for (const char *r = line_start; r < rec_end_ptr; ++r)
+        {
+            if (*r != '\n' && *r != '\r')
+            {
+                *(w++) = *r;
+            }
+        }
+        rec.seq = line_start;
+        rec.seq_len = w - line_start;
+    }
+}
+
+const bool SeqReader::NextBatch(std::vector<SeqRecord> &batch, const size_t nb_base)
+{
+    batch.clear();
+    FillBuffer(); // records of the previous batch are released
+    size_t nb_batch_base(0);
+    while (nb_batch_base < nb_base)
+    {
+        while (data_start_ < data_end_ && (buffer_[data_start_] == '\n' || buffer_[data_start_] == '\r')) // blank lines
+        {
+            ++data_start_;
+        }
+        const size_t rec_end = (data_start_ == data_end_ ? 0 : FindRecordEnd(data_start_));
+        if (rec_end == 0)
+        {
+            if (is_eof_ || !batch.empty()) // an incomplete record is completed for the next batch
+            {
+                break;
+            }
+            if (data_start_ == 0 && data_end_ == buffer_.size()) // a record longer than the buffer
+            {
+                buffer_.resize(2 * buffer_.size());
+            }
+            FillBuffer();
+            continue;
+        }
+        if (buffer_[data_start_] != (is_fastq_ ? '@' : '>'))
+        {
+            throw std::domain_error("invalid record start in " + std::string(is_fastq_ ? "fastq" : "fasta") + " file");
+        }
+        batch.emplace_back();
+        ParseRecord(batch.back(), data_start_, rec_end);
+        nb_batch_base += batch.back().seq_len;
+        data_start_ = rec_end;
+    }
+    return !batch.empty();
+}
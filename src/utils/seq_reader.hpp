@@ -0,0 +1,42 @@
+#ifndef KAMRAT_UTILS_SEQREADER_HPP
+#define KAMRAT_UTILS_SEQREADER_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <streambuf>
+
+/** A record of a fasta or fastq file, pointing into the reader's buffer: valid until the next batch is read.
+ */
+struct SeqRecord
+{
+    const char *name; // header line without its '>' or '@'
+    size_t name_len;
+    const char *seq; // sequence on one line, lines of a fasta sequence being joined in the buffer
+    size_t seq_len;
+};
+
+/** Streaming reader of fasta or fastq files, gzipped if the path ends with "gz", the format being told by the first character.
+ * The input is read by large blocks into a buffer where records are parsed in place, without any copy or allocation per record.
+ */
+class SeqReader
+{
+public:
+    SeqReader(const std::string &file_path);
+    const bool IsFastq() const;
+    const bool NextBatch(std::vector<SeqRecord> &batch, size_t nb_base); // records of at least nb_base bases if input and buffer allow
+
+private:
+    void FillBuffer();                                   // move unparsed data to the buffer front, then read until full or end of input
+    const size_t FindRecordEnd(size_t rec_start) const; // start of the next record, 0 if the record is not entirely in the buffer
+    void ParseRecord(SeqRecord &rec, size_t rec_start, size_t rec_end);
+
+    std::ifstream seq_file_;
+    std::unique_ptr<std::streambuf> inbuf_;
+    std::vector<char> buffer_;
+    size_t data_start_, data_end_; // unparsed data in the buffer
+    bool is_eof_, is_fastq_;
+};
+
+#endif //KAMRAT_UTILS_SEQREADER_HPP
@@ -2,6 +2,25 @@
 #include <numeric> // std::accumulate
 #include <cmath>   // sqrt
 #include <algorithm> // sort
+#include <cstring> // memcpy
+#include <cstdint>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define KAMRAT_AVX2_KERNELS // compiled for AVX2 by function attribute, used if the CPU supports it
+#include <immintrin.h>
+#endif
+
+/** Whether the distance kernels run with AVX2, checked once at run time.
+ **/
+const bool HasAVX2Kernels()
+{
+#ifdef KAMRAT_AVX2_KERNELS
+    static const bool has_avx2 = (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+    return has_avx2;
+#else
+    return false;
+#endif
+}
 
 const double CalcVectMean(const std::vector<float> &x)
 {
@@ -10,7 +29,7 @@ const double CalcVectMean(const std::vector<float> &x)
 
 void CalcVectRank(std::vector<float> &x_rk, const std::vector<float> &x)
 {
-    static std::vector<size_t> r, s; // r for rank number, s for same number
+    thread_local static std::vector<size_t> r, s; // r for rank number, s for same number
     size_t n = x.size();
     r.resize(n, 1);
     s.resize(n, 1);
@@ -137,27 +156,92 @@ const void mean_stddev(const std::vector<float> &vect, double &mean, double &std
 }
 
 
-const double CalcPearsonCorr(const std::vector<float> &x, const std::vector<float> &y)
+/** log2(x + 1) of each value, for non-negative counts.
+ * The bits of x + 1 are rebased on sqrt(2)/2, giving the exponent and a mantissa m in [sqrt(2)/2, sqrt(2)), whose
+ * logarithm is evaluated by the series 2 * atanh(t) with t = (m - 1) / (m + 1), accurate to 1e-12 there.
+ * The loop has no branch nor libm call, so that it can be vectorized.
+ **/
+const void log2p1(const std::vector<float> &vect, std::vector<double> &log_vect)
 {
-    // Compute prerequire for pearson
-    double sum_x(0), sum_y(0), sum_x2(0), sum_y2(0), sum_xy(0);
-    for (size_t i(0); i < x.size(); ++i)
+    const uint64_t kSqrtHalfBits = 0x3FE6A09E667F3BCDULL; // bits of sqrt(2)/2
+    const double kLog2e = 1.4426950408889634;
+    const size_t n = vect.size();
+    log_vect.resize(n);
+    const float *in = vect.data();
+    double *out = log_vect.data();
+    for (size_t i = 0; i < n; ++i) {
+        const double y = static_cast<double>(in[i]) + 1;
+        uint64_t bits;
+        std::memcpy(&bits, &y, sizeof(double));
+        bits -= kSqrtHalfBits;
+        const int32_t expo = static_cast<int32_t>(static_cast<int64_t>(bits) >> 52);
+        bits = (bits & 0x000FFFFFFFFFFFFFULL) + kSqrtHalfBits;
+        double m;
+        std::memcpy(&m, &bits, sizeof(double));
+        const double t = (m - 1) / (m + 1), t2 = t * t;
+        const double ln_m = t * (2 + t2 * (2.0 / 3 + t2 * (2.0 / 5 + t2 * (2.0 / 7 + t2 * (2.0 / 9 + t2 * (2.0 / 11 + t2 * (2.0 / 13)))))));
+        out[i] = static_cast<double>(expo) + ln_m * kLog2e;
+    }
+}
+
+
+/** Sums of x, y, x^2, y^2 and x*y over [i_start, n), in double precision.
+ **/
+inline void AddPearsonSums(const float *x, const float *y, const size_t i_start, const size_t n, double sums[5])
+{
+    for (size_t i(i_start); i < n; ++i)
     {
         double xi = static_cast<double>(x[i]);
         double yi = static_cast<double>(y[i]);
 
-        sum_x += xi;
-        sum_x2 += xi * xi;
-        sum_y += yi;
-        sum_y2 += yi * yi;
-        sum_xy += xi * yi;
+        sums[0] += xi;
+        sums[1] += yi;
+        sums[2] += xi * xi;
+        sums[3] += yi * yi;
+        sums[4] += xi * yi;
+    }
+}
+
+#ifdef KAMRAT_AVX2_KERNELS
+inline __attribute__((target("avx2,fma"))) const double HorizontalSum(const __m256d v)
+{
+    const __m128d h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(h, _mm_unpackhi_pd(h, h)));
+}
+
+/** AddPearsonSums by 4 samples at once, floats being widened to double as in the scalar loop.
+ **/
+__attribute__((target("avx2,fma"))) void AddPearsonSumsAVX2(const float *x, const float *y, const size_t n, double sums[5])
+{
+    __m256d sum_x = _mm256_setzero_pd(), sum_y = _mm256_setzero_pd(), sum_x2 = _mm256_setzero_pd(),
+            sum_y2 = _mm256_setzero_pd(), sum_xy = _mm256_setzero_pd();
+    size_t i(0);
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m256d xi = _mm256_cvtps_pd(_mm_loadu_ps(x + i)), yi = _mm256_cvtps_pd(_mm_loadu_ps(y + i));
+        sum_x = _mm256_add_pd(sum_x, xi);
+        sum_y = _mm256_add_pd(sum_y, yi);
+        sum_x2 = _mm256_fmadd_pd(xi, xi, sum_x2);
+        sum_y2 = _mm256_fmadd_pd(yi, yi, sum_y2);
+        sum_xy = _mm256_fmadd_pd(xi, yi, sum_xy);
     }
-    
+    sums[0] += HorizontalSum(sum_x);
+    sums[1] += HorizontalSum(sum_y);
+    sums[2] += HorizontalSum(sum_x2);
+    sums[3] += HorizontalSum(sum_y2);
+    sums[4] += HorizontalSum(sum_xy);
+    AddPearsonSums(x, y, i, n, sums);
+}
+#endif
+
+inline const double PearsonFromSums(const double sums[5], const size_t n)
+{
+    const double &sum_x = sums[0], &sum_y = sums[1], &sum_x2 = sums[2], &sum_y2 = sums[3], &sum_xy = sums[4];
     // Compute Pearson
     double prod_sum(0), t1_sqsum(0), t2_sqsum(0);
-    prod_sum = sum_xy - sum_x * sum_y / x.size();
-    t1_sqsum = sum_x2 - sum_x * sum_x / x.size();
-    t2_sqsum = sum_y2 - sum_y * sum_y / x.size();
+    prod_sum = sum_xy - sum_x * sum_y / n;
+    t1_sqsum = sum_x2 - sum_x * sum_x / n;
+    t2_sqsum = sum_y2 - sum_y * sum_y / n;
 
     // Conclude
     if (t1_sqsum == 0 || t2_sqsum == 0)
@@ -170,6 +254,26 @@ const double CalcPearsonCorr(const std::vector<float> &x, const std::vector<floa
     }
 }
 
+const double CalcPearsonCorr_scalar(const std::vector<float> &x, const std::vector<float> &y)
+{
+    double sums[5] = {0, 0, 0, 0, 0};
+    AddPearsonSums(x.data(), y.data(), 0, x.size(), sums);
+    return PearsonFromSums(sums, x.size());
+}
+
+const double CalcPearsonCorr(const std::vector<float> &x, const std::vector<float> &y)
+{
+#ifdef KAMRAT_AVX2_KERNELS
+    if (x.size() >= 16 && HasAVX2Kernels()) // reducing five vector sums costs more than it saves on fewer samples
+    {
+        double sums[5] = {0, 0, 0, 0, 0};
+        AddPearsonSumsAVX2(x.data(), y.data(), x.size(), sums);
+        return PearsonFromSums(sums, x.size());
+    }
+#endif
+    return CalcPearsonCorr_scalar(x, y);
+}
+
 const double CalcPearsonDist(const std::vector<float> &x, const std::vector<float> &y)
 {
     return (0.5 * (1 - CalcPearsonCorr(x, y)));
@@ -223,14 +327,23 @@ const void orderToRank(const std::vector<float> &vec, const std::vector<uint> &
 }
 
 
+/** Ranks of the values, ties having their mean rank, for Spearman correlation as Pearson correlation of ranks.
+ **/
+const void CalcRankVect(const std::vector<float> &vec, std::vector<float> &rank)
+{
+    thread_local static std::vector<uint> order;
+    getOrder(vec, order);
+    orderToRank(vec, order, rank);
+}
+
 const double CalcSpearmanCorr(const std::vector<float> &x, const std::vector<float> &y)
 {
     // Get the order in both x and y vectors
-    static std::vector<uint> x_order, y_order;
+    thread_local static std::vector<uint> x_order, y_order;
     getOrder(x, x_order);
     getOrder(y, y_order);
     // Transform the orders into floats
-    static std::vector<float> x_rank, y_rank;
+    thread_local static std::vector<float> x_rank, y_rank;
     if (x_rank.size() != x_order.size()) {
         x_rank.resize(x_order.size());
         y_rank.resize(y_order.size());
@@ -244,7 +357,7 @@ const double CalcSpearmanCorr(const std::vector<float> &x, const std::vector<flo
 
 const double CalcSpearmanCorr_old(const std::vector<float> &x, const std::vector<float> &y)
 {
-    static std::vector<float> x_rk, y_rk;
+    thread_local static std::vector<float> x_rk, y_rk;
     CalcVectRank(x_rk, x);
     CalcVectRank(y_rk, y);
     const double spearman_corr = CalcPearsonCorr(x_rk, y_rk);
@@ -258,16 +371,54 @@ const double CalcSpearmanDist(const std::vector<float> &x, const std::vector<flo
     return (0.5 * (1 - CalcSpearmanCorr(x, y)));
 }
 
+/** Spearman distance from rank vectors given by CalcRankVect, which can be computed once per count vector.
+ **/
+const double CalcSpearmanDistFromRanks(const std::vector<float> &x_rank, const std::vector<float> &y_rank)
+{
+    return CalcPearsonDist(x_rank, y_rank);
+}
+
+/** Sum of |x - y| / (x + y) over [i_start, n), without branch: a zero difference is divided by 1 instead of x + y.
+ **/
+inline const double AddMACSum(const float *x, const float *y, const size_t i_start, const size_t n, double ctrst)
+{
+    for (size_t i(i_start); i < n; ++i)
+    {
+        const double diff = static_cast<double>(x[i] - y[i]), sum = static_cast<double>(x[i] + y[i]);
+        ctrst += fabs(diff) / (diff == 0 ? 1 : sum);
+    }
+    return ctrst;
+}
+
+#ifdef KAMRAT_AVX2_KERNELS
+__attribute__((target("avx2,fma"))) const double CalcMACSumAVX2(const float *x, const float *y, const size_t n)
+{
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1), sign_mask = _mm256_set1_pd(-0.0);
+    __m256d ctrst = _mm256_setzero_pd();
+    size_t i(0);
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128 xi = _mm_loadu_ps(x + i), yi = _mm_loadu_ps(y + i);
+        const __m256d diff = _mm256_cvtps_pd(_mm_sub_ps(xi, yi)), sum = _mm256_cvtps_pd(_mm_add_ps(xi, yi));
+        const __m256d denom = _mm256_blendv_pd(sum, one, _mm256_cmp_pd(diff, zero, _CMP_EQ_OQ));
+        ctrst = _mm256_add_pd(ctrst, _mm256_div_pd(_mm256_andnot_pd(sign_mask, diff), denom));
+    }
+    return AddMACSum(x, y, i, n, HorizontalSum(ctrst));
+}
+#endif
+
+const double CalcMACDist_scalar(const std::vector<float> &x, const std::vector<float> &y)
+{
+    return (AddMACSum(x.data(), y.data(), 0, x.size(), 0.0) / x.size());
+}
+
 const double CalcMACDist(const std::vector<float> &x, const std::vector<float> &y)
 {
-    const size_t nb_sample(x.size());
-    double ctrst = 0.0;
-    for (size_t i(0); i < nb_sample; ++i)
+#ifdef KAMRAT_AVX2_KERNELS
+    if (HasAVX2Kernels())
     {
-        if (x[i] != y[i]) // if x[i] == y[i], then ctrst += 0.0
-        {
-            ctrst += fabs(static_cast<double>(x[i] - y[i]) / (x[i] + y[i]));
-        }
+        return (CalcMACSumAVX2(x.data(), y.data(), x.size()) / x.size());
     }
-    return (ctrst / nb_sample);
+#endif
+    return CalcMACDist_scalar(x, y);
 }
@@ -9,6 +9,8 @@ const double CalcPearsonDist(const std::vector<float> &x, const std::vector<floa
 const double CalcSpearmanCorr(const std::vector<float> &x, const std::vector<float> &y);
 const double CalcSpearmanCorr_old(const std::vector<float> &x, const std::vector<float> &y);
 const double CalcSpearmanDist(const std::vector<float> &x, const std::vector<float> &y);
+const void CalcRankVect(const std::vector<float> &vec, std::vector<float> &rank);
+const double CalcSpearmanDistFromRanks(const std::vector<float> &x_rank, const std::vector<float> &y_rank);
 
 const double CalcMACDist(const std::vector<float> &x, const std::vector<float> &y);
 
@@ -17,6 +19,9 @@ const double CalcMACDist(const std::vector<float> &x, const std::vector<float> &
 
 const void getOrder(const std::vector<float> &vec, std::vector<uint> &order);
 const void orderToRank(const std::vector<float> &vec, const std::vector<uint> & order, std::vector<float> &rank);
+const bool HasAVX2Kernels();
+const double CalcPearsonCorr_scalar(const std::vector<float> &x, const std::vector<float> &y);
+const double CalcMACDist_scalar(const std::vector<float> &x, const std::vector<float> &y);
 
 // --- Basic stats ---
 
@@ -24,4 +29,8 @@ const void dual_mean_stddev(const std::vector<float> &vect, const std::vector<si
 const void mean_stddev_min(const std::vector<float> &vect, double &mean, double &stddev, double &min);
 const void mean_stddev(const std::vector<float> &vect, double &mean, double &stddev);
 
+// --- Transformations ---
+
+const void log2p1(const std::vector<float> &vect, std::vector<double> &log_vect);
+
 #endif
\ No newline at end of file
@@ -1,8 +1,11 @@
 import unittest
 from os import path, mkdir, listdir
 import os
+import gzip
 from shutil import rmtree
 import subprocess
+import socket
+import time
 
 
 kamrat = path.join(".", "bin", "kamrat")
@@ -61,6 +64,81 @@ class TestCommands(unittest.TestCase):
         rmtree(test_dir)
 
 
+    def test_index_non_acgt(self):
+        test_dir = "index_acgt_tmp_test"
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # A k-mer with a non-ACGT base is rejected, with its sequence in the error
+        bad_tab = path.join(test_dir, "bad-kmer.tsv")
+        with open(bad_tab, "w") as tab_out:
+            tab_out.write("tag\tsmp1\tsmp2\n")
+            tab_out.write("ACGTACGTACGTACGTACGTACGTACGTACG\t1\t2\n")
+            tab_out.write("ACGTACGTACGTACGTNCGTACGTACGTACG\t3\t4\n")
+        outdir = path.join(test_dir, "kamrat.idx")
+        mkdir(outdir)
+        cmd = f"{kamrat} index -intab {bad_tab} -outdir {outdir} -klen 31 -unstrand"
+        process = subprocess.run(cmd.split(" "), capture_output=True, text=True)
+        self.assertNotEqual(0, process.returncode)
+        self.assertTrue("ACGTACGTACGTACGTNCGTACGTACGTACG" in process.stderr)
+
+        rmtree(test_dir)
+
+    def test_index_logcache(self):
+        test_dir = "index_logcache_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index with the log-transformed count cache
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        idx_log = path.join(idx_dir, "idx-log.bin")
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand -nfbase 1000000 -logcache"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        self.assertTrue(path.exists(idx_log))
+
+        # T-test scores from idx-log.bin are those from the counts in idx-mat.bin
+        design = path.join(data, "sample-states.toy.tsv")
+        for score_mthd in ["ttest.padj", "ttest.pi"]:
+            score_tab = {}
+            for with_log in [True, False]:
+                if not with_log:
+                    os.rename(idx_log, idx_log + ".away")
+                score_tab[with_log] = path.join(test_dir, f"{score_mthd}-{with_log}.tsv")
+                cmd = f"{kamrat} score -idxdir {idx_dir} -scoreby {score_mthd} -design {design} -withcounts -outpath {score_tab[with_log]}"
+                process = subprocess.run(cmd.split(" "), capture_output=True, text=True)
+                self.assertEqual(0, process.returncode)
+                self.assertEqual(with_log, "log-transformed count cache found" in process.stderr)
+                if not with_log:
+                    os.rename(idx_log + ".away", idx_log)
+            with open(score_tab[True]) as f:
+                rows_log = [line.rstrip("\n").split("\t") for line in f]
+            with open(score_tab[False]) as f:
+                rows_mat = [line.rstrip("\n").split("\t") for line in f]
+            self.assertEqual(len(rows_mat), len(rows_log))
+            self.assertEqual(rows_mat[0], rows_log[0])
+            for row_log, row_mat in zip(rows_log[1:], rows_mat[1:]):
+                self.assertEqual(row_mat[0], row_log[0])
+                self.assertAlmostEqual(float(row_mat[1]), float(row_log[1]), delta=1e-4 * (1 + abs(float(row_mat[1]))))
+                self.assertEqual(row_mat[2:], row_log[2:])
+
+        # Re-indexing without -logcache removes the stale cache
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand -nfbase 1000000"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        self.assertFalse(path.exists(idx_log))
+
+        rmtree(test_dir)
+
     def test_filter(self):
         test_dir = "filter_tmp_test"
         data = path.join("toyroom", "data")
@@ -104,6 +182,14 @@ class TestCommands(unittest.TestCase):
         self.assertTrue(stream.read().startswith("6e43e7e58362415a1e252c98f5b8dd7b"))
         stream.close()
 
+        # Filter with threads, output in the same order
+        filtered_mt = path.join(test_dir, "top-kmers.nthread.bin")
+        cmd = f"{kamrat} filter -idxdir {idx_dir} -design {conditions} -upmin 5:5 -downmax 0:10 -nthread 3 -outpath {filtered_mt}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        with open(filtered, "rb") as f1, open(filtered_mt, "rb") as f2:
+            self.assertEqual(f1.read(), f2.read())
+
         rmtree(test_dir)
 
     def test_merge(self):
@@ -165,6 +251,54 @@ class TestCommands(unittest.TestCase):
 
         rmtree(test_dir)
 
+    def test_merge_bucket(self):
+        test_dir = "merge_bucket_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand -nfbase 1000000"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Score k-mers, for merging with representative values
+        scored = path.join(test_dir, "scored.bin")
+        cmd = f"{kamrat} score -idxdir {idx_dir} -scoreby sd -seltop 2000 -outpath {scored}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Merging out of core gives the output of merging in memory, whatever the numbers of buckets and threads
+        bucket_dir = path.join(test_dir, "buckets")
+        mkdir(bucket_dir)
+        for merge_opt in ["-overlap 30-15 -interv none", "-interv pearson:0.4 -withcounts mean",
+                          "-overlap 20-10 -interv spearman:0.3 -withcounts rep", f"-with {scored}:max -withcounts median"]:
+            in_memory = path.join(test_dir, "in-memory.tsv")
+            cmd = f"{kamrat} merge -idxdir {idx_dir} {merge_opt} -nbucket 0 -outpath {in_memory}"
+            process = subprocess.run(cmd.split(" "), capture_output=True)
+            self.assertEqual(0, process.returncode)
+            with open(in_memory, "rb") as f:
+                expected = f.read()
+            self.assertTrue(len(expected) > 0)
+            for nb_bucket in [1, 7]:
+                for nb_thread in [1, 4]:
+                    out_of_core = path.join(test_dir, f"out-of-core.{nb_bucket}.{nb_thread}.tsv")
+                    cmd = (f"{kamrat} merge -idxdir {idx_dir} {merge_opt} -nbucket {nb_bucket} -maxmem 1 -tmpdir {bucket_dir} "
+                           f"-nthread {nb_thread} -outpath {out_of_core}")
+                    process = subprocess.run(cmd.split(" "), capture_output=True)
+                    self.assertEqual(0, process.returncode)
+                    with open(out_of_core, "rb") as f:
+                        self.assertEqual(expected, f.read(), cmd)
+                    self.assertEqual([], listdir(bucket_dir))
+
+        rmtree(test_dir)
+
 
     def test_rank(self):
         test_dir = "filter_tmp_test"
@@ -206,5 +340,443 @@ class TestCommands(unittest.TestCase):
 
         rmtree(test_dir)
 
+    def test_score_with(self):
+        test_dir = "score_with_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand -nfbase 1000000"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Filter
+        design = path.join(data, "sample-states.toy.tsv")
+        expr = "nb(tumor >= 1) >= 3 AND nb(normal <= 0) >= 5"
+        filtered = path.join(test_dir, "top-kmers.bin")
+        cmd = [kamrat, "filter", "-idxdir", idx_dir, "-design", design, "-expr", expr, "-outpath", filtered]
+        process = subprocess.run(cmd, capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Score the filtered k-mers, as intermediate file or as table
+        nb_sel = 50
+        scored = path.join(test_dir, "scored.bin")
+        cmd = f"{kamrat} score -idxdir {idx_dir} -with {filtered} -scoreby sd -seltop {nb_sel} -outpath {scored}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        scored_tab = path.join(test_dir, "scored.tsv")
+        cmd = f"{kamrat} score -idxdir {idx_dir} -with {filtered} -scoreby sd -seltop {nb_sel} -withcounts -outpath {scored_tab}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Intermediate rows: feature, score and number of merged k-mers tab-separated, then an 8-byte position and a newline
+        with open(scored, "rb") as f:
+            inter = f.read()
+        inter_ft = []
+        i = 0
+        while i < len(inter):
+            fields = []
+            for _ in range(3):
+                j = inter.index(b"\t", i)
+                fields.append(inter[i:j].decode())
+                i = j + 1
+            self.assertEqual(b"\n", inter[i + 8:i + 9])
+            i += 9
+            inter_ft.append(fields[0])
+        with open(scored_tab) as f:
+            tab_ft = [line.split("\t")[0] for line in f.readlines()[1:]]
+        self.assertEqual(nb_sel, len(inter_ft))
+        self.assertEqual(sorted(tab_ft), sorted(inter_ft))
+
+        # The intermediate file is taken by merge
+        merged = path.join(test_dir, "merged.tsv")
+        cmd = f"{kamrat} merge -idxdir {idx_dir} -overlap 30-15 -with {scored}:max -withcounts mean -outpath {merged}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        rmtree(test_dir)
+
+    def test_score_intab(self):
+        test_dir = "intab_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Scoring the table directly selects the same rows with the same scores as scoring its index,
+        # with a fractional and an absolute selection
+        design = path.join(data, "sample-states.toy.tsv")
+        scored_idx = path.join(test_dir, "scored-idx.tsv")
+        scored_tab = path.join(test_dir, "scored-tab.tsv")
+        for score_by, sel_top in [("ttest.padj", "0.1"), ("snr", "100")]:
+            cmd = f"{kamrat} score -idxdir {idx_dir} -scoreby {score_by} -design {design} -seltop {sel_top} -withcounts -outpath {scored_idx}"
+            process = subprocess.run(cmd.split(" "), capture_output=True)
+            self.assertEqual(0, process.returncode)
+            cmd = f"{kamrat} score -intab {intab} -scoreby {score_by} -design {design} -seltop {sel_top} -outpath {scored_tab}"
+            process = subprocess.run(cmd.split(" "), capture_output=True)
+            self.assertEqual(0, process.returncode)
+
+            with open(scored_idx) as f1, open(scored_tab) as f2:
+                idx_lines, tab_lines = f1.readlines(), f2.readlines()
+            self.assertEqual(idx_lines[0], tab_lines[0])
+            self.assertEqual(len(idx_lines), len(tab_lines))
+            # rows tied with the last selected one may differ
+            last_score = idx_lines[-1].split("\t")[1]
+            self.assertEqual(last_score, tab_lines[-1].split("\t")[1])
+            self.assertEqual(sorted(line for line in idx_lines[1:] if line.split("\t")[1] != last_score),
+                             sorted(line for line in tab_lines[1:] if line.split("\t")[1] != last_score))
+
+        rmtree(test_dir)
+
+    def test_cvfold(self):
+        test_dir = "cvfold_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Two folds, alternating samples of the design file
+        fold_label = dict()
+        with open(path.join(data, "sample-states.toy.tsv")) as dsgn_in:
+            for i, line in enumerate(dsgn_in):
+                fold_label[line.split()[0]] = ("odd" if i % 2 == 0 else "even")
+        folds = path.join(test_dir, "folds.tsv")
+        with open(folds, "w") as fold_out:
+            for smp, label in fold_label.items():
+                fold_out.write(f"{smp}\t{label}\n")
+
+        # Training samples of fold "odd", as a count table
+        train_tab = path.join(test_dir, "train-odd.tsv")
+        with gzip.open(intab, "rt") as tab_in, open(train_tab, "w") as tab_out:
+            for line in tab_in:
+                terms = line.split()
+                if line.startswith("tag"):
+                    kept = [0] + [i for i in range(1, len(terms)) if fold_label[terms[i]] == "even"]
+                tab_out.write("\t".join(terms[i] for i in kept) + "\n")
+
+        # Scores of a fold are those of its training samples
+        scored = path.join(test_dir, "scored.tsv")
+        cmd = f"{kamrat} score -idxdir {idx_dir} -scoreby sd -cvfold {folds} -seltop 50 -withcounts -outpath {scored}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        self.assertTrue(path.exists(scored + ".odd") and path.exists(scored + ".even"))
+        scored_tab = path.join(test_dir, "scored-tab.tsv")
+        cmd = f"{kamrat} score -intab {train_tab} -scoreby sd -seltop 50 -outpath {scored_tab}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(scored + ".odd") as f1, open(scored_tab) as f2:
+            fold_res = sorted(tuple(line.split()[:2]) for line in f1.readlines()[1:])
+            tab_res = sorted(tuple(line.split()[:2]) for line in f2.readlines()[1:])
+        self.assertEqual(50, len(fold_res))
+        self.assertEqual(fold_res, tab_res)
+
+        # A sample left out of the fold file is an error
+        with open(folds, "w") as fold_out:
+            for smp, label in list(fold_label.items())[1:]:
+                fold_out.write(f"{smp}\t{label}\n")
+        cmd =f"{kamrat} score -idxdir {idx_dir} -scoreby sd -cvfold {folds} -outpath {scored}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertNotEqual(0, process.returncode)
+
+        rmtree(test_dir)
+
+    def test_query(self):
+        test_dir = "query_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # The same sequences as fasta and as gzipped fastq give the same rows
+        fasta = path.join(data, "sequence.toy.fa")
+        fastq = path.join(test_dir, "sequence.toy.fq.gz")
+        with open(fasta) as fa_in, gzip.open(fastq, "wt") as fq_out:
+            name, seq = None, ""
+            for line in list(fa_in) + [">"]:
+                line = line.strip()
+                if line.startswith(">"):
+                    if name is not None:
+                        fq_out.write(f"@{name}\n{seq}\n+\n{'I' * len(seq)}\n")
+                    name, seq = line[1:], ""
+                else:
+                    seq += line
+        queried_fa = path.join(test_dir, "query-fa.tsv")
+        queried_fq = path.join(test_dir, "query-fq.tsv")
+        for seq_path, queried in [(fasta, queried_fa), (fastq, queried_fq)]:
+            cmd = f"{kamrat} query -idxdir {idx_dir} -fasta {seq_path} -toquery mean -withabsent -outpath {queried}"
+            process = subprocess.run(cmd.split(" "), capture_output=True)
+            self.assertEqual(0, process.returncode)
+        with open(queried_fa) as f1, open(queried_fq) as f2:
+            self.assertEqual(f1.read(), f2.read())
+
+        # Profile of a read made of two indexed k-mers joined by an N
+        with gzip.open(intab, "rt") as tab_in:
+            tab_in.readline()
+            row1, row2 = tab_in.readline().split(), tab_in.readline().split()
+        kmer1, kmer2 = row1[0], row2[0]
+        read_fa = path.join(test_dir, "read.fa")
+        with open(read_fa, "w") as fa_out:
+            fa_out.write(f">read1 two k-mers\n{kmer1}N{kmer2}\n")
+        profiled = path.join(test_dir, "profile.tsv")
+        cmd = f"{kamrat} query -idxdir {idx_dir} -fasta {read_fa} -toquery mean -profile -outpath {profiled}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        with open(profiled) as prof_in:
+            header, row = prof_in.readline().split("\t"), prof_in.readline().split("\t")
+        self.assertEqual(["read", "nb-kmer", "nb-hit", "coverage"], header[:4])
+        self.assertEqual(["read1", "2", "2", "0.984127"], row[:4]) # 62 of 63 bases covered
+        for x, c1, c2 in zip(row[4:], row1[1:], row2[1:]):
+            self.assertAlmostEqual((float(c1) + float(c2)) / 2, float(x), places=3)
+
+        rmtree(test_dir)
+
+    def test_serve(self):
+        test_dir = "serve_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Define inputs and outputs for index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        index_stdout = path.join(test_dir, "index.stdout")
+
+        # Index
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand"
+        process = None
+        with open(index_stdout, "w") as idx_out:
+            process = subprocess.run(cmd.split(" "), stdout=idx_out, stderr=idx_out)
+        self.assertEqual(0, process.returncode)
+
+        # Define query i/o
+        fasta = path.join(data, "sequence.toy.fa")
+        queried = path.join(test_dir, "query-counts.tsv")
+        query_stdout = path.join(test_dir, "query.stdout")
+
+        # Query
+        cmd = f"{kamrat} query -idxdir {idx_dir} -fasta {fasta} -toquery median -withabsent -outpath {queried}"
+        with open(query_stdout, "w") as qr_out:
+            process = subprocess.run(cmd.split(" "), stdout=qr_out, stderr=qr_out)
+        self.assertEqual(0, process.returncode)
+
+        # Serve two batches from standard input, each answered as by query
+        with open(fasta) as fa_in:
+            batch = fa_in.read()
+        cmd = f"{kamrat} serve -idxdir {idx_dir} -toquery median -withabsent"
+        process = subprocess.run(cmd.split(" "), input=batch + "//\n" + batch, capture_output=True, text=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(queried) as qr_in:
+            expected = qr_in.read() + "//\n"
+        self.assertEqual(expected + expected, process.stdout)
+
+        # Per-read profiles, as by query
+        cmd = f"{kamrat} query -idxdir {idx_dir} -fasta {fasta} -toquery median -profile -outpath {queried}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = f"{kamrat} serve -idxdir {idx_dir} -toquery median -profile"
+        process = subprocess.run(cmd.split(" "), input=batch, capture_output=True, text=True)
+        self.assertEqual(0, process.returncode)
+        with open(queried) as qr_in:
+            self.assertEqual(qr_in.read() + "//\n", process.stdout)
+
+        # Two clients connected at the same time to a socket, each sending two batches
+        sock_path = path.abspath(path.join(test_dir, "kamrat.sock"))
+        cmd = f"{kamrat} serve -idxdir {idx_dir} -toquery median -withabsent -socket {sock_path} -nthread 2"
+        server = subprocess.Popen(cmd.split(" "), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            for _ in range(100):
+                if path.exists(sock_path):
+                    break
+                time.sleep(0.1)
+            clients = [socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) for _ in range(2)]
+            for client in clients:
+                client.settimeout(30) # a client left waiting would mean connections are not served concurrently
+                client.connect(sock_path)
+            answers = [b"", b""]
+            for nb_batch in [1, 2]: # both clients wait for their answer before sending the next batch
+                for client in clients:
+                    client.sendall((batch + "//\n").encode())
+                for i, client in enumerate(clients):
+                    while answers[i].count(b"//\n") < nb_batch:
+                        data = client.recv(1 << 16)
+                        self.assertTrue(data)
+                        answers[i] += data
+            for client in clients:
+                client.close()
+        finally:
+            server.terminate()
+            server.wait()
+        for answer in answers:
+            self.assertEqual(expected + expected, answer.decode())
+        self.assertFalse(path.exists(sock_path))
+
+        rmtree(test_dir)
+
+    def test_mask_build(self):
+        test_dir = "maskbuild_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Mask from the fasta file
+        fasta = path.join(data, "sequence.toy.fa")
+        masked = path.join(test_dir, "masked-counts.tsv")
+        cmd = f"{kamrat} mask -idxdir {idx_dir} -fasta {fasta} -withcounts -outpath {masked}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Build the mask index, then mask with it
+        mask_idx = path.join(test_dir, "mask.bin")
+        cmd = f"{kamrat} mask-build -fasta {fasta} -klen 31 -unstrand -outpath {mask_idx}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        masked_idx = path.join(test_dir, "masked-counts.maskidx.tsv")
+        cmd = f"{kamrat} mask -idxdir {idx_dir} -maskidx {mask_idx} -withcounts -outpath {masked_idx}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(masked) as f1, open(masked_idx) as f2:
+            self.assertEqual(f1.read(), f2.read())
+
+        # A mask index of another strandedness is rejected
+        cmd = f"{kamrat} mask-build -fasta {fasta} -klen 31 -outpath {mask_idx}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = f"{kamrat} mask -idxdir {idx_dir} -maskidx {mask_idx} -outpath {masked_idx}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertNotEqual(0, process.returncode)
+
+        rmtree(test_dir)
+
+    def test_pipeline(self):
+        test_dir = "pipeline_tmp_test"
+        data = path.join("toyroom", "data")
+
+        # Remove previous test remainings
+        if path.exists(test_dir):
+            rmtree(test_dir)
+        mkdir(test_dir)
+
+        # Index
+        intab = path.join(data, "kmer-counts.subset4toy.tsv.gz")
+        idx_dir = path.join(test_dir, "kamrat.idx")
+        mkdir(idx_dir)
+        cmd = f"{kamrat} index -intab {intab} -outdir {idx_dir} -klen 31 -unstrand -nfbase 1000000"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        # Filter then merge through an intermediate file, or in a single pipeline
+        design = path.join(data, "sample-states.toy.tsv")
+        expr = "nb(tumor >= 1) >= 3 AND nb(normal <= 0) >= 5"
+        filtered = path.join(test_dir, "top-kmers.bin")
+        cmd = [kamrat, "filter", "-idxdir", idx_dir, "-design", design, "-expr", expr, "-outpath", filtered]
+        process = subprocess.run(cmd, capture_output=True)
+        self.assertEqual(0, process.returncode)
+        merged = path.join(test_dir, "merged.tsv")
+        cmd = f"{kamrat} merge -idxdir {idx_dir} -overlap 30-15 -with {filtered}:min -withcounts mean -outpath {merged}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        piped = path.join(test_dir, "piped.tsv")
+        cmd = [kamrat, "pipeline", "-idxdir", idx_dir, "-design", design, "-expr", expr, "-overlap", "30-15",
+               "-nthread", "2", "-withcounts", "mean", "-outpath", piped]
+        process = subprocess.run(cmd, capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(merged) as f1, open(piped) as f2:
+            self.assertEqual(f1.read(), f2.read())
+
+        # Mask then merge, the same way
+        fasta = path.join(data, "sequence.toy.fa")
+        masked = path.join(test_dir, "masked.bin")
+        cmd = f"{kamrat} mask -idxdir {idx_dir} -fasta {fasta} -outpath {masked}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = f"{kamrat} merge -idxdir {idx_dir} -with {masked} -withcounts rep -outpath {merged}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = f"{kamrat} pipeline -idxdir {idx_dir} -fasta {fasta} -withcounts rep -outpath {piped}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(merged) as f1, open(piped) as f2:
+            self.assertEqual(f1.read(), f2.read())
+
+        # Filter, score with BH-adjusted p-values and keep the top k-mers, then merge, the same way
+        scored = path.join(test_dir, "scored.bin")
+        cmd = f"{kamrat} score -idxdir {idx_dir} -with {filtered} -scoreby ttest.padj -design {design} -seltop 300 -outpath {scored}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = f"{kamrat} merge -idxdir {idx_dir} -overlap 30-15 -with {scored}:min -withcounts mean -outpath {merged}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertEqual(0, process.returncode)
+        cmd = [kamrat, "pipeline", "-idxdir", idx_dir, "-design", design, "-expr", expr, "-scoreby", "ttest.padj", "-seltop", "300",
+               "-overlap", "30-15", "-repmode", "min", "-nthread", "2", "-withcounts", "mean", "-outpath", piped]
+        process = subprocess.run(cmd, capture_output=True)
+        self.assertEqual(0, process.returncode)
+
+        with open(merged) as f1, open(piped) as f2:
+            self.assertEqual(f1.read(), f2.read())
+
+        # Scored k-mers cannot be output as intermediate
+        cmd = f"{kamrat} pipeline -idxdir {idx_dir} -scoreby sd -outpath {piped}"
+        process = subprocess.run(cmd.split(" "), capture_output=True)
+        self.assertNotEqual(0, process.returncode)
+
+        rmtree(test_dir)
+
 if __name__ == '__main__':
   unittest.main()
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "lest.hpp"
+#include "contig_store.hpp"
+#include "seq_coding.hpp" // uint128_t
+
+using namespace std;
+
+static string RevComp(const string &seq)
+{
+    string rc(seq.rbegin(), seq.rend());
+    for (char &c : rc) {
+        c = (c == 'A' ? 'T' : c == 'C' ? 'G' : c == 'G' ? 'C' : 'A');
+    }
+    return rc;
+}
+
+template <typename code_t>
+static code_t RefCode(const string &seq)
+{
+    code_t code = 0;
+    for (const char c : seq) {
+        code = (code << 2) | string("ACGT").find(c);
+    }
+    return code;
+}
+
+static string RandSeq(const size_t len)
+{
+    string seq;
+    for (size_t i=0 ; i<len ; i++) {
+        seq += "ACGT"[rand() % 4];
+    }
+    return seq;
+}
+
+
+
+const lest::test module[] =
+{
+    CASE( "test ContigStore packed extension (vs std::string)" )
+    {
+        cout << "ContigStore extension verification" << endl;
+        srand(time(NULL));
+        const size_t nb_ctg = 20;
+        ContigStore ctg_store(31);
+        vector<string> ref_vect;
+        vector<size_t> head_vect, rear_vect, nb_mem_vect(nb_ctg, 1);
+        for (uint i=0 ; i<nb_ctg ; i++) {
+            ref_vect.push_back(RandSeq(31));
+            ctg_store.AddContig(ref_vect[i], i, 0);
+            head_vect.push_back(i);
+            rear_vect.push_back(i);
+        }
+        for (uint j=0 ; j<2000 ; j++) { // contigs extended in turn, for their rooms in the slab to be interleaved
+            const size_t i_ctg = rand() % nb_ctg, n_ovlp = 15 + rand() % 16;
+            const bool need_rc = rand() % 2;
+            string &ref = ref_vect[i_ctg], added = RandSeq(1 + rand() % 40);
+            const size_t serial = ctg_store.GetNbSerial();
+            if (rand() % 3 == 0) {
+                ctg_store.ReverseComplement(i_ctg);
+                ref = RevComp(ref);
+                swap(head_vect[i_ctg], rear_vect[i_ctg]);
+            } else if (rand() % 2 == 0) {
+                string right = ref.substr(ref.size() - n_ovlp) + added;
+                ctg_store.AddContig(need_rc ? RevComp(right) : right, serial, 0);
+                ctg_store.RightExtend(i_ctg, serial, need_rc, n_ovlp);
+                ref += added;
+                rear_vect[i_ctg] = serial;
+                ++nb_mem_vect[i_ctg];
+            } else {
+                string left = added + ref.substr(0, n_ovlp);
+                ctg_store.AddContig(need_rc ? RevComp(left) : left, serial, 0);
+                ctg_store.LeftExtend(i_ctg, serial, need_rc, n_ovlp);
+                ref = added + ref;
+                head_vect[i_ctg] = serial;
+                ++nb_mem_vect[i_ctg];
+            }
+            EXPECT( ctg_store.GetSeq(i_ctg) == ref );
+            EXPECT( ctg_store.GetHeadPos(i_ctg, false) == head_vect[i_ctg] );
+            EXPECT( ctg_store.GetRearPos(i_ctg, true) == head_vect[i_ctg] );
+            EXPECT( ctg_store.GetRearPos(i_ctg, false) == rear_vect[i_ctg] );
+            EXPECT( ctg_store.GetNbMemKmer(i_ctg) == nb_mem_vect[i_ctg] );
+            const size_t n_fix = min<size_t>(ref.size(), 1 + rand() % 64);
+            EXPECT( ctg_store.GetPrefixCode<uint128_t>(i_ctg, n_fix) == RefCode<uint128_t>(ref.substr(0, n_fix)) );
+            EXPECT( ctg_store.GetSuffixCode<uint128_t>(i_ctg, n_fix) == RefCode<uint128_t>(ref.substr(ref.size() - n_fix)) );
+            if (serial < ctg_store.GetNbSerial()) {
+                EXPECT( ctg_store.GetContig(serial) == i_ctg );
+            }
+        }
+        ctg_store.Compact();
+        EXPECT( ctg_store.GetContigList().size() == nb_ctg );
+        vector<size_t> mem_pos_vect;
+        for (uint i=0 ; i<nb_ctg ; i++) {
+            const string &ref = ref_vect[i];
+            EXPECT( ctg_store.GetContigList()[i] == i );
+            EXPECT( ctg_store.GetSeq(i) == ref );
+            EXPECT( ctg_store.GetRepPos(i) == i );
+            EXPECT( ctg_store.GetMemPosVect(mem_pos_vect, i).size() == nb_mem_vect[i] );
+            EXPECT( mem_pos_vect[0] == i );
+            for (const size_t n_fix : {1, 17, 31}) {
+                EXPECT( ctg_store.GetPrefixCode(i, n_fix) == RefCode<uint64_t>(ref.substr(0, n_fix)) );
+                EXPECT( ctg_store.GetSuffixCode(i, n_fix) == RefCode<uint64_t>(ref.substr(ref.size() - n_fix)) );
+            }
+        }
+        EXPECT_THROWS( ctg_store.AddContig("ACGTN", 0, 0) );
+        cout << "   ok" << endl;
+    },
+
+    CASE( "test ContigStore values and sequence lengths" )
+    {
+        ContigStore ctg_store(5);
+        ctg_store.AddContig("ACGTA", 0, 0);
+        ctg_store.AddContig("CGTACGTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTG", 10, 0); // other length, in a record at once
+        ctg_store.AddContig("GTACA", 20, 2.5);
+        EXPECT( ctg_store.GetRepVal(0) == 0 );
+        EXPECT( ctg_store.GetRepVal(2) == 2.5 );
+        EXPECT( ctg_store.GetSeqLen(1) == 39 );
+        EXPECT( ctg_store.GetSuffixCode<uint128_t>(1, 33) == RefCode<uint128_t>("TTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTG") );
+        ctg_store.RightExtend(0, 1, false, 4);
+        ctg_store.LeftExtend(0, 2, true, 3); // TGTAC reversed
+        EXPECT( ctg_store.GetSeq(0) == "TGACGTACGTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTG" );
+        EXPECT( ctg_store.GetHeadPos(0, false) == 20 );
+        EXPECT( ctg_store.GetRearPos(0, false) == 10 );
+        EXPECT( ctg_store.GetNbMemKmer(0) == 3 );
+        ctg_store.Compact();
+        EXPECT( ctg_store.GetContigList().size() == 1 );
+        EXPECT( ctg_store.GetPrefixCode(0, 4) == RefCode<uint64_t>("TGAC") );
+    },
+
+    CASE( "test ContigStore first value" )
+    {
+        ContigStore ctg_store(5);
+        ctg_store.AddContig("ACGTA", 0, 1.5); // values become non-zero from the first contig
+        ctg_store.AddContig("CGTAC", 10, 0);
+        EXPECT( ctg_store.GetRepVal(0) == 1.5 );
+        EXPECT( ctg_store.GetRepVal(1) == 0 );
+    },
+
+    CASE( "test SerialVect 40-bit serials" )
+    {
+        const uint64_t no_serial = SerialVect::kNoSerial; // copied, as the class constant has no out-of-class definition
+        SerialVect serial_vect(3);
+        EXPECT( serial_vect[0] == no_serial );
+        serial_vect.set(1, (1ULL << 32) + 5);
+        serial_vect.push_back(no_serial - 1);
+        EXPECT( serial_vect.size() == 4 );
+        EXPECT( serial_vect[1] == (1ULL << 32) + 5 );
+        EXPECT( serial_vect[2] == no_serial );
+        EXPECT( serial_vect[3] == no_serial - 1 );
+        uint64_t sum = 0;
+        for (const uint64_t serial : serial_vect) {
+            sum += (serial == no_serial ? 0 : serial);
+        }
+        EXPECT( sum == (1ULL << 32) + 5 + no_serial - 1 );
+    }
+};
+
+
+extern lest::tests & specification();
+
+MODULE( specification(), module )
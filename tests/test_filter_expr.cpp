@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "lest.hpp"
+#include "filter_expr.hpp"
+
+using namespace std;
+
+static double Median(vector<float> val_vect)
+{
+    sort(val_vect.begin(), val_vect.end());
+    const size_t n = val_vect.size();
+    return (n % 2 == 1 ? val_vect[n / 2] : (static_cast<double>(val_vect[n / 2 - 1]) + val_vect[n / 2]) / 2);
+}
+
+
+
+const lest::test module[] =
+{
+    CASE( "test FilterExpr evaluation (vs direct computation)" )
+    {
+        cout << "Filter expression evaluation verification" << endl;
+        srand(time(NULL));
+        const size_t nb_smp = 10;
+        const map<string, vector<size_t>> group_map{{"tumor", {0, 2, 4, 6, 8}}, {"normal", {1, 3, 5, 7}}};
+        const FilterExpr expr1("nb(tumor >= 5) >= 3 AND mean(normal) < 2 AND frac(all > 0) >= 0.1", group_map, nb_smp);
+        const FilterExpr expr2("NOT (max(normal) > 3 or median(tumor) <= 4) || sum(all)==0", group_map, nb_smp);
+        const FilterExpr expr3("min(tumor) != 0 && !(nb(normal < 1) > 1)", group_map, nb_smp);
+        vector<float> count_vect(nb_smp);
+        for (size_t i_test(0); i_test < 2000; ++i_test)
+        {
+            for (float &x : count_vect)
+            {
+                x = (rand() % 3 == 0 ? 0 : rand() % 10);
+            }
+            vector<float> tumor, normal;
+            for (size_t i : group_map.at("tumor"))
+            {
+                tumor.push_back(count_vect[i]);
+            }
+            for (size_t i : group_map.at("normal"))
+            {
+                normal.push_back(count_vect[i]);
+            }
+            double normal_sum(0), all_sum(0);
+            size_t nb_tumor_ge5(0), nb_all_gt0(0), nb_normal_lt1(0);
+            for (float x : tumor)
+            {
+                nb_tumor_ge5 += (x >= 5);
+            }
+            for (float x : normal)
+            {
+                normal_sum += x;
+                nb_normal_lt1 += (x < 1);
+            }
+            for (float x : count_vect)
+            {
+                all_sum += x;
+                nb_all_gt0 += (x > 0);
+            }
+            const bool ref1 = (nb_tumor_ge5 >= 3 && normal_sum / normal.size() < 2 && static_cast<double>(nb_all_gt0) / nb_smp >= 0.1);
+            const bool ref2 = (!(*max_element(normal.cbegin(), normal.cend()) > 3 || Median(tumor) <= 4) || all_sum == 0);
+            const bool ref3 = (*min_element(tumor.cbegin(), tumor.cend()) != 0 && !(nb_normal_lt1 > 1));
+            EXPECT( expr1.Eval(count_vect.data()) == ref1 );
+            EXPECT( expr2.Eval(count_vect.data()) == ref2 );
+            EXPECT( expr3.Eval(count_vect.data()) == ref3 );
+        }
+        cout << "   ok" << endl;
+    },
+
+    CASE( "test FilterExpr parsing, ordering by cost and errors" )
+    {
+        cout << "Filter expression parsing verification" << endl;
+        const map<string, vector<size_t>> group_map{{"UP", {0, 1, 2, 3}}, {"DOWN", {4}}, {"empty", {}}};
+        EXPECT( FilterExpr("median(UP) > 1 AND nb(DOWN <= 2) >= 1 AND (mean(all) > 1 OR max(UP) < 3)", group_map, 6).GetStr() ==
+                "nb(DOWN <= 2) >= 1 AND (max(UP) < 3 OR mean(all) > 1) AND median(UP) > 1" );
+        EXPECT( FilterExpr("nb(empty >= 1) >= 0", group_map, 6).Eval(vector<float>(6, 0).data()) );
+        EXPECT_THROWS( FilterExpr("mean(empty) > 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("mean(unknown) > 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("avg(UP) > 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("mean(UP) => 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("(mean(UP) > 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("mean(UP) > 0 mean(DOWN) > 0", group_map, 6) );
+        EXPECT_THROWS( FilterExpr("nb(UP) > 0", group_map, 6) );
+        cout << "   ok" << endl;
+    },
+
+    CASE( "test FilterExpr with a sample listed twice in a group" )
+    {
+        cout << "Filter expression duplicated sample verification" << endl;
+        const map<string, vector<size_t>> dup_map{{"UP", {0, 1, 1, 1, 2}}}, ref_map{{"UP", {0, 1, 2}}};
+        const vector<string> expr_vect{"mean(UP) > 5", "median(UP) > 4", "frac(UP > 4) > 0.5", "nb(UP > 4) >= 2", "sum(UP) > 20"};
+        const vector<float> count_vect{2, 9, 3, 0};
+        for (const string &expr_str : expr_vect)
+        {
+            EXPECT( FilterExpr(expr_str, dup_map, 4).Eval(count_vect.data()) == FilterExpr(expr_str, ref_map, 4).Eval(count_vect.data()) );
+            EXPECT( !FilterExpr(expr_str, dup_map, 4).Eval(count_vect.data()) );
+        }
+        cout << "   ok" << endl;
+    }
+};
+
+
+extern lest::tests & specification();
+
+MODULE( specification(), module )
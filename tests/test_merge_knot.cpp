@@ -0,0 +1,123 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <unordered_map>
+
+#include "lest.hpp"
+#include "merge_knot.hpp"
+
+using namespace std;
+
+
+
+const lest::test module[] =
+{
+    CASE( "test MergeKnot packed roles" )
+    {
+        cout << "MergeKnot role verification" << endl;
+        MergeKnot knot;
+        EXPECT( !knot.HasPred() );
+        EXPECT( !knot.IsMergeable() );
+        knot.AddContig(MergeKnot::kMaxNbContig - 1, true, MergeKnot::kSucc);
+        knot.AddContig(5, false, MergeKnot::kPred);
+        EXPECT( knot.IsMergeable() );
+        EXPECT( knot.GetSerial(MergeKnot::kPred) == 5 );
+        EXPECT( knot.GetSerial(MergeKnot::kSucc) == MergeKnot::kMaxNbContig - 1 );
+        EXPECT( !knot.IsRC(MergeKnot::kPred) );
+        EXPECT( knot.IsRC(MergeKnot::kSucc) );
+        knot.AddContig(3, false, MergeKnot::kPred);
+        EXPECT( knot.HasAmbiguity() );
+        EXPECT( !knot.IsMergeable() );
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test MergeKnot serial boundary" )
+    {
+        cout << "MergeKnot largest serial verification" << endl;
+        EXPECT( MergeKnot::kMaxNbContig == (1ULL << 40) - 1 );
+        EXPECT( sizeof(MergeKnot) == 16 );
+        MergeKnot knot;
+        knot.AddContig(MergeKnot::kMaxNbContig - 1, true, MergeKnot::kPred);
+        knot.AddContig(MergeKnot::kMaxNbContig - 2, true, MergeKnot::kSucc);
+        EXPECT( knot.IsMergeable() );
+        EXPECT( !knot.HasAmbiguity() );
+        EXPECT( knot.GetSerial(MergeKnot::kPred) == MergeKnot::kMaxNbContig - 1 );
+        EXPECT( knot.GetSerial(MergeKnot::kSucc) == MergeKnot::kMaxNbContig - 2 );
+        EXPECT( knot.IsRC(MergeKnot::kPred) );
+        EXPECT( knot.IsRC(MergeKnot::kSucc) );
+
+        MergeKnot knot0;
+        knot0.AddContig(0, false, MergeKnot::kPred);
+        knot0.AddContig(MergeKnot::kMaxNbContig - 1, false, MergeKnot::kSucc);
+        EXPECT( knot0.IsMergeable() );
+        EXPECT( knot0.GetSerial(MergeKnot::kPred) == 0 );
+        EXPECT( knot0.GetSerial(MergeKnot::kSucc) == MergeKnot::kMaxNbContig - 1 );
+        EXPECT( !knot0.IsRC(MergeKnot::kPred) );
+        EXPECT( !knot0.IsRC(MergeKnot::kSucc) );
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test FixKnotMap (vs std::unordered_map)" )
+    {
+        cout << "FixKnotMap insertion, lookup and deletion verification" << endl;
+        srand(time(NULL));
+        FixKnotMap<> knot_map;
+        unordered_map<uint64_t, size_t> ref_map;
+        for (uint i=0 ; i<100000 ; i++) {
+            uint64_t fix = rand() % 2000;
+            if (i % 3 == 0 && ref_map.find(fix) == ref_map.end()) {
+                knot_map[fix].AddContig(fix % 1000, false, MergeKnot::kPred);
+                ref_map[fix] = fix % 1000;
+            } else if (i % 3 == 1 && ref_map.find(fix) != ref_map.end()) {
+                auto it = knot_map.find(fix);
+                EXPECT( it != knot_map.end() );
+                EXPECT( it->second.GetSerial(MergeKnot::kPred) == ref_map[fix] );
+                knot_map.erase(it);
+                ref_map.erase(fix);
+            } else {
+                EXPECT( (knot_map.find(fix) != knot_map.end()) == (ref_map.find(fix) != ref_map.end()) );
+            }
+        }
+        EXPECT( knot_map.size() == ref_map.size() );
+        size_t nb_knot = 0;
+        for (const auto &elem : knot_map) {
+            EXPECT( ref_map.find(elem.first) != ref_map.end() );
+            ++nb_knot;
+        }
+        EXPECT( nb_knot == ref_map.size() );
+        knot_map.clear();
+        EXPECT( knot_map.size() == 0 );
+        EXPECT( knot_map.begin() == knot_map.end() );
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test FixKnotMap with 128-bit fixes" )
+    {
+        cout << "FixKnotMap 128-bit fix verification" << endl;
+        FixKnotMap<uint128_t> knot_map;
+        const uint128_t high = static_cast<uint128_t>(1) << 100;
+        for (uint i=0 ; i<1000 ; i++) {
+            knot_map[high | i].AddContig(i, false, MergeKnot::kPred); // equal low words for fixes i and high | i
+            knot_map[i].AddContig(i, true, MergeKnot::kSucc);
+        }
+        EXPECT( knot_map.size() == 2000 );
+        for (uint i=0 ; i<1000 ; i+=2) {
+            knot_map.erase(knot_map.find(i));
+        }
+        for (uint i=0 ; i<1000 ; i++) {
+            auto it = knot_map.find(high | i);
+            EXPECT( it != knot_map.end() );
+            EXPECT( it->second.GetSerial(MergeKnot::kPred) == i );
+            EXPECT( (knot_map.find(i) != knot_map.end()) == (i % 2 == 1) );
+        }
+        cout << "   ok" << endl;
+    }
+};
+
+
+extern lest::tests & specification();
+
+MODULE( specification(), module )
\ No newline at end of file
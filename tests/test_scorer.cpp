@@ -76,6 +76,22 @@ const lest::test module[] =
             cout << "   ok" << endl;
         }
 
+        // Dids score with more than two conditions
+        SETUP( "DIDS score multi-class" ) {
+            cout << "DIDS score multi-class" << endl;
+            vector<string> multi_headers;
+            for (uint i=0 ; i<VECT_SIZE ; i++) {
+                multi_headers.push_back(to_string(i % 3));
+            }
+            // Create the scorer
+            Scorer scorer("dids", 0, multi_headers);
+
+            double res_old = scorer.EstimateScore_old(v);
+            double res_new = scorer.EstimateScore(v);
+            EXPECT( abs(res_old - res_new) < 1.0/pow(10, 10) );
+            cout << "   ok" << endl;
+        }
+
         // Standard dev
         SETUP( "Standard deviation" ) {
             cout << "Standard deviation" << endl;
@@ -136,6 +152,59 @@ const lest::test module[] =
             EXPECT( abs(res_old - res_new) < 1.0/pow(10, 2) );
             cout << "   ok" << endl;
         }
+    },
+
+    CASE( "lm block scores against per-feature F-test" ) {
+        srand(time(NULL));
+        const size_t nb_smp = 40, nb_ft = 25;
+
+        // Binary condition, one numeric and one 3-level categorical covariate
+        vector<string> headers;
+        vector<vector<string>> covars(2);
+        arma::Mat<double> design_full(nb_smp, 5, arma::fill::zeros);
+        for (size_t i = 0 ; i < nb_smp ; i++) {
+            headers.push_back(to_string(i % 2));
+            const double age = 20 + rand() % 50;
+            covars[0].push_back(to_string(static_cast<int>(age)));
+            covars[1].push_back(string("batch") + to_string(i % 3));
+            design_full(i, 0) = 1;
+            design_full(i, 1) = (i % 2 == 0 ? 1 : 0); // first seen condition against the second
+            design_full(i, 2) = age;
+            design_full(i, 3) = (i % 3 == 1 ? 1 : 0); // first seen batch as reference
+            design_full(i, 4) = (i % 3 == 2 ? 1 : 0);
+        }
+        const arma::Mat<double> design_red = arma::join_rows(design_full.col(0), design_full.cols(2, 4));
+
+        arma::Mat<double> block(nb_smp, nb_ft);
+        for (size_t j = 0 ; j < nb_ft ; j++) {
+            for (size_t i = 0 ; i < nb_smp ; i++) {
+                block(i, j) = rand() % 1000 + (i % 2 == 0 ? 10.0 * j : 0);
+            }
+        }
+
+        Scorer scorer("lm", 0, headers, covars);
+        vector<double> scores;
+        scorer.EstimateScoreBlock(scores, block);
+        EXPECT( scores.size() == nb_ft );
+
+        for (size_t j = 0 ; j < nb_ft ; j++) {
+            // Reference: fit full and reduced models, condition F statistic equals the squared t statistic
+            const arma::Col<double> y = arma::log2(block.col(j) + 1);
+            const arma::Col<double> beta_full = arma::solve(design_full, y),
+                                    beta_red = arma::solve(design_red, y);
+            const double rss_full = arma::accu(arma::square(y - design_full * beta_full)),
+                         rss_red = arma::accu(arma::square(y - design_red * beta_red)),
+                         f_stat = (rss_red - rss_full) / (rss_full / (nb_smp - 5));
+            EXPECT( abs(scores[j] * scores[j] - f_stat) < 1e-6 * (1 + f_stat) );
+            EXPECT( (scores[j] >= 0) == (beta_full[1] >= 0) );
+
+            // Single-column path goes through the same model
+            vector<float> count_vect(nb_smp);
+            for (size_t i = 0 ; i < nb_smp ; i++) {
+                count_vect[i] = static_cast<float>(block(i, j));
+            }
+            EXPECT( abs(scorer.EstimateScore(count_vect) - scores[j]) < 1e-6 * (1 + abs(scores[j])) );
+        }
     }
 };
 
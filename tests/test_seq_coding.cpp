@@ -0,0 +1,118 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <cstdint>
+
+#include "lest.hpp"
+#include "seq_coding.hpp"
+
+using namespace std;
+
+uint64_t GetRC_old(const uint64_t code, size_t k_length) // nucleotide-wise version
+{
+    uint64_t mask = (k_length == 32 ? ~(uint64_t)0 : ((uint64_t)1 << (2 * k_length)) - 1), tmp_code(code ^ mask), result(0);
+    for (size_t j = 0; j < k_length; ++j)
+    {
+        result = (result << 2) | ((tmp_code >> (2 * j)) & 3);
+    }
+    return result;
+}
+
+string RevComp(const string &seq)
+{
+    string rc;
+    for (auto it = seq.rbegin(); it != seq.rend(); ++it)
+    {
+        rc += (*it == 'A' ? 'T' : (*it == 'C' ? 'G' : (*it == 'G' ? 'C' : 'A')));
+    }
+    return rc;
+}
+
+string RandomSeq(size_t len, const string &alphabet)
+{
+    string seq;
+    for (size_t i = 0; i < len; ++i)
+    {
+        seq += alphabet[rand() % alphabet.size()];
+    }
+    return seq;
+}
+
+const lest::test module[] =
+{
+    CASE( "test GetRC (bit-parallel vs nucleotide-wise)" )
+    {
+        cout << "Reverse complement verification" << endl;
+        srand(time(NULL));
+        EXPECT( GetRC(Seq2Int("AACG", 4, true), 4) == Seq2Int("CGTT", 4, true) );
+        for (size_t k_len = 1; k_len <= 32; ++k_len) {
+            for (uint i = 0; i < 100; ++i) {
+                uint64_t code = Seq2Int(RandomSeq(k_len, "ACGT"), k_len, true);
+                EXPECT( GetRC(code, k_len) == GetRC_old(code, k_len) );
+                EXPECT( GetRC(GetRC(code, k_len), k_len) == code );
+            }
+        }
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test KmerRoller (vs Seq2Int on each window)" )
+    {
+        cout << "Rolling k-mer encoding verification" << endl;
+        srand(time(NULL));
+        for (size_t k_len : {1, 5, 15, 31, 32}) {
+            string seq = RandomSeq(300, "ACGTacgtN");
+            KmerRoller<> kmer_roller(k_len);
+            for (size_t i = 0; i < seq.size(); ++i) {
+                bool is_valid = kmer_roller.Roll(seq[i]);
+                bool has_n = (i + 1 < k_len || seq.substr(i + 1 - k_len, k_len).find('N') != string::npos);
+                EXPECT( is_valid == !has_n );
+                if (is_valid) {
+                    string kmer = seq.substr(i + 1 - k_len, k_len);
+                    EXPECT( kmer_roller.GetFwCode() == Seq2Int(kmer, k_len, true) );
+                    EXPECT( kmer_roller.GetRCCode() == GetRC(Seq2Int(kmer, k_len, true), k_len) );
+                    EXPECT( kmer_roller.GetCode(false) == Seq2Int(kmer, k_len, false) );
+                }
+            }
+        }
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test 128-bit k-mer codes (k up to 64)" )
+    {
+        cout << "128-bit k-mer encoding verification" << endl;
+        srand(time(NULL));
+        for (size_t k_len = 1; k_len <= 64; ++k_len) {
+            for (uint i = 0; i < 20; ++i) {
+                string kmer = RandomSeq(k_len, "ACGT"), decoded;
+                uint128_t code = Seq2Int<uint128_t>(kmer, k_len, true);
+                Int2Seq(decoded, code, k_len);
+                EXPECT( decoded == kmer );
+                EXPECT( (GetRC(code, k_len) == Seq2Int<uint128_t>(RevComp(kmer), k_len, true)) );
+                EXPECT( (Seq2Int<uint128_t>(kmer, k_len, false) == min(code, GetRC(code, k_len))) );
+                if (k_len <= 32) {
+                    EXPECT( (code == Seq2Int(kmer, k_len, true)) );
+                }
+            }
+        }
+        for (size_t k_len : {31, 33, 48, 63, 64}) {
+            string seq = RandomSeq(300, "ACGTacgtN");
+            KmerRoller<uint128_t> kmer_roller(k_len);
+            for (size_t i = 0; i < seq.size(); ++i) {
+                if (kmer_roller.Roll(seq[i])) {
+                    string kmer = seq.substr(i + 1 - k_len, k_len);
+                    EXPECT( (kmer_roller.GetFwCode() == Seq2Int<uint128_t>(kmer, k_len, true)) );
+                    EXPECT( (kmer_roller.GetCode(false) == Seq2Int<uint128_t>(kmer, k_len, false)) );
+                }
+            }
+        }
+        cout << "   ok" << endl;
+    }
+};
+
+
+extern lest::tests & specification();
+
+MODULE( specification(), module )
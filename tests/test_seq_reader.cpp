@@ -0,0 +1,52 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "lest.hpp"
+#include "seq_reader.hpp"
+
+using namespace std;
+
+static vector<pair<string, string>> ReadAll(const string &path, const size_t nb_base)
+{
+    vector<pair<string, string>> rec_vect;
+    vector<SeqRecord> batch;
+    SeqReader seq_reader(path);
+    while (seq_reader.NextBatch(batch, nb_base)) {
+        for (const auto &rec : batch) {
+            rec_vect.emplace_back(string(rec.name, rec.name_len), string(rec.seq, rec.seq_len));
+        }
+    }
+    return rec_vect;
+}
+
+
+
+const lest::test module[] =
+{
+    CASE( "test SeqReader on fasta and fastq" )
+    {
+        cout << "Fasta and fastq parsing verification" << endl;
+        const vector<pair<string, string>> ref_vect{{"s1 first", "ACGTACGTAA"}, {"s2", ""}, {"s3", "GGGTTTCCCAAAN"}};
+        ofstream("test_seq_reader.fa") << ">s1 first\nACGTA\nCGTAA\n>s2\n>s3\r\nGGGTTT\r\nCCCAAAN\r\n\n";
+        ofstream("test_seq_reader.fq") << "@s1 first\nACGTACGTAA\n+\nIIIIIIIIII\n@s2\n\n+\n\n@s3\nGGGTTTCCCAAAN\n+s3\n@@@@@@@@@@@@@";
+        for (const size_t nb_base : {1, 12, 1000}) {
+            EXPECT( ReadAll("test_seq_reader.fa", nb_base) == ref_vect );
+            EXPECT( ReadAll("test_seq_reader.fq", nb_base) == ref_vect );
+        }
+        EXPECT( SeqReader("test_seq_reader.fq").IsFastq() );
+        EXPECT( !SeqReader("test_seq_reader.fa").IsFastq() );
+        ofstream("test_seq_reader.fq") << "@s1\nACGT\nIIII\n";
+        EXPECT_THROWS( ReadAll("test_seq_reader.fq", 1000) );
+        remove("test_seq_reader.fa");
+        remove("test_seq_reader.fq");
+        cout << "   ok" << endl;
+    }
+};
+
+
+extern lest::tests & specification();
+
+MODULE( specification(), module )
@@ -85,6 +85,78 @@ const lest::test module[] =
             EXPECT( abs(res_old - res_new) < 1.0/pow(10, 10) );
         }
         cout << "   ok" << endl;
+    },
+
+
+    CASE( "test Pearson and MAC kernels (dispatched vs scalar)" )
+    {
+        cout << "distance kernel verification (AVX2: " << (HasAVX2Kernels() ? "yes" : "no") << ")" << endl;
+        srand(time(NULL));
+        for (uint n=1 ; n<70 ; n++) { // sizes not multiple of the vector width, for the tail loop
+            vector<float> x, y;
+            for (uint i=0 ; i<n ; i++) {
+                float xi = static_cast <float> (rand()) / (static_cast <float> (RAND_MAX/9997.0));
+                x.push_back(i % 3 == 0 ? floor(xi) : xi);
+                float yi = static_cast <float> (rand()) / (static_cast <float> (RAND_MAX/9997.0));
+                y.push_back(i % 4 == 0 ? x[i] : (i % 5 == 0 ? 0 : yi)); // equal values, zeros
+            }
+            x[0] = 0;
+            y[0] = 0;
+
+            EXPECT( abs(CalcPearsonCorr(x, y) - CalcPearsonCorr_scalar(x, y)) < 1.0/pow(10, 10) );
+            EXPECT( abs(CalcPearsonCorr(x, y) - CalcPearsonCorr_old(x, y)) < 1.0/pow(10, 10) );
+
+            double mac_ref = 0;
+            for (uint i=0 ; i<n ; i++) {
+                if (x[i] != y[i]) {
+                    mac_ref += fabs(static_cast<double>(x[i] - y[i]) / (x[i] + y[i]));
+                }
+            }
+            mac_ref /= n;
+            EXPECT( abs(CalcMACDist_scalar(x, y) - mac_ref) < 1.0/pow(10, 10) );
+            EXPECT( abs(CalcMACDist(x, y) - mac_ref) < 1.0/pow(10, 10) );
+        }
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test Spearman distance from cached ranks" )
+    {
+        cout << "Spearman from ranks verification" << endl;
+        srand(time(NULL));
+        vector<float> x, y, x_rank, y_rank;
+        for (uint test_idx=0 ; test_idx<20 ; test_idx++) {
+            for (uint i=0 ; i<50 ; i++) {
+                x.push_back(rand() % 20); // many ties
+                y.push_back(static_cast <float> (rand()) / (static_cast <float> (RAND_MAX/9997.0)));
+            }
+            CalcRankVect(x, x_rank);
+            CalcRankVect(y, y_rank);
+
+            EXPECT( abs(CalcSpearmanDistFromRanks(x_rank, y_rank) - CalcSpearmanDist(x, y)) < 1.0/pow(10, 10) );
+        }
+        cout << "   ok" << endl;
+    },
+
+
+    CASE( "test log2p1 (vs std::log2)" )
+    {
+        cout << "log2(x + 1) kernel verification" << endl;
+        srand(time(NULL));
+        vector<float> x{0, 1, 2, 3, 1e-8f, 0.4142135f, 1e6f, 3e9f};
+        for (uint i=0 ; i<20000 ; i++) {
+            float xi = static_cast <float> (rand()) / (static_cast <float> (RAND_MAX/9997.0));
+            x.push_back(i % 2 == 0 ? floor(xi) : xi);
+        }
+        vector<double> log_x;
+        log2p1(x, log_x);
+
+        EXPECT( log_x.size() == x.size() );
+        EXPECT( log_x[0] == 0 );
+        for (uint i=0 ; i<x.size() ; i++) {
+            EXPECT( abs(log_x[i] - log2(static_cast<double>(x[i]) + 1)) < 1.0/pow(10, 10) );
+        }
+        cout << "   ok" << endl;
     }
 };
 